@@ -10,7 +10,7 @@ tools_OPT_ENABLE+=fs http rom serial png midi sfg hostio synth
 tools_CC:=$(tools_TOOLCHAIN)gcc -c -MMD -O3 -Isrc -Werror -Wimplicit $(tools_CC_EXTRA) \
   $(patsubst %,-DUSE_%=1,$(tools_OPT_ENABLE))
 tools_LD:=$(tools_TOOLCHAIN)gcc
-tools_LDPOST:=$(tools_LD_EXTRA) -lz -lm
+tools_LDPOST:=$(tools_LD_EXTRA) -lz -lm -lpthread
 
 ifneq (,$(strip $(filter asound,$(tools_OPT_ENABLE))))
   tools_LDPOST+=-lasound
@@ -38,3 +38,16 @@ all:$(tools_EGGDEV_EXE)
 all-tools:$(tools_EGGDEV_EXE)
 eggdev:$(tools_EGGDEV_EXE)
 
+
+# 'make bench' builds and runs micro-benchmarks for synth and sfg. Not part of 'all'.
+# Results are JSON Lines; keep copies of them to compare across commits.
+tools_BENCH_CFILES:=$(filter src/bench/%.c,$(SRCFILES))
+tools_BENCH_OFILES:=$(patsubst src/%.c,$(tools_MIDDIR)/%.o,$(tools_BENCH_CFILES))
+-include $(tools_BENCH_OFILES:.o=.d)
+tools_BENCH_EXE:=$(tools_OUTDIR)/bench$(tools_EXE_SFX)
+tools_BENCH_REPORT:=$(tools_OUTDIR)/bench.jsonl
+$(tools_BENCH_EXE):$(tools_BENCH_OFILES) $(tools_OPT_OFILES);$(PRECMD) $(tools_LD) -o$@ $(tools_BENCH_OFILES) $(tools_OPT_OFILES) $(tools_LDPOST)
+bench:$(tools_BENCH_EXE);$(tools_BENCH_EXE) --out=$(tools_BENCH_REPORT)
+
+# 'make check' runs the correctness checks from the same executable, and fails if any does. Not part of 'all'.
+check:$(tools_BENCH_EXE);$(tools_BENCH_EXE) --check
@@ -0,0 +1,602 @@
+/* bench_check.c
+ * Correctness checks, as opposed to measurements. Run via `make check`.
+ * Each case prints one line, and any out of tolerance says FAIL and makes the process exit nonzero.
+ */
+
+#include "bench_internal.h"
+#include "opt/sfg/sfg_internal.h"
+
+static int bench_failc=0;
+
+/* Report one case. Difference and tolerance are in whatever units the case likes.
+ */
+
+static void bench_expect(const char *name,double diff,double tolerance) {
+  if (diff<=tolerance) {
+    fprintf(stderr,"ok   %-40s diff %g\n",name,diff);
+  } else {
+    fprintf(stderr,"FAIL %-40s diff %g, tolerance %g\n",name,diff,tolerance);
+    bench_failc++;
+  }
+}
+
+static double bench_maxdiff(const float *a,const float *b,int c) {
+  double worst=0.0;
+  for (;c-->0;a++,b++) {
+    double d=*a-*b;
+    if (d<0.0) d=-d;
+    if (d>worst) worst=d;
+  }
+  return worst;
+}
+
+/* Deterministic inputs, nothing to do with the noise under test.
+ */
+
+static uint32_t bench_rand_state=0x12345678;
+
+static float bench_randf(float lo,float hi) {
+  bench_rand_state^=bench_rand_state<<13;
+  bench_rand_state^=bench_rand_state>>17;
+  bench_rand_state^=bench_rand_state<<5;
+  return lo+(hi-lo)*(float)(bench_rand_state>>8)/16777216.0f;
+}
+
+static void bench_randv(float *v,int c,float lo,float hi) {
+  for (;c-->0;v++) *v=bench_randf(lo,hi);
+}
+
+/* synth kernels: Every vector table against scalar, on random input, at lengths around each vector width.
+ * Float kernels must match within rounding, and integer state (phase, noise, quantized output) exactly.
+ * Tone kernels run both mono and panned stereo.
+ * FM runs a second time with modulation deep enough to overflow int32 increments at high pitch, which every table must clamp the same way.
+ */
+
+static const char *bench_simd_namev[]={"sse2","avx2","neon"};
+static const int bench_kernel_lenv[]={0,1,3,4,5,7,8,9,15,16,17,31,33,100,SYNTH_BUFFER_LIMIT};
+
+static void bench_check_synth_kernels_1(const struct synth_simd *simd,const struct synth_simd *ref) {
+  float wave[SYNTH_WAVE_SIZE_SAMPLES],sine[SYNTH_WAVE_SIZE_SAMPLES];
+  float level[SYNTH_BUFFER_LIMIT],mix[SYNTH_BUFFER_LIMIT],range[SYNTH_BUFFER_LIMIT],deep[SYNTH_BUFFER_LIMIT],src[SYNTH_BUFFER_LIMIT];
+  float init[SYNTH_BUFFER_LIMIT*2],a[SYNTH_BUFFER_LIMIT*4],b[SYNTH_BUFFER_LIMIT*4];
+  int16_t ia[SYNTH_BUFFER_LIMIT],ib[SYNTH_BUFFER_LIMIT];
+  int i=0;
+  for (;i<SYNTH_WAVE_SIZE_SAMPLES;i++) sine[i]=sinf((i*M_PI*2.0f)/SYNTH_WAVE_SIZE_SAMPLES);
+  bench_randv(wave,SYNTH_WAVE_SIZE_SAMPLES,-1.0f,1.0f);
+  double fdiff=0.0,idiff=0.0;
+  int li=0;
+  for (;li<sizeof(bench_kernel_lenv)/sizeof(int);li++) {
+    int c=bench_kernel_lenv[li];
+    bench_randv(level,SYNTH_BUFFER_LIMIT,-1.0f,1.0f);
+    bench_randv(mix,SYNTH_BUFFER_LIMIT,0.0f,1.0f);
+    bench_randv(range,SYNTH_BUFFER_LIMIT,0.0f,4.0f);
+    bench_randv(deep,SYNTH_BUFFER_LIMIT,-32.0f,32.0f);
+    bench_randv(src,SYNTH_BUFFER_LIMIT,-2.0f,2.0f);
+    bench_randv(init,SYNTH_BUFFER_LIMIT*2,-1.0f,1.0f);
+    uint32_t p0=(uint32_t)(bench_randf(0.0f,1.0f)*4294967295.0f),dp=(uint32_t)(bench_randf(0.0f,0.1f)*4294967296.0f);
+    uint32_t deepdp=(uint32_t)(bench_randf(0.25f,0.5f)*4294967296.0f);
+    uint32_t pa,pb,ma,mb,moddp=dp*3;
+    double d;
+
+    #define COMPARE_F(n) if ((d=bench_maxdiff(a,b,n))>fdiff) fdiff=d;
+    #define COMPARE_I(x,y) if ((x)!=(y)) idiff=1.0;
+    
+    const float panv[2]={0.25f,0.75f};
+    int chanc=1;
+    for (;chanc<=2;chanc++) {
+      const float *pan=(chanc==2)?panv:0;
+      int samplec=c*chanc;
+
+      memcpy(a,init,sizeof(float)*samplec); memcpy(b,init,sizeof(float)*samplec); pa=pb=p0;
+      simd->wave(a,c,wave,&pa,dp,level,pan); ref->wave(b,c,wave,&pb,dp,level,pan);
+      COMPARE_F(samplec) COMPARE_I(pa,pb)
+
+      memcpy(a,init,sizeof(float)*samplec); memcpy(b,init,sizeof(float)*samplec); pa=pb=p0;
+      simd->rock(a,c,wave,sine,&pa,dp,mix,level,pan); ref->rock(b,c,wave,sine,&pb,dp,mix,level,pan);
+      COMPARE_F(samplec) COMPARE_I(pa,pb)
+
+      memcpy(a,init,sizeof(float)*samplec); memcpy(b,init,sizeof(float)*samplec); pa=pb=p0; ma=mb=~p0;
+      simd->fm(a,c,sine,&pa,dp,&ma,moddp,range,level,pan); ref->fm(b,c,sine,&pb,dp,&mb,moddp,range,level,pan);
+      COMPARE_F(samplec) COMPARE_I(pa,pb) COMPARE_I(ma,mb)
+
+      memcpy(a,init,sizeof(float)*samplec); memcpy(b,init,sizeof(float)*samplec); pa=pb=p0; ma=mb=~p0;
+      simd->fm(a,c,sine,&pa,deepdp,&ma,moddp,deep,level,pan); ref->fm(b,c,sine,&pb,deepdp,&mb,moddp,deep,level,pan);
+      COMPARE_F(samplec) COMPARE_I(pa,pb) COMPARE_I(ma,mb)
+
+      memcpy(a,init,sizeof(float)*samplec); memcpy(b,init,sizeof(float)*samplec);
+      simd->mlt_clamp_add(a,c,src,level,0.5f,pan); ref->mlt_clamp_add(b,c,src,level,0.5f,pan);
+      COMPARE_F(samplec)
+    }
+
+    memcpy(a,init,sizeof(float)*c*2); memcpy(b,init,sizeof(float)*c*2);
+    simd->pan_add(a,c,src,0.25f,0.75f); ref->pan_add(b,c,src,0.25f,0.75f);
+    COMPARE_F(c*2)
+
+    // Noise twice in a row, so we cover finishing a partial step.
+    struct synth_noise na,nb;
+    synth_noise_seed(&na,c);
+    synth_noise_seed(&nb,c);
+    simd->noise(a,c,&na); simd->noise(a+c,c+3,&na);
+    ref->noise(b,c,&nb); ref->noise(b+c,c+3,&nb);
+    if (memcmp(a,b,sizeof(float)*(c*2+3))||memcmp(&na,&nb,sizeof(na))) idiff=1.0;
+
+    simd->quantize(ia,c,src,20000.0f,0); ref->quantize(ib,c,src,20000.0f,0);
+    if (memcmp(ia,ib,sizeof(int16_t)*c)) idiff=1.0;
+    bench_randv(a,c*2,-1.0f,1.0f);
+    simd->quantize(ia,c,src,20000.0f,a); ref->quantize(ib,c,src,20000.0f,a);
+    if (memcmp(ia,ib,sizeof(int16_t)*c)) idiff=1.0;
+
+    #undef COMPARE_F
+    #undef COMPARE_I
+  }
+  char name[64];
+  snprintf(name,sizeof(name),"synth kernels %s, float",simd->name);
+  bench_expect(name,fdiff,1e-5);
+  snprintf(name,sizeof(name),"synth kernels %s, integer",simd->name);
+  bench_expect(name,idiff,0.0);
+}
+
+static void bench_check_synth_kernels() {
+  const struct synth_simd *ref=synth_simd_by_name("scalar",-1);
+  int i=0;
+  for (;i<sizeof(bench_simd_namev)/sizeof(void*);i++) {
+    const struct synth_simd *simd=synth_simd_by_name(bench_simd_namev[i],-1);
+    if (!simd) continue;
+    bench_check_synth_kernels_1(simd,ref);
+  }
+}
+
+/* Table sine and fast exp2, as used by sfg's modulator and rate LFO, against libm.
+ * Bounds are what their comments promise.
+ */
+
+static void bench_check_approximations() {
+  sfg_sine_require();
+  double worst=0.0;
+  int i=0;
+  for (;i<1000000;i++) {
+    float p=i/1000000.0f;
+    double d=fabs((double)sfg_sine_lookup(p)-sin(p*M_PI*2.0));
+    if (d>worst) worst=d;
+  }
+  bench_expect("sfg sine lookup, absolute",worst,5e-6);
+  struct synth *synth=synth_new(BENCH_RATE,1,0);
+  worst=synth?0.0:1.0;
+  if (synth) {
+    for (i=0;i<SYNTH_WAVE_SIZE_SAMPLES;i++) {
+      double d=fabs((double)synth->sine[i]-sin((i*M_PI*2.0)/SYNTH_WAVE_SIZE_SAMPLES));
+      if (d>worst) worst=d;
+    }
+    synth_del(synth);
+  }
+  bench_expect("synth sine table, absolute",worst,1e-7);
+  worst=0.0;
+  for (i=-1000000;i<=1000000;i++) {
+    float x=i/62500.0f; // -16..16
+    double ref=exp2((double)x);
+    double d=fabs((double)sfg_exp2(x)-ref)/ref;
+    if (d>worst) worst=d;
+  }
+  bench_expect("sfg exp2, relative",worst,4e-6);
+}
+
+/* Whole synth: Every tuned program, 8 voices, rendered with scalar kernels and with each vector table.
+ */
+
+static int bench_render_program(float *dst,int pid,const char *simd,uint32_t seed) {
+  struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+  if (!synth) return -1;
+  if (synth_set_simd(synth,simd)<0) {
+    synth_del(synth);
+    return -1;
+  }
+  synth_set_noise_seed(synth,seed);
+  synth_event(synth,8,MIDI_OPCODE_PROGRAM,pid,0,0);
+  int i=0;
+  for (;i<8;i++) synth_event(synth,8,MIDI_OPCODE_NOTE_ONCE,0x24+((i*7)%0x40),0x60,BENCH_FRAMES/2);
+  memset(dst,0,sizeof(float)*BENCH_FRAMES*2);
+  int framep=0;
+  for (;framep<BENCH_FRAMES;framep+=BENCH_BLOCK) {
+    int framec=BENCH_FRAMES-framep;
+    if (framec>BENCH_BLOCK) framec=BENCH_BLOCK;
+    synth_updatef(dst+framep*2,framec*2,synth);
+  }
+  synth_del(synth);
+  return 0;
+}
+
+static void bench_check_synth_render() {
+  float *a=malloc(sizeof(float)*BENCH_FRAMES*2);
+  float *b=malloc(sizeof(float)*BENCH_FRAMES*2);
+  if (!a||!b) {
+    bench_expect("synth render, allocation",1.0,0.0);
+    if (a) free(a);
+    if (b) free(b);
+    return;
+  }
+  int i=0;
+  for (;i<sizeof(bench_simd_namev)/sizeof(void*);i++) {
+    const char *name=bench_simd_namev[i];
+    if (!synth_simd_by_name(name,-1)) continue;
+    double worst=0.0;
+    int pid=0;
+    for (;pid<0x80;pid++) {
+      int mode=synth_builtin[pid].mode;
+      if ((mode<1)||(mode>=SYNTH_CHANNEL_MODE_ALIAS)) continue;
+      if ((bench_render_program(a,pid,"scalar",0)<0)||(bench_render_program(b,pid,name,0)<0)) {
+        worst=INFINITY;
+        break;
+      }
+      double d=bench_maxdiff(a,b,BENCH_FRAMES*2);
+      if (d>worst) worst=d;
+    }
+    char desc[64];
+    snprintf(desc,sizeof(desc),"synth render %s vs scalar",name);
+    bench_expect(desc,worst,1e-4);
+  }
+  free(a);
+  free(b);
+}
+
+/* Float output for drivers, against int16: Same level and same clipping, within the int path's truncation.
+ * Every tuned program with 32 loud voices, which clips plenty.
+ */
+
+static void bench_check_output_float() {
+  float *f=malloc(sizeof(float)*BENCH_FRAMES*2);
+  int16_t *i16=malloc(sizeof(int16_t)*BENCH_FRAMES*2);
+  double worst=0.0;
+  int pid=0;
+  for (;f&&i16&&(pid<0x80);pid++) {
+    int mode=synth_builtin[pid].mode;
+    if ((mode<1)||(mode>=SYNTH_CHANNEL_MODE_ALIAS)) continue;
+    int pass=0;
+    for (;pass<2;pass++) {
+      struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+      if (!synth) { worst=INFINITY; break; }
+      synth_event(synth,8,MIDI_OPCODE_PROGRAM,pid,0,0);
+      int i=0;
+      for (;i<32;i++) synth_event(synth,8,MIDI_OPCODE_NOTE_ONCE,0x24+((i*7)%0x40),0x7f,BENCH_FRAMES/2);
+      if (pass) synth_updatei(i16,BENCH_FRAMES*2,synth);
+      else synth_updatef_clamped(f,BENCH_FRAMES*2,synth);
+      synth_del(synth);
+    }
+    int i=BENCH_FRAMES*2;
+    while (i-->0) {
+      double d=fabs(f[i]*32768.0-i16[i]);
+      if (d>worst) worst=d;
+    }
+  }
+  if (!f||!i16) worst=INFINITY;
+  if (f) free(f);
+  if (i16) free(i16);
+  bench_expect("synth float output vs int16, LSB",worst,1.0);
+}
+
+/* Noise determinism: Same seed, same noise, no matter who's asking or how the calls are sliced.
+ * synth and sfg share the seeding, and each must reproduce itself exactly run to run.
+ */
+
+static int bench_print_sfg(float *dst,int dstc,const char *src,int chunk) {
+  struct sr_encoder bin={0};
+  if (sfg_compile(&bin,src,strlen(src),"check",1)<0) {
+    sr_encoder_cleanup(&bin);
+    return -1;
+  }
+  struct sfg_printer *printer=sfg_printer_new(BENCH_RATE,bin.v,bin.c);
+  sr_encoder_cleanup(&bin);
+  if (!printer) return -1;
+  while (!sfg_printer_update(printer,chunk)) ;
+  struct sfg_pcm *pcm=sfg_printer_get_pcm(printer);
+  int c=(pcm->c<dstc)?pcm->c:dstc;
+  memset(dst,0,sizeof(float)*dstc);
+  memcpy(dst,pcm->v,sizeof(float)*c);
+  sfg_printer_del(printer);
+  return c;
+}
+
+static void bench_check_noise() {
+
+  // Seeding: Repeatable, nonzero, different for neighboring seeds, and synth agrees with sfg.
+  double diff=0.0;
+  uint32_t seed=0;
+  for (;seed<1000;seed++) {
+    uint32_t lanev[SYNTH_NOISE_LANES],nextv[SYNTH_NOISE_LANES];
+    struct synth_noise noise;
+    sfg_noise_seed_lanes(lanev,SYNTH_NOISE_LANES,seed);
+    sfg_noise_seed_lanes(nextv,SYNTH_NOISE_LANES,seed+1);
+    synth_noise_seed(&noise,seed);
+    if (memcmp(lanev,noise.s,sizeof(lanev))||!memcmp(lanev,nextv,sizeof(lanev))) diff=1.0;
+    int i=SYNTH_NOISE_LANES;
+    while (i-->0) if (!lanev[i]) diff=1.0;
+  }
+  bench_expect("noise seeding",diff,0.0);
+  
+  float *a=malloc(sizeof(float)*BENCH_FRAMES*2);
+  float *b=malloc(sizeof(float)*BENCH_FRAMES*2);
+  if (!a||!b) {
+    bench_expect("noise, allocation",1.0,0.0);
+    if (a) free(a);
+    if (b) free(b);
+    return;
+  }
+  
+  // sfg: Printing the same noisy sound twice, in different slices.
+  const char *src="shape noise\nlevel 0 5 1 300 0\nbandpass 1800 200\n";
+  int ac=bench_print_sfg(a,BENCH_FRAMES*2,src,BENCH_FRAMES*2);
+  int bc=bench_print_sfg(b,BENCH_FRAMES*2,src,333);
+  diff=((ac<1)||(ac!=bc)||memcmp(a,b,sizeof(float)*ac))?1.0:0.0;
+  bench_expect("noise sfg repeatable",diff,0.0);
+  
+  // synth: Noisy programs twice with the same seed must match exactly, and a different seed must differ.
+  double same=0.0,other=0.0;
+  int pid=0,progc=0;
+  for (;pid<0x80;pid++) {
+    if (synth_builtin[pid].mode!=SYNTH_CHANNEL_MODE_SUB) continue;
+    progc++;
+    if (
+      (bench_render_program(a,pid,"scalar",1234)<0)||
+      (bench_render_program(b,pid,"scalar",1234)<0)
+    ) { same=1.0; break; }
+    if (memcmp(a,b,sizeof(float)*BENCH_FRAMES*2)) same=1.0;
+    if (bench_render_program(b,pid,"scalar",1235)<0) { same=1.0; break; }
+    if (!memcmp(a,b,sizeof(float)*BENCH_FRAMES*2)) other=1.0;
+  }
+  if (!progc) same=1.0;
+  bench_expect("noise synth repeatable",same,0.0);
+  bench_expect("noise synth follows seed",other,0.0);
+  
+  free(a);
+  free(b);
+}
+
+/* sfg: Every reference sound, printed with each vector table, without the optimizer, and on several threads.
+ * Kernels and threads must match serial scalar exactly.
+ * The optimizer may swap in the integer-phase flat oscillator, whose rounding can land a sample on the neighboring wave table entry.
+ * That's worth 4/SFG_WAVE_SIZE_SAMPLES at most for the reference sounds (a full-scale triangle), so that's our tolerance.
+ * These are the same comparisons `make bench` reports alongside its timing.
+ */
+
+static struct sfg_pcm *bench_print_res(const struct rom_res *res,const char *simd,int optimize,int threadc) {
+  if (sfg_set_simd(simd)<0) return 0;
+  sfg_set_optimize(optimize);
+  struct sfg_printer *printer=sfg_printer_new(BENCH_RATE,res->v,res->c);
+  sfg_set_simd(0);
+  sfg_set_optimize(1);
+  if (!printer) return 0;
+  sfg_printer_set_threads(printer,threadc);
+  sfg_printer_update(printer,INT_MAX);
+  struct sfg_pcm *pcm=sfg_printer_get_pcm(printer);
+  sfg_pcm_ref(pcm);
+  sfg_printer_del(printer);
+  return pcm;
+}
+
+static double bench_pcm_diff(const struct sfg_pcm *a,const struct sfg_pcm *b) {
+  if (!a||!b||(a->c!=b->c)) return INFINITY;
+  return bench_maxdiff(a->v,b->v,a->c);
+}
+
+static void bench_check_sounds_1(const char *desc,double worst,const char *worstname,double tolerance) {
+  char name[64];
+  if (worst>tolerance) snprintf(name,sizeof(name),"%s (%s)",desc,worstname);
+  else snprintf(name,sizeof(name),"%s",desc);
+  bench_expect(name,worst,tolerance);
+}
+
+static void bench_check_sounds() {
+  static const int threadcv[]={2,4,8};
+  #define THREADCC (sizeof(threadcv)/sizeof(int))
+  double simdv[3]={0},unopt=0.0,threadv[THREADCC]={0};
+  const char *simdnamev[3]={0},*unoptname=0,*threadnamev[THREADCC]={0};
+  const struct rom_res *res=bench.rom.resv;
+  int i=0;
+  for (;i<bench.rom.resc;i++,res++) {
+    int tid=0,qual=0,rid=0;
+    rom_unpack_fqrid(&tid,&qual,&rid,res->fqrid);
+    if ((rid<35)||(rid>=35+bench_soundc)) continue;
+    const char *name=bench_soundv[rid-35].name;
+    struct sfg_pcm *ref=bench_print_res(res,"scalar",1,1);
+    struct sfg_pcm *pcm;
+    double d;
+    int ii=0;
+    for (;ii<3;ii++) {
+      if (sfg_set_simd(bench_simd_namev[ii])<0) continue;
+      pcm=bench_print_res(res,bench_simd_namev[ii],1,1);
+      if ((d=bench_pcm_diff(pcm,ref))>simdv[ii]) { simdv[ii]=d; simdnamev[ii]=name; }
+      sfg_pcm_del(pcm);
+    }
+    sfg_set_simd(0);
+    pcm=bench_print_res(res,"scalar",0,1);
+    if ((d=bench_pcm_diff(pcm,ref))>unopt) { unopt=d; unoptname=name; }
+    sfg_pcm_del(pcm);
+    for (ii=0;ii<THREADCC;ii++) {
+      pcm=bench_print_res(res,"scalar",1,threadcv[ii]);
+      if (!pcm||!ref||(pcm->c!=ref->c)||memcmp(pcm->v,ref->v,sizeof(float)*pcm->c)) { threadv[ii]=1.0; threadnamev[ii]=name; }
+      sfg_pcm_del(pcm);
+    }
+    sfg_pcm_del(ref);
+  }
+  char desc[64];
+  for (i=0;i<3;i++) {
+    if (sfg_set_simd(bench_simd_namev[i])<0) continue;
+    snprintf(desc,sizeof(desc),"sfg sounds %s vs scalar",bench_simd_namev[i]);
+    bench_check_sounds_1(desc,simdv[i],simdnamev[i],0.0);
+  }
+  sfg_set_simd(0);
+  bench_check_sounds_1("sfg sounds unoptimized",unopt,unoptname,4.0/SFG_WAVE_SIZE_SAMPLES);
+  for (i=0;i<THREADCC;i++) {
+    snprintf(desc,sizeof(desc),"sfg sounds %d threads vs serial",threadcv[i]);
+    bench_check_sounds_1(desc,threadv[i],threadnamev[i],0.0);
+  }
+  #undef THREADCC
+}
+
+/* Delay ring-out: Full feedback holds forever, so the fx proc must never gate it.
+ * Partial feedback rings until it drops below SYNTH_ENV_SILENCE, and no feedback for one pass.
+ */
+
+static void bench_check_delay_ringout() {
+  struct synth_delay delay={0};
+  if (synth_delay_init(&delay,1000,0.5f,1.0f)<0) {
+    bench_expect("delay ringout, allocation",1.0,0.0);
+    return;
+  }
+  bench_expect("delay ringout, full feedback holds",(synth_delay_ringout(&delay)==INT_MAX)?0.0:1.0,0.0);
+  
+  // Feed one impulse and run past ringout. Every echo from there on must be inaudible.
+  delay.fbk=0.75f;
+  delay.sto=0.25f;
+  int ringout=synth_delay_ringout(&delay);
+  double last=0.0;
+  int i=0;
+  for (;i<ringout+delay.c;i++) {
+    float v=synth_delay_update(&delay,i?0.0f:1.0f);
+    if (i>=ringout) {
+      if (fabsf(v)>last) last=fabsf(v);
+    }
+  }
+  bench_expect("delay ringout, silent after",last,SYNTH_ENV_SILENCE);
+  
+  delay.fbk=0.0f;
+  delay.sto=1.0f;
+  bench_expect("delay ringout, no feedback",abs(synth_delay_ringout(&delay)-delay.c),0.0);
+  synth_delay_cleanup(&delay);
+}
+
+/* Song playhead: Jumping to some time must land where natural playback would be, even many loops in.
+ * Events are no-op opcodes; we're only watching the song's own position.
+ */
+
+static void bench_check_song_playhead() {
+  struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+  if (!synth) {
+    bench_expect("song playhead, allocation",1.0,0.0);
+    return;
+  }
+  struct synth_song_event eventv[]={
+    {.frame=0},{.frame=10},{.frame=25},{.frame=40},{.frame=55},
+  };
+  struct synth_song natural={
+    .eventv=eventv,
+    .eventc=sizeof(eventv)/sizeof(eventv[0]),
+    .framec=60,
+    .loopeventp=2,
+    .loopframe=25,
+    .repeat=1,
+    .frames_per_ms=1.0f,
+    .tempo=1,
+  };
+  struct synth_song jump=natural;
+  int mismatchc=0,t=0;
+  for (;t<1000;t++) {
+    synth_song_update(synth,&natural);
+    synth_song_set_playhead(synth,&jump,t);
+    synth_song_update(synth,&jump);
+    if ((jump.framep!=natural.framep)||(jump.eventp!=natural.eventp)) mismatchc++;
+    synth_song_advance(&natural,1);
+  }
+  synth_del(synth);
+  bench_expect("song set_playhead vs playback",mismatchc,0.0);
+}
+
+/* Posted song commands, as the game thread sees them.
+ * Getters must report a posted song or playhead right away, then what the audio thread published once it lands.
+ * The song is 10 quiet delays of 100 ms at 100 ms/beat, so 10 beats long.
+ */
+
+static int bench_song_rom(struct rom *rom,struct sr_encoder *serial) {
+  uint8_t song[42+11]={0xbe,0xee,0xee,'P',0,100,0,42,0,42};
+  memset(song+42,100,10);
+  struct romw romw={0};
+  struct romw_res *res=romw_res_add(&romw);
+  if (!res) return -1;
+  res->tid=EGG_RESTYPE_song;
+  res->rid=1;
+  if (romw_res_set_serial(res,song,sizeof(song))<0) {
+    romw_cleanup(&romw);
+    return -1;
+  }
+  int err=romw_encode(serial,&romw);
+  romw_cleanup(&romw);
+  if (err<0) return -1;
+  return rom_init_borrow(rom,serial->v,serial->c);
+}
+
+static void bench_check_song_posts() {
+  struct sr_encoder serial={0};
+  struct rom rom={0};
+  struct synth *synth=0;
+  float *buf=malloc(sizeof(float)*BENCH_BLOCK*2);
+  if (!buf||(bench_song_rom(&rom,&serial)<0)||!(synth=synth_new(BENCH_RATE,2,&rom))) {
+    bench_expect("song posts, setup",1.0,0.0);
+    if (buf) free(buf);
+    rom_cleanup(&rom);
+    sr_encoder_cleanup(&serial);
+    return;
+  }
+  int qual,rid,repeat,failc=0;
+  #define EXPECT_SONG(q,r,rp) { \
+    synth_get_song(&qual,&rid,&repeat,synth); \
+    if ((qual!=q)||(rid!=r)||(repeat!=rp)) failc++; \
+  }
+  #define EXPECT_PLAYHEAD(v,tolerance) { \
+    if (fabs(synth_get_playhead(synth,0.0)-(v))>tolerance) failc++; \
+  }
+  // Once landed, the song is on whole frames, and set_playhead may truncate one.
+  double beats_per_block=(double)BENCH_BLOCK/(BENCH_RATE*0.1);
+  double frame=1.0/(BENCH_RATE*0.1);
+  
+  EXPECT_SONG(0,0,0)
+  EXPECT_PLAYHEAD(-1.0,0.0)
+  synth_post_play_song(synth,0,1,0,1);
+  EXPECT_SONG(0,1,1)
+  EXPECT_PLAYHEAD(0.0,0.0)
+  synth_post_set_playhead(synth,2.0);
+  EXPECT_PLAYHEAD(2.0,0.0)
+  synth_updatef(buf,BENCH_BLOCK*2,synth);
+  EXPECT_SONG(0,1,1)
+  EXPECT_PLAYHEAD(2.0+beats_per_block,frame)
+  if (fabs(synth_get_duration(synth)-10.0)>1e-6) failc++;
+  
+  // Same song without force is a no-op, and must not report a restart.
+  synth_post_play_song(synth,0,1,0,1);
+  EXPECT_PLAYHEAD(2.0+beats_per_block,frame)
+  synth_updatef(buf,BENCH_BLOCK*2,synth);
+  EXPECT_PLAYHEAD(2.0+beats_per_block*2.0,frame)
+  
+  // Stopping reports no song right away.
+  synth_post_play_song(synth,0,0,0,0);
+  EXPECT_SONG(0,0,0)
+  EXPECT_PLAYHEAD(-1.0,0.0)
+  synth_updatef(buf,BENCH_BLOCK*2,synth);
+  EXPECT_SONG(0,0,0)
+  EXPECT_PLAYHEAD(-1.0,0.0)
+  
+  #undef EXPECT_SONG
+  #undef EXPECT_PLAYHEAD
+  synth_del(synth);
+  free(buf);
+  rom_cleanup(&rom);
+  sr_encoder_cleanup(&serial);
+  bench_expect("song state thru posts",failc,0.0);
+}
+
+/* Main entry point.
+ */
+
+int bench_check() {
+  bench_failc=0;
+  bench_check_synth_kernels();
+  bench_check_approximations();
+  bench_check_synth_render();
+  bench_check_output_float();
+  bench_check_noise();
+  bench_check_sounds();
+  bench_check_delay_ringout();
+  bench_check_song_playhead();
+  bench_check_song_posts();
+  if (bench_failc) fprintf(stderr,"%d checks failed.\n",bench_failc);
+  else fprintf(stderr,"All checks passed.\n");
+  return bench_failc;
+}
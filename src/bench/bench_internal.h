@@ -0,0 +1,32 @@
+#ifndef BENCH_INTERNAL_H
+#define BENCH_INTERNAL_H
+
+#include "opt/synth/synth_internal.h"
+#include "opt/serial/serial.h"
+#include "opt/fs/fs.h"
+
+#define BENCH_RATE 44100
+#define BENCH_FRAMES 22050 /* Per measurement. Half a second. */
+#define BENCH_BLOCK 512 /* Frames per update, a typical driver buffer. */
+
+/* Reference sounds in sfg text format, ids 35.. in (bench.rom). See bench_main.c.
+ */
+struct bench_sound {
+  const char *name;
+  const char *src;
+};
+extern const struct bench_sound bench_soundv[];
+extern const int bench_soundc;
+
+extern struct bench {
+  FILE *out;
+  struct rom rom; // Reference sounds as ids 35.., for drum kit 0x80.
+  struct sr_encoder romserial;
+} bench;
+
+/* Correctness checks, `make check` or `bench --check`. See bench_check.c.
+ * Returns the count of failures; zero if all passed.
+ */
+int bench_check();
+
+#endif
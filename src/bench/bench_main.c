@@ -0,0 +1,658 @@
+/* bench_main.c
+ * Micro-benchmarks for synth and sfg. Run via `make bench`.
+ * Output is JSON Lines, one measurement per line, so it's easy to diff and plot across commits.
+ * Times are the best of a few runs, in nanoseconds per output frame (stereo) or per sample (sfg).
+ */
+
+#include "bench_internal.h"
+
+#define BENCH_REPEAT 3 /* Report the fastest of so many runs. */
+
+static const int bench_voicecv[]={1,8,32};
+#define BENCH_VOICECC (sizeof(bench_voicecv)/sizeof(int))
+
+static const int bench_threadcv[]={1,2,4,8};
+#define BENCH_THREADCC (sizeof(bench_threadcv)/sizeof(int))
+
+static const char *bench_mode_namev[]={
+  "", // 0 is not a mode.
+  "DRUM","BLIP","WAVE","ROCK","FMREL","FMABS","SUB","FX","ALIAS",
+};
+
+/* Reference sounds, in sfg text format.
+ * Try to cover each oscillator shape and each post-processing op.
+ * Add new ones at the end; names are how we track them over time.
+ */
+const struct bench_sound bench_soundv[]={
+  {"sine","level 0 10 1 200 0.5 300 0\n"},
+  {"harmonics",
+    "shape sawup\n"
+    "harmonics 1 0.5 0.33 0.25 0.2 0.16 0.14 0.12\n"
+    "rate 220\n"
+    "level 0 10 1 400 0\n"
+  },
+  {"fm",
+    "master 0.4\n"
+    "fm 1.3 2\n"
+    "fmenv 0.577586 14 1 175 0.702586\n"
+    "rate 35.214348 7 236.758652 25 69.844698 24 44.685634 131 78.678774\n"
+    "level 0 11 1 37 0.181034 116 0\n"
+  },
+  {"noise_bandpass",
+    "shape noise\n"
+    "level 0 5 1 300 0\n"
+    "bandpass 1800 200\n"
+    "gain 4\n"
+    "clip 0.8\n"
+  },
+  {"filters",
+    "shape square\n"
+    "rate 110 400 330\n"
+    "ratelfo 6 50\n"
+    "level 0 20 1 600 0.5 400 0\n"
+    "lopass 2000\n"
+    "hipass 100\n"
+    "notch 1000 100\n"
+  },
+  {"delay",
+    "shape triangle\n"
+    "rate 660 100 440\n"
+    "level 0 5 1 100 0\n"
+    "delay 150 0.5 0.5 0.5 0.5\n"
+    "level 1 1000 1 1000 0\n"
+  },
+  {"multivoice",
+    "shape sine\n"
+    "rate 440\n"
+    "level 0 10 1 500 0\n"
+    "endvoice\n"
+    "shape sawdown\n"
+    "rate 660\n"
+    "level 0 10 0.5 500 0\n"
+    "endvoice\n"
+    "shape noise\n"
+    "level 0 5 0.2 200 0\n"
+    "lopass 800\n"
+  },
+  {"vibrato",
+    "master 0.4\n"
+    "fm 2 3\n"
+    "rate 440 300 330\n"
+    "ratelfo 5.5 40\n"
+    "level 0 20 1 500 0.5 300 0\n"
+  },
+  {"redundant",
+    "shape triangle\n"
+    "rate 330\n"
+    "ratelfo 5 0\n"
+    "gain 2\n"
+    "level 0 10 1 300 0\n"
+    "gain 0.25\n"
+    "clip 0.9\n"
+    "delay 100 1 0 0.5 0.5\n"
+    "gain 1\n"
+  },
+  {"layered",
+    "master 0.3\n"
+    "shape noise\n"
+    "level 0 20 1 2500 0\n"
+    "lopass 600\n"
+    "delay 120 0.7 0.3 0.5 0.4\n"
+    "endvoice\n"
+    "shape noise\n"
+    "level 0 5 1 800 0\n"
+    "bandpass 2000 500\n"
+    "endvoice\n"
+    "shape sawup\n"
+    "fm 0.5 4\n"
+    "rate 80 1500 30\n"
+    "ratelfo 3 100\n"
+    "level 0 10 1 2000 0\n"
+    "lopass 1200\n"
+    "endvoice\n"
+    "shape square\n"
+    "rate 160 1000 40\n"
+    "level 0 10 0.5 1500 0\n"
+    "notch 500 200\n"
+    "hipass 60\n"
+  },
+};
+#define BENCH_SOUNDC (sizeof(bench_soundv)/sizeof(struct bench_sound))
+const int bench_soundc=BENCH_SOUNDC;
+
+struct bench bench={0};
+
+static double bench_now() {
+  struct timespec ts={0};
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (double)ts.tv_sec+(double)ts.tv_nsec/1000000000.0;
+}
+
+/* Build the in-memory ROM of reference sounds.
+ */
+
+static int bench_init_rom() {
+  struct romw romw={0};
+  int i=0;
+  for (;i<BENCH_SOUNDC;i++) {
+    struct sr_encoder bin={0};
+    const char *src=bench_soundv[i].src;
+    if (sfg_compile(&bin,src,strlen(src),bench_soundv[i].name,1)<0) {
+      fprintf(stderr,"Failed to compile reference sound '%s'\n",bench_soundv[i].name);
+      sr_encoder_cleanup(&bin);
+      romw_cleanup(&romw);
+      return -1;
+    }
+    struct romw_res *res=romw_res_add(&romw);
+    if (!res) return -1;
+    res->tid=EGG_RESTYPE_sound;
+    res->rid=35+i;
+    romw_res_handoff_serial(res,bin.v,bin.c);
+  }
+  romw_sort(&romw);
+  if (romw_encode(&bench.romserial,&romw)<0) {
+    romw_cleanup(&romw);
+    return -1;
+  }
+  romw_cleanup(&romw);
+  if (rom_init_borrow(&bench.rom,bench.romserial.v,bench.romserial.c)<0) return -1;
+  return 0;
+}
+
+/* Render BENCH_FRAMES of stereo from a prepared synth, and return the time it took.
+ * (trigger) if not null is called before each block, to add events.
+ */
+
+static double bench_render(struct synth *synth,void (*trigger)(struct synth *synth,int framep,void *userdata),void *userdata) {
+  float buf[BENCH_BLOCK*2];
+  double elapsed=0.0;
+  int framep=0;
+  while (framep<BENCH_FRAMES) {
+    if (trigger) trigger(synth,framep,userdata);
+    memset(buf,0,sizeof(buf));
+    double starttime=bench_now();
+    synth_updatef(buf,BENCH_BLOCK*2,synth);
+    elapsed+=bench_now()-starttime;
+    framep+=BENCH_BLOCK;
+  }
+  return elapsed;
+}
+
+static double bench_ns_per_frame(double elapsed) {
+  return (elapsed*1000000000.0)/(double)BENCH_FRAMES;
+}
+
+
+/* One program with N voices.
+ * Notes spread across a few octaves, all with Note Once lasting the full run.
+ */
+
+static double bench_program_1(int pid,int voicec) {
+  double best=0.0;
+  int repeat=BENCH_REPEAT;
+  while (repeat-->0) {
+    struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+    if (!synth) return -1.0;
+    synth_event(synth,8,MIDI_OPCODE_PROGRAM,pid,0,0);
+    int i=0;
+    for (;i<voicec;i++) {
+      synth_event(synth,8,MIDI_OPCODE_NOTE_ONCE,0x24+((i*7)%0x40),0x60,BENCH_FRAMES);
+    }
+    double elapsed=bench_render(synth,0,0);
+    synth_del(synth);
+    if ((best<=0.0)||(elapsed<best)) best=elapsed;
+  }
+  return best;
+}
+
+static int bench_programs() {
+  double totalv[SYNTH_CHANNEL_MODE_ALIAS+1][BENCH_VOICECC]={0};
+  int countv[SYNTH_CHANNEL_MODE_ALIAS+1]={0};
+  int pid=0;
+  for (;pid<0x80;pid++) {
+    // Skip aliases; they'd only measure their target again, and complain about it.
+    int mode=synth_builtin[pid].mode;
+    if ((mode<1)||(mode>=SYNTH_CHANNEL_MODE_ALIAS)) continue;
+    countv[mode]++;
+    int vi=0;
+    for (;vi<BENCH_VOICECC;vi++) {
+      double elapsed=bench_program_1(pid,bench_voicecv[vi]);
+      if (elapsed<0.0) return -1;
+      double ns=bench_ns_per_frame(elapsed);
+      totalv[mode][vi]+=ns;
+      fprintf(bench.out,
+        "{\"type\":\"program\",\"pid\":%d,\"mode\":\"%s\",\"voices\":%d,\"ns_per_frame\":%.2f}\n",
+        pid,bench_mode_namev[mode],bench_voicecv[vi],ns
+      );
+    }
+  }
+  // Summary per mode: Mean of each program in that mode, at each voice count.
+  int mode=1;
+  for (;mode<=SYNTH_CHANNEL_MODE_ALIAS;mode++) {
+    if (!countv[mode]) continue;
+    int vi=0;
+    for (;vi<BENCH_VOICECC;vi++) {
+      double ns=totalv[mode][vi]/countv[mode];
+      fprintf(bench.out,
+        "{\"type\":\"mode\",\"mode\":\"%s\",\"programs\":%d,\"voices\":%d,\"ns_per_frame\":%.2f}\n",
+        bench_mode_namev[mode],countv[mode],bench_voicecv[vi],ns
+      );
+      fprintf(stderr,"%8s %2d voices: %10.2f ns/frame\n",bench_mode_namev[mode],bench_voicecv[vi],ns);
+    }
+  }
+  return 0;
+}
+
+/* DRUM mode: Kit 0x80 maps notes to our reference sounds.
+ * Hit (voicec) of them every 100 ms. The first hit of each prints it, after that it's cached.
+ */
+
+static void bench_drums_trigger(struct synth *synth,int framep,void *userdata) {
+  int voicec=*(int*)userdata;
+  int period=BENCH_RATE/10;
+  if (framep%period>=BENCH_BLOCK) return;
+  int i=0;
+  for (;i<voicec;i++) {
+    synth_event(synth,8,MIDI_OPCODE_NOTE_ON,35+i%BENCH_SOUNDC,0x60,0);
+  }
+}
+
+static int bench_drums() {
+  int vi=0;
+  for (;vi<BENCH_VOICECC;vi++) {
+    int voicec=bench_voicecv[vi];
+    double best=0.0;
+    int repeat=BENCH_REPEAT;
+    while (repeat-->0) {
+      struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+      if (!synth) return -1;
+      synth_set_voice_limits(synth,0,0,voicec);
+      synth_event(synth,8,MIDI_OPCODE_CONTROL,MIDI_CONTROL_BANK_LSB,1,0);
+      synth_event(synth,8,MIDI_OPCODE_PROGRAM,0,0,0);
+      double elapsed=bench_render(synth,bench_drums_trigger,&voicec);
+      synth_del(synth);
+      if ((best<=0.0)||(elapsed<best)) best=elapsed;
+    }
+    double ns=bench_ns_per_frame(best);
+    fprintf(bench.out,"{\"type\":\"mode\",\"mode\":\"DRUM\",\"programs\":1,\"voices\":%d,\"ns_per_frame\":%.2f}\n",voicec,ns);
+    fprintf(stderr,"%8s %2d voices: %10.2f ns/frame\n","DRUM",voicec,ns);
+  }
+  return 0;
+}
+
+/* Print scheduling: Start every reference sound in the same update, twice over, nothing cached.
+ * Report the slowest update against its realtime deadline, with and without a print budget.
+ */
+
+static int bench_print_budget_1(double fraction,int samplec) {
+  struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+  if (!synth) return -1;
+  synth_set_voice_limits(synth,0,0,BENCH_SOUNDC*2);
+  synth_set_print_budget(synth,fraction,samplec);
+  int i=0;
+  for (;i<BENCH_SOUNDC*2;i++) synth_play_sound(synth,0,35+i%BENCH_SOUNDC,0.5f,0.0f);
+  float buf[BENCH_BLOCK*2];
+  double worst=0.0;
+  int framep=0;
+  for (;framep<BENCH_FRAMES;framep+=BENCH_BLOCK) {
+    memset(buf,0,sizeof(buf));
+    double starttime=bench_now();
+    synth_updatef(buf,BENCH_BLOCK*2,synth);
+    double elapsed=bench_now()-starttime;
+    if (elapsed>worst) worst=elapsed;
+  }
+  struct synth_stats stats={0};
+  synth_get_stats(&stats,synth);
+  synth_del(synth);
+  double deadline=(double)BENCH_BLOCK/(double)BENCH_RATE;
+  fprintf(bench.out,
+    "{\"type\":\"print_budget\",\"budget\":%.2f,\"budget_samples\":%d,\"worst_update_ms\":%.3f,\"deadline_ms\":%.3f,\"missc\":%d,\"lag_frames\":%lld,\"lag_max\":%d}\n",
+    fraction,samplec,worst*1000.0,deadline*1000.0,stats.print_missc,(long long)stats.print_lagc,stats.print_lag_max
+  );
+  fprintf(stderr,
+    "print budget %.2f %5d: worst update %.3f ms of %.3f, %d misses, lag %lld frames, max %d\n",
+    fraction,samplec,worst*1000.0,deadline*1000.0,stats.print_missc,(long long)stats.print_lagc,stats.print_lag_max
+  );
+  return 0;
+}
+
+static int bench_print_budget() {
+  if (bench_print_budget_1(0.0,0)<0) return -1;
+  if (bench_print_budget_1(0.25,0)<0) return -1;
+  if (bench_print_budget_1(0.0,4096)<0) return -1;
+  return 0;
+}
+
+/* Compact cache: Prewarm every reference sound, then mix them all at once from the cache.
+ * Compare cache size and mixing time with float and int16 storage, and the largest difference in output.
+ */
+
+static double bench_compact_1(int64_t *bytes,float *dst,int compact) {
+  double best=0.0;
+  int repeat=BENCH_REPEAT;
+  while (repeat-->0) {
+    struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+    if (!synth) return -1.0;
+    synth_set_compact_cache(synth,compact);
+    synth_set_voice_limits(synth,0,0,BENCH_SOUNDC);
+    if (synth_prewarm(synth,1,0)<0) {
+      synth_del(synth);
+      return -1.0;
+    }
+    struct synth_stats stats={0};
+    synth_get_stats(&stats,synth);
+    *bytes=stats.cache_bytes;
+    int i=0;
+    for (;i<BENCH_SOUNDC;i++) synth_play_sound(synth,0,35+i,0.5f,(float)i/(float)BENCH_SOUNDC-0.5f);
+    double elapsed=0.0;
+    int framep=0;
+    for (;framep<BENCH_FRAMES;framep+=BENCH_BLOCK) {
+      float *v=dst+framep*2;
+      int framec=BENCH_FRAMES-framep;
+      if (framec>BENCH_BLOCK) framec=BENCH_BLOCK;
+      memset(v,0,sizeof(float)*framec*2);
+      double starttime=bench_now();
+      synth_updatef(v,framec*2,synth);
+      elapsed+=bench_now()-starttime;
+    }
+    synth_del(synth);
+    if ((best<=0.0)||(elapsed<best)) best=elapsed;
+  }
+  return best;
+}
+
+static int bench_compact() {
+  float *a=malloc(sizeof(float)*BENCH_FRAMES*2);
+  float *b=malloc(sizeof(float)*BENCH_FRAMES*2);
+  if (!a||!b) {
+    if (a) free(a);
+    if (b) free(b);
+    return -1;
+  }
+  int64_t fbytes=0,ibytes=0;
+  double ft=bench_compact_1(&fbytes,a,0);
+  double it=bench_compact_1(&ibytes,b,1);
+  float maxdiff=0.0f;
+  int i=BENCH_FRAMES*2;
+  while (i-->0) {
+    float d=a[i]-b[i];
+    if (d<0.0f) d=-d;
+    if (d>maxdiff) maxdiff=d;
+  }
+  free(a);
+  free(b);
+  if ((ft<0.0)||(it<0.0)) return -1;
+  fprintf(bench.out,
+    "{\"type\":\"compact\",\"sounds\":%d,\"float_bytes\":%lld,\"int16_bytes\":%lld,\"float_ns_per_frame\":%.2f,\"int16_ns_per_frame\":%.2f,\"max_diff\":%g}\n",
+    (int)BENCH_SOUNDC,(long long)fbytes,(long long)ibytes,bench_ns_per_frame(ft),bench_ns_per_frame(it),maxdiff
+  );
+  fprintf(stderr,
+    "compact cache: %lld bytes vs %lld float, mixing %.2f ns/frame vs %.2f float, max diff %g\n",
+    (long long)ibytes,(long long)fbytes,bench_ns_per_frame(it),bench_ns_per_frame(ft),maxdiff
+  );
+  return 0;
+}
+
+/* Thread scaling: Eight channels, four notes each, one program from each family of eight.
+ */
+
+static double bench_threads_1(int threadc) {
+  double best=0.0;
+  int repeat=BENCH_REPEAT;
+  while (repeat-->0) {
+    struct synth *synth=synth_new(BENCH_RATE,2,&bench.rom);
+    if (!synth) return -1.0;
+    if (synth_set_threads(synth,threadc)<0) {
+      synth_del(synth);
+      return -1.0;
+    }
+    int chid=8;
+    for (;chid<16;chid++) {
+      synth_event(synth,chid,MIDI_OPCODE_PROGRAM,(chid-8)*16,0,0);
+      int i=0;
+      for (;i<4;i++) synth_event(synth,chid,MIDI_OPCODE_NOTE_ONCE,0x30+chid+i*5,0x60,BENCH_FRAMES);
+    }
+    double elapsed=bench_render(synth,0,0);
+    synth_del(synth);
+    if ((best<=0.0)||(elapsed<best)) best=elapsed;
+  }
+  return best;
+}
+
+static int bench_threads() {
+  int ti=0;
+  for (;ti<BENCH_THREADCC;ti++) {
+    double elapsed=bench_threads_1(bench_threadcv[ti]);
+    if (elapsed<0.0) return -1;
+    double ns=bench_ns_per_frame(elapsed);
+    fprintf(bench.out,"{\"type\":\"threads\",\"threads\":%d,\"voices\":32,\"ns_per_frame\":%.2f}\n",bench_threadcv[ti],ns);
+    fprintf(stderr,"threads %d: %10.2f ns/frame\n",bench_threadcv[ti],ns);
+  }
+  return 0;
+}
+
+/* Float to int16 conversion, each kernel this CPU supports, with and without dither.
+ * Same cost whatever the signal, so we just use a ramp.
+ */
+ 
+static int bench_quantize() {
+  int samplec=BENCH_FRAMES*2;
+  float *src=malloc(sizeof(float)*samplec);
+  float *dither=malloc(sizeof(float)*samplec*2);
+  int16_t *dst=malloc(sizeof(int16_t)*samplec);
+  if (!src||!dither||!dst) return -1;
+  int i=samplec;
+  while (i-->0) src[i]=(float)((i%200)-100)/100.0f;
+  struct synth_noise noise;
+  synth_noise_seed(&noise,1);
+  synth_simd_by_name("scalar",-1)->noise(dither,samplec*2,&noise);
+  const char *namev[]={"scalar","sse2","avx2","neon"};
+  for (i=0;i<sizeof(namev)/sizeof(void*);i++) {
+    const struct synth_simd *simd=synth_simd_by_name(namev[i],-1);
+    if (!simd) continue;
+    int dith=0;
+    for (;dith<2;dith++) {
+      double best=0.0;
+      int repeat=BENCH_REPEAT;
+      while (repeat-->0) {
+        double starttime=bench_now();
+        int p=0;
+        while (p<samplec) {
+          int c=samplec-p;
+          if (c>BENCH_BLOCK*2) c=BENCH_BLOCK*2;
+          simd->quantize(dst+p,c,src+p,32000.0f,dith?(dither+p*2):0);
+          p+=c;
+        }
+        double elapsed=bench_now()-starttime;
+        if ((best<=0.0)||(elapsed<best)) best=elapsed;
+      }
+      double ns=bench_ns_per_frame(best);
+      fprintf(bench.out,"{\"type\":\"quantize\",\"simd\":\"%s\",\"dither\":%d,\"ns_per_frame\":%.3f}\n",simd->name,dith,ns);
+      fprintf(stderr,"quantize %6s dither=%d: %10.3f ns/frame\n",simd->name,dith,ns);
+    }
+  }
+  free(src);
+  free(dither);
+  free(dst);
+  return 0;
+}
+
+/* sfg: Print each reference sound start to finish, with the best kernels and with the scalar ones.
+ * The two should match exactly. Then once more without the decode-time optimizer, which should differ only by rounding.
+ * Differences are reported for the record; `make check` is what enforces them.
+ */
+ 
+static double bench_sound_1(struct sfg_pcm **pcm,struct sfg_printer_stats *stats,const struct rom_res *res,const char *simd,int optimize,int threadc) {
+  if (sfg_set_simd(simd)<0) return -1.0;
+  sfg_set_optimize(optimize);
+  double best=0.0;
+  int repeat=BENCH_REPEAT;
+  while (repeat-->0) {
+    double starttime=bench_now();
+    struct sfg_printer *printer=sfg_printer_new(BENCH_RATE,res->v,res->c);
+    if (!printer) return -1.0;
+    sfg_printer_set_threads(printer,threadc);
+    sfg_printer_update(printer,INT_MAX);
+    double elapsed=bench_now()-starttime;
+    if (!repeat) {
+      *pcm=sfg_printer_get_pcm(printer);
+      sfg_pcm_ref(*pcm);
+      if (stats) sfg_printer_get_stats(stats,printer);
+    }
+    sfg_printer_del(printer);
+    if ((best<=0.0)||(elapsed<best)) best=elapsed;
+  }
+  return best;
+}
+
+static int bench_sounds() {
+  const struct rom_res *res=bench.rom.resv;
+  int i=0;
+  for (;i<bench.rom.resc;i++,res++) {
+    int tid=0,qual=0,rid=0;
+    rom_unpack_fqrid(&tid,&qual,&rid,res->fqrid);
+    if ((rid<35)||(rid>=35+BENCH_SOUNDC)) continue;
+    const char *name=bench_soundv[rid-35].name;
+    struct sfg_pcm *pcm=0,*ref=0,*unopt=0;
+    struct sfg_printer_stats stats={0};
+    double best=bench_sound_1(&pcm,&stats,res,0,1,1);
+    double scalar=bench_sound_1(&ref,0,res,"scalar",1,1);
+    double unoptt=bench_sound_1(&unopt,0,res,0,0,1);
+    sfg_set_simd(0);
+    sfg_set_optimize(1);
+    if ((best<0.0)||(scalar<0.0)||(unoptt<0.0)||!pcm||!ref||!unopt||(pcm->c!=ref->c)||(pcm->c!=unopt->c)) {
+      sfg_pcm_del(pcm);
+      sfg_pcm_del(ref);
+      sfg_pcm_del(unopt);
+      return -1;
+    }
+    int samplec=pcm->c,j=samplec;
+    float maxdiff=0.0f,optdiff=0.0f;
+    while (j-->0) {
+      float d=pcm->v[j]-ref->v[j];
+      if (d<0.0f) d=-d;
+      if (d>maxdiff) maxdiff=d;
+      d=pcm->v[j]-unopt->v[j];
+      if (d<0.0f) d=-d;
+      if (d>optdiff) optdiff=d;
+    }
+    sfg_pcm_del(pcm);
+    sfg_pcm_del(ref);
+    sfg_pcm_del(unopt);
+    double ns=(samplec>0)?((best*1000000000.0)/samplec):0.0;
+    double nss=(samplec>0)?((scalar*1000000000.0)/samplec):0.0;
+    double nsu=(samplec>0)?((unoptt*1000000000.0)/samplec):0.0;
+    fprintf(bench.out,
+      "{\"type\":\"sfg\",\"name\":\"%s\",\"samples\":%d,\"ns_per_sample\":%.2f,\"scalar_ns_per_sample\":%.2f,\"max_diff\":%g,"
+      "\"unoptimized_ns_per_sample\":%.2f,\"optimizer_diff\":%g,\"voices\":[%d,%d],\"ops\":[%d,%d]}\n",
+      name,samplec,ns,nss,maxdiff,nsu,optdiff,stats.voicec0,stats.voicec,stats.opc0,stats.opc
+    );
+    fprintf(stderr,
+      "sfg %16s: %10.2f ns/sample, scalar %10.2f, max diff %g, unoptimized %10.2f, diff %g, ops %d=>%d\n",
+      name,ns,nss,maxdiff,nsu,optdiff,stats.opc0,stats.opc
+    );
+  }
+  return 0;
+}
+
+/* sfg threads: Print each multi-voice reference sound with its voices spread across threads.
+ * Output must be bit-identical to serial, which `make check` enforces.
+ */
+ 
+static int bench_sound_threads() {
+  const struct rom_res *res=bench.rom.resv;
+  int i=0;
+  for (;i<bench.rom.resc;i++,res++) {
+    int tid=0,qual=0,rid=0;
+    rom_unpack_fqrid(&tid,&qual,&rid,res->fqrid);
+    if ((rid<35)||(rid>=35+BENCH_SOUNDC)) continue;
+    const char *name=bench_soundv[rid-35].name;
+    struct sfg_pcm *ref=0;
+    struct sfg_printer_stats stats={0};
+    double serial=bench_sound_1(&ref,&stats,res,0,1,1);
+    if ((serial<0.0)||!ref) return -1;
+    if (stats.voicec<2) {
+      sfg_pcm_del(ref);
+      continue;
+    }
+    int ti=1; // Skip threadc==1, that's (serial).
+    for (;ti<sizeof(bench_threadcv)/sizeof(int);ti++) {
+      int threadc=bench_threadcv[ti];
+      struct sfg_pcm *pcm=0;
+      double elapsed=bench_sound_1(&pcm,0,res,0,1,threadc);
+      if ((elapsed<0.0)||!pcm||(pcm->c!=ref->c)) {
+        sfg_pcm_del(pcm);
+        sfg_pcm_del(ref);
+        return -1;
+      }
+      int identical=!memcmp(pcm->v,ref->v,sizeof(float)*pcm->c);
+      sfg_pcm_del(pcm);
+      fprintf(bench.out,
+        "{\"type\":\"sfg_threads\",\"name\":\"%s\",\"voices\":%d,\"threads\":%d,\"ms\":%.3f,\"serial_ms\":%.3f,\"identical\":%s}\n",
+        name,stats.voicec,threadc,elapsed*1000.0,serial*1000.0,identical?"true":"false"
+      );
+      fprintf(stderr,
+        "sfg %16s: %d voices, %2d threads %8.3f ms, serial %8.3f ms, %s\n",
+        name,stats.voicec,threadc,elapsed*1000.0,serial*1000.0,identical?"identical":"MISMATCH"
+      );
+    }
+    sfg_pcm_del(ref);
+  }
+  return 0;
+}
+
+/* Main.
+ */
+
+int main(int argc,char **argv) {
+  const char *outpath=0;
+  int check=0;
+  int argi=1;
+  for (;argi<argc;argi++) {
+    const char *arg=argv[argi];
+    if (!memcmp(arg,"--out=",6)) outpath=arg+6;
+    else if (!strcmp(arg,"--check")) check=1;
+    else {
+      fprintf(stderr,"Usage: %s [--out=PATH] [--check]\n",argv[0]);
+      return 1;
+    }
+  }
+  if (check) {
+    if (bench_init_rom()<0) return 1;
+    return bench_check()?1:0;
+  }
+  if (outpath) {
+    if (dir_mkdirp_parent(outpath)<0) return 1;
+    if (!(bench.out=fopen(outpath,"w"))) {
+      fprintf(stderr,"%s: Failed to open for writing.\n",outpath);
+      return 1;
+    }
+  } else {
+    bench.out=stdout;
+  }
+
+  if (bench_init_rom()<0) return 1;
+  struct synth *synth=synth_new(BENCH_RATE,2,0);
+  if (!synth) return 1;
+  fprintf(bench.out,
+    "{\"type\":\"meta\",\"rate\":%d,\"chanc\":2,\"frames\":%d,\"block\":%d,\"simd\":\"%s\",\"cpus\":%d,\"time\":%lld}\n",
+    BENCH_RATE,BENCH_FRAMES,BENCH_BLOCK,synth->simd->name,(int)sysconf(_SC_NPROCESSORS_ONLN),(long long)time(0)
+  );
+  synth_del(synth);
+
+  double starttime=bench_now();
+  if (bench_programs()<0) return 1;
+  if (bench_drums()<0) return 1;
+  if (bench_print_budget()<0) return 1;
+  if (bench_compact()<0) return 1;
+  if (bench_threads()<0) return 1;
+  if (bench_quantize()<0) return 1;
+  if (bench_sounds()<0) return 1;
+  if (bench_sound_threads()<0) return 1;
+  fprintf(stderr,"Benchmarks complete in %.03f s.\n",bench_now()-starttime);
+  if (outpath) {
+    fclose(bench.out);
+    fprintf(stderr,"Wrote %s\n",outpath);
+  }
+  return 0;
+}
@@ -15,6 +15,7 @@ static void eggdev_print_help_commands() {
   fprintf(stderr,"    unbundle -oROM EXE|HTML\n");
   fprintf(stderr,"       serve [ROMS...] [--port=8080] [--external=0] [--htdocs=PATH]\n");
   fprintf(stderr," webtemplate -oHTML [JS...]\n");
+  fprintf(stderr,"      render -oWAV ROM song:ID|sound:ID [--loops=1] [--rate=44100] [--chanc=2] [-fs16|f32]\n");
   fprintf(stderr,"\n");
 }
 
@@ -105,6 +106,17 @@ static void eggdev_print_help_webtemplate() {
   fprintf(stderr,"\n");
 }
 
+static void eggdev_print_help_render() {
+  fprintf(stderr,"\nUsage: %s render -oWAV ROM song:ID|sound:ID [--loops=1] [--rate=44100] [--chanc=2] [-fs16|f32]\n\n",eggdev.exename);
+  fprintf(stderr,"Render a song or sound effect to a WAV file, as fast as we can, no audio device needed.\n");
+  fprintf(stderr,"Songs play '--loops' times, then we let the tail ring out until it goes quiet.\n");
+  fprintf(stderr,"Beyond one loop, the final pass is cut off within 256 frames of the loop point.\n");
+  fprintf(stderr,"Reports the time spent synthesizing as a multiple of realtime, which makes a decent benchmark.\n");
+  fprintf(stderr,"For sounds, also reports the voice and op counts before and after the decoder's optimization pass.\n");
+  fprintf(stderr,"Output is 16-bit integer by default, or '-ff32' for 32-bit float.\n");
+  fprintf(stderr,"\n");
+}
+
 /* --help, dispatch
  */
  
@@ -123,6 +135,7 @@ void eggdev_print_help(const char *topic,int topicc) {
   _(unbundle)
   _(serve)
   _(webtemplate)
+  _(render)
   #undef _
   else {
     fprintf(stderr,"%s: Unknown help topic '%.*s'. Printing default instead.\n",eggdev.exename,topicc,topic);
@@ -240,6 +253,19 @@ static int eggdev_config_kv(const char *k,int kc,const char *v,int vc) {
     return 0;
   }
   
+  #define INTOPT(fldname,optname,lo,hi) \
+    if ((kc==sizeof(optname)-1)&&!memcmp(k,optname,sizeof(optname)-1)) { \
+      if ((sr_int_eval(&eggdev.fldname,v,vc)<2)||(eggdev.fldname<lo)||(eggdev.fldname>hi)) { \
+        fprintf(stderr,"%s: Expected integer in %d..%d for '--%s', found '%.*s'\n",eggdev.exename,lo,hi,optname,vc,v); \
+        return -2; \
+      } \
+      return 0; \
+    }
+  INTOPT(loops,"loops",1,1000)
+  INTOPT(rate,"rate",200,200000)
+  INTOPT(chanc,"chanc",1,8)
+  #undef INTOPT
+  
   if ((kc==10)&&!memcmp(k,"named-only",10)) {
     if (sr_int_eval(&eggdev.named_only,v,vc)<2) {
       fprintf(stderr,"%s: Expected '0' or '1' for '--named-only'\n",eggdev.exename);
@@ -41,6 +41,9 @@ extern struct eggdev {
   const char *typespath;
   char **name_by_tid; // 64 entries, if not null
   int named_only;
+  int loops;
+  int rate;
+  int chanc;
   struct http_context *http;
   int has_wd_makefile;
   struct hostio_audio *audio;
@@ -81,6 +84,11 @@ int eggdev_tocflag_generate(struct sr_encoder *dst);
 
 int eggdev_webtemplate_generate(struct sr_encoder *dst);
 
+/* (resname) is "song:ID" or "sound:ID". (format) is "s16" or "f32", default "s16".
+ * Zero (rate,chanc) for defaults 44100 and 2.
+ */
+int eggdev_render_wav(const char *dstpath,const char *srcpath,const char *resname,int loops,int rate,int chanc,const char *format);
+
 int eggdev_shell_script_(const char *scriptpath,...);
 #define eggdev_shell_script(script,...) eggdev_shell_script_(script,##__VA_ARGS__,(void*)0)
 
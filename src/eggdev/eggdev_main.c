@@ -415,6 +415,26 @@ static int eggdev_main_webtemplate() {
   return 0;
 }
 
+/* render
+ */
+ 
+static int eggdev_main_render() {
+  if (!eggdev.dstpath) {
+    fprintf(stderr,"%s: Please specify output as -oWAV\n",eggdev.exename);
+    return 1;
+  }
+  if (eggdev.srcpathc!=2) {
+    fprintf(stderr,"%s: Expected ROM and 'song:ID' or 'sound:ID'.\n",eggdev.exename);
+    return 1;
+  }
+  int err=eggdev_render_wav(eggdev.dstpath,eggdev.srcpathv[0],eggdev.srcpathv[1],eggdev.loops,eggdev.rate,eggdev.chanc,eggdev.format);
+  if (err<0) {
+    if (err!=-2) fprintf(stderr,"%s: Unspecified error rendering audio.\n",eggdev.dstpath);
+    return 1;
+  }
+  return 0;
+}
+
 /* Main.
  */
  
@@ -435,6 +455,7 @@ int main(int argc,char **argv) {
   if (!strcmp(eggdev.command,"unbundle")) return eggdev_main_unbundle();
   if (!strcmp(eggdev.command,"serve")) return eggdev_main_serve();
   if (!strcmp(eggdev.command,"webtemplate")) return eggdev_main_webtemplate();
+  if (!strcmp(eggdev.command,"render")) return eggdev_main_render();
   fprintf(stderr,"%s: Unknown command '%s'\n",eggdev.exename,eggdev.command);
   eggdev_print_help(0,0);
   return 1;
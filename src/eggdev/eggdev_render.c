@@ -0,0 +1,268 @@
+#include "eggdev_internal.h"
+#include "opt/sfg/sfg.h"
+#include <math.h>
+
+#define EGGDEV_RENDER_BLOCK 256 /* Frames per update, and our granularity for detecting loops. */
+#define EGGDEV_RENDER_TAIL_SILENCE 0.250 /* Seconds of quiet that mark the end of a tail. */
+#define EGGDEV_RENDER_TAIL_LIMIT 10.0 /* Give up on the tail after so many seconds. */
+#define EGGDEV_RENDER_LIMIT 3600.0 /* Give up entirely after so many seconds, in case the song never loops. */
+#define EGGDEV_RENDER_QUIET 0.00001f
+
+/* Context.
+ */
+
+struct eggdev_render {
+  struct synth *synth;
+  int rate,chanc;
+  float *v; // Rendered output, interleaved.
+  int c,a; // Samples.
+  double elapsed; // Wall time spent in synth_updatef.
+};
+
+static void eggdev_render_cleanup(struct eggdev_render *render) {
+  if (render->synth) synth_del(render->synth);
+  if (render->v) free(render->v);
+}
+
+/* Render one block onto the end of our buffer.
+ * Returns nonzero if it was all quiet.
+ */
+
+static int eggdev_render_block(struct eggdev_render *render) {
+  int samplec=EGGDEV_RENDER_BLOCK*render->chanc;
+  if (render->c>render->a-samplec) {
+    int na=render->a+render->rate*render->chanc*4;
+    if (na>INT_MAX/sizeof(float)) return -1;
+    void *nv=realloc(render->v,sizeof(float)*na);
+    if (!nv) return -1;
+    render->v=nv;
+    render->a=na;
+  }
+  float *v=render->v+render->c;
+  memset(v,0,sizeof(float)*samplec);
+  double starttime=eggdev_now();
+  synth_updatef(v,samplec,render->synth);
+  render->elapsed+=eggdev_now()-starttime;
+  render->c+=samplec;
+  for (;samplec-->0;v++) {
+    if ((*v>EGGDEV_RENDER_QUIET)||(*v<-EGGDEV_RENDER_QUIET)) return 0;
+  }
+  return 1;
+}
+
+/* Render until it goes quiet.
+ */
+
+static int eggdev_render_tail(struct eggdev_render *render) {
+  int quietlimit=(int)(EGGDEV_RENDER_TAIL_SILENCE*render->rate)/EGGDEV_RENDER_BLOCK+1;
+  int blocklimit=(int)(EGGDEV_RENDER_TAIL_LIMIT*render->rate)/EGGDEV_RENDER_BLOCK+1;
+  int quietc=0;
+  while (blocklimit-->0) {
+    int err=eggdev_render_block(render);
+    if (err<0) return err;
+    if (err) {
+      if (++quietc>=quietlimit) {
+        // Trim the silence, but leave one block of it.
+        render->c-=(quietc-1)*EGGDEV_RENDER_BLOCK*render->chanc;
+        return 0;
+      }
+    } else {
+      quietc=0;
+    }
+  }
+  return 0;
+}
+
+/* Render a song, for (loops) passes, then its tail.
+ * With more than one pass, we play it repeating and cut it off when the playhead wraps for the last time.
+ * We only look between blocks, so a few notes from the next pass might sneak in and get released.
+ */
+
+static int eggdev_render_song(struct eggdev_render *render,int songid,int loops,const char *path) {
+  synth_play_song(render->synth,0,songid,1,(loops>1)?1:0);
+  int blocklimit=(int)(EGGDEV_RENDER_LIMIT*render->rate)/EGGDEV_RENDER_BLOCK;
+  double pvplayhead=0.0;
+  int wrapc=0;
+  for (;;) {
+    if (blocklimit--<=0) {
+      fprintf(stderr,"%s: Song didn't finish in %.0f s. Stopping.\n",path,EGGDEV_RENDER_LIMIT);
+      break;
+    }
+    if (eggdev_render_block(render)<0) return -1;
+    double playhead=synth_get_playhead(render->synth,0.0);
+    if (playhead<0.0) break; // Finished naturally.
+    if (playhead<pvplayhead) {
+      if (++wrapc>=loops) {
+        synth_play_song(render->synth,0,0,1,0);
+        break;
+      }
+    }
+    pvplayhead=playhead;
+  }
+  return eggdev_render_tail(render);
+}
+
+/* Render a sound effect.
+ */
+
+static int eggdev_render_sound(struct eggdev_render *render,int soundid) {
+  synth_play_sound(render->synth,0,soundid,1.0f,0.0f);
+  return eggdev_render_tail(render);
+}
+
+/* Report how much the sfg decoder was able to optimize out of a sound.
+ */
+
+static int eggdev_render_report_sound(const void *src,int srcc,int rate,const char *resname) {
+  struct sfg_printer *printer=sfg_printer_new(rate,src,srcc);
+  if (!printer) {
+    fprintf(stderr,"%s: Failed to decode sound.\n",resname);
+    return -2;
+  }
+  struct sfg_printer_stats stats={0};
+  sfg_printer_get_stats(&stats,printer);
+  sfg_printer_del(printer);
+  fprintf(stderr,
+    "%s: %d voices, %d ops as encoded. Optimized to %d voices, %d ops.\n",
+    resname,stats.voicec0,stats.opc0,stats.voicec,stats.opc
+  );
+  return 0;
+}
+
+/* Encode WAV.
+ */
+
+static int eggdev_render_encode_wav(struct sr_encoder *dst,const struct eggdev_render *render,int f32) {
+  int samplesize=f32?4:2;
+  if (render->c>(INT_MAX-44)/samplesize) return -1;
+  int datac=render->c*samplesize;
+  if (sr_encoder_require(dst,44+datac)<0) return -1;
+  if (sr_encode_raw(dst,"RIFF",4)<0) return -1;
+  if (sr_encode_intle(dst,36+datac,4)<0) return -1;
+  if (sr_encode_raw(dst,"WAVEfmt ",8)<0) return -1;
+  if (sr_encode_intle(dst,16,4)<0) return -1;
+  if (sr_encode_intle(dst,f32?3:1,2)<0) return -1; // 1=PCM, 3=float
+  if (sr_encode_intle(dst,render->chanc,2)<0) return -1;
+  if (sr_encode_intle(dst,render->rate,4)<0) return -1;
+  if (sr_encode_intle(dst,render->rate*render->chanc*samplesize,4)<0) return -1;
+  if (sr_encode_intle(dst,render->chanc*samplesize,2)<0) return -1;
+  if (sr_encode_intle(dst,samplesize*8,2)<0) return -1;
+  if (sr_encode_raw(dst,"data",4)<0) return -1;
+  if (sr_encode_intle(dst,datac,4)<0) return -1;
+  const float *src=render->v;
+  int i=render->c;
+  if (f32) {
+    for (;i-->0;src++) {
+      uint32_t bits;
+      memcpy(&bits,src,4);
+      if (sr_encode_intle(dst,bits,4)<0) return -1;
+    }
+  } else {
+    for (;i-->0;src++) {
+      float sample=*src;
+      if (sample>1.0f) sample=1.0f;
+      else if (sample<-1.0f) sample=-1.0f;
+      if (sr_encode_intle(dst,lroundf(sample*32767.0f),2)<0) return -1;
+    }
+  }
+  return 0;
+}
+
+/* Render, main entry point.
+ */
+
+int eggdev_render_wav(const char *dstpath,const char *srcpath,const char *resname,int loops,int rate,int chanc,const char *format) {
+
+  // Evaluate the resource name, "song:ID" or "sound:ID".
+  int resnamec=0,sepp=-1;
+  for (;resname[resnamec];resnamec++) if ((sepp<0)&&(resname[resnamec]==':')) sepp=resnamec;
+  int tid=0,rid=0;
+  if (sepp>0) {
+    tid=eggdev_type_eval(resname,sepp);
+    if ((sr_int_eval(&rid,resname+sepp+1,resnamec-sepp-1)<2)||(rid<1)||(rid>0xffff)) tid=0;
+  }
+  if ((tid!=EGG_RESTYPE_song)&&(tid!=EGG_RESTYPE_sound)) {
+    fprintf(stderr,"%s: Expected 'song:ID' or 'sound:ID', found '%s'.\n",eggdev.exename,resname);
+    return -2;
+  }
+  int f32=0;
+  if (!format||!strcmp(format,"s16")) f32=0;
+  else if (!strcmp(format,"f32")) f32=1;
+  else {
+    fprintf(stderr,"%s: Unknown format '%s'. Expected 's16' or 'f32'.\n",eggdev.exename,format);
+    return -2;
+  }
+  if (loops<1) loops=1;
+  if (!rate) rate=44100;
+  if (!chanc) chanc=2;
+
+  // Acquire the ROM.
+  void *serial=0;
+  int serialc=file_read(&serial,srcpath);
+  if (serialc<0) {
+    fprintf(stderr,"%s: Failed to read file.\n",srcpath);
+    return -2;
+  }
+  struct rom rom={0};
+  if (rom_init_borrow(&rom,serial,serialc)<0) {
+    fprintf(stderr,"%s: Failed to decode %d-byte file as Egg ROM.\n",srcpath,serialc);
+    free(serial);
+    return -2;
+  }
+  const void *res=0;
+  int resc=rom_get(&res,&rom,tid,0,rid);
+  if (resc<1) {
+    fprintf(stderr,"%s: Resource '%s' not found.\n",srcpath,resname);
+    rom_cleanup(&rom);
+    free(serial);
+    return -2;
+  }
+  if ((tid==EGG_RESTYPE_sound)&&(eggdev_render_report_sound(res,resc,rate,resname)<0)) {
+    rom_cleanup(&rom);
+    free(serial);
+    return -2;
+  }
+
+  // Render.
+  struct eggdev_render render={.rate=rate,.chanc=chanc};
+  if (!(render.synth=synth_new(rate,chanc,&rom))) {
+    fprintf(stderr,"%s: Failed to create synthesizer, rate=%d chanc=%d.\n",eggdev.exename,rate,chanc);
+    rom_cleanup(&rom);
+    free(serial);
+    return -2;
+  }
+  int err;
+  if (tid==EGG_RESTYPE_song) err=eggdev_render_song(&render,rid,loops,srcpath);
+  else err=eggdev_render_sound(&render,rid);
+  synth_del(render.synth);
+  render.synth=0;
+  rom_cleanup(&rom);
+  free(serial);
+  if (err<0) {
+    eggdev_render_cleanup(&render);
+    return err;
+  }
+
+  // Encode and write.
+  struct sr_encoder dst={0};
+  if (eggdev_render_encode_wav(&dst,&render,f32)<0) {
+    sr_encoder_cleanup(&dst);
+    eggdev_render_cleanup(&render);
+    return -1;
+  }
+  if (file_write(dstpath,dst.v,dst.c)<0) {
+    fprintf(stderr,"%s: Failed to write %d-byte file.\n",dstpath,dst.c);
+    sr_encoder_cleanup(&dst);
+    eggdev_render_cleanup(&render);
+    return -2;
+  }
+  sr_encoder_cleanup(&dst);
+
+  double duration=(double)(render.c/chanc)/(double)rate;
+  fprintf(stderr,
+    "%s: Rendered %.03f s in %.03f s, %.01fx realtime.\n",
+    dstpath,duration,render.elapsed,(render.elapsed>0.0)?(duration/render.elapsed):0.0
+  );
+  eggdev_render_cleanup(&render);
+  return 0;
+}
@@ -18,6 +18,10 @@ static void eggdev_serve_pcm(int16_t *v,int c,struct hostio_audio *audio) {
   synth_updatei(v,c,eggdev.synth);
 }
 
+static void eggdev_serve_pcmf(float *v,int c,struct hostio_audio *audio) {
+  synth_updatef_clamped(v,c,eggdev.synth);
+}
+
 /* Attempt initialization with one driver type.
  * If this reports success, it must also create (eggdev.audio).
  */
@@ -33,6 +37,7 @@ static int eggdev_serve_init_audio_driver(
   
   struct hostio_audio_delegate delegate={
     .cb_pcm_out=eggdev_serve_pcm,
+    .cb_pcm_outf=eggdev_serve_pcmf,
   };
   char zdevice[256];
   if (devicec>=sizeof(zdevice)) return -1;
@@ -31,8 +31,15 @@ struct alsafd_delegate {
   
   /* You must write (c) samples to (v).
    * (c) is in samples as usual -- not frames, not bytes.
+   * Required even if you supply (pcm_outf): Any device might refuse float.
    */
   void (*pcm_out)(int16_t *v,int c,void *userdata);
+  
+  /* Optional. If the device takes native float32, we call this instead.
+   * Hardware devices usually don't, so be ready for either.
+   * Clamp to -1..1 yourself; the device won't.
+   */
+  void (*pcm_outf)(float *v,int c,void *userdata);
 };
 
 /* You will not necessarily get the rate or channel count you ask for.
@@ -85,7 +92,7 @@ char *alsafd_find_device(
 
 void alsafd_del(struct alsafd *alsafd);
 
-/* (delegate->pcm_out) is required.
+/* (delegate->pcm_out) is required, (pcm_outf) is optional.
  * Everything else is optional. 1@44100 on any working device is the default.
  */
 struct alsafd *alsafd_new(
@@ -98,6 +105,7 @@ int alsafd_get_rate(const struct alsafd *alsafd);
 int alsafd_get_chanc(const struct alsafd *alsafd);
 const char *alsafd_get_device(const struct alsafd *alsafd);
 int alsafd_get_running(const struct alsafd *alsafd);
+int alsafd_get_floatout(const struct alsafd *alsafd); // Nonzero if we're calling pcm_outf.
 
 /* A new context is stopped until you explicitly set_running(1).
  */
@@ -12,16 +12,18 @@ static void *alsafd_iothd(void *arg) {
       usleep(1000);
       continue;
     }
-    if (alsafd->running) {
-      alsafd->delegate.pcm_out(alsafd->buf,alsafd->bufa,alsafd->delegate.userdata);
+    if (!alsafd->running) {
+      memset(alsafd->buf,0,alsafd->bufa*alsafd->samplesize);
+    } else if (alsafd->floatout) {
+      alsafd->delegate.pcm_outf(alsafd->buf,alsafd->bufa,alsafd->delegate.userdata);
     } else {
-      memset(alsafd->buf,0,alsafd->bufa<<1);
+      alsafd->delegate.pcm_out(alsafd->buf,alsafd->bufa,alsafd->delegate.userdata);
     }
     pthread_mutex_unlock(&alsafd->iomtx);
     alsafd->buffer_time_us=alsafd_now();
     
     const uint8_t *src=(uint8_t*)alsafd->buf;
-    int srcc=alsafd->bufa<<1; // bytes (from samples)
+    int srcc=alsafd->bufa*alsafd->samplesize; // bytes (from samples)
     int srcp=0;
     while (srcp<srcc) {
       pthread_testcancel();
@@ -136,49 +138,75 @@ static int alsafd_open_device(struct alsafd *alsafd) {
   return 0;
 }
 
-/* Init: With device open, send the handshake ioctls to configure it.
+/* Init: Hw params against the broadest set of criteria, anything we can technically handle.
+ * We impose a hard requirement for interleaved, and one format; that's about it.
  */
  
-static int alsafd_configure_device(
+static void alsafd_hw_params_init(struct snd_pcm_hw_params *params,int format,int samplebits) {
+  alsafd_hw_params_none(params);
+  params->flags=SNDRV_PCM_HW_PARAMS_NORESAMPLE;
+  alsafd_hw_params_set_mask(params,SNDRV_PCM_HW_PARAM_ACCESS,SNDRV_PCM_ACCESS_RW_INTERLEAVED,1);
+  alsafd_hw_params_set_mask(params,SNDRV_PCM_HW_PARAM_FORMAT,format,1);
+  alsafd_hw_params_set_mask(params,SNDRV_PCM_HW_PARAM_SUBFORMAT,SNDRV_PCM_SUBFORMAT_STD,1);
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_SAMPLE_BITS,samplebits,samplebits);
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_FRAME_BITS,0,UINT_MAX);
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_CHANNELS,ALSAFD_CHANC_MIN,ALSAFD_CHANC_MAX);
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_RATE,ALSAFD_RATE_MIN,ALSAFD_RATE_MAX);
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_PERIOD_TIME,0,UINT_MAX); // us between interrupts
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_PERIOD_SIZE,0,UINT_MAX); // frames between interrupts
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_PERIOD_BYTES,0,UINT_MAX); // bytes between interrupts
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_PERIODS,0,UINT_MAX); // interrupts per buffer
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_BUFFER_TIME,0,UINT_MAX); // us
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_BUFFER_SIZE,ALSAFD_BUF_MIN,ALSAFD_BUF_MAX); // frames
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_BUFFER_BYTES,0,UINT_MAX);
+  alsafd_hw_params_set_interval(params,SNDRV_PCM_HW_PARAM_TICK_TIME,0,UINT_MAX); // us
+}
+
+/* Init: Refine, apply the caller's preferences, and commit, all in one format.
+ * Refine fails if the format mask comes back empty, and a device can still refuse at commit.
+ * If (quiet), failures are not logged: The caller has another format to try.
+ */
+ 
+static int alsafd_hw_params_commit(
   struct alsafd *alsafd,
-  const struct alsafd_setup *setup
+  struct snd_pcm_hw_params *hwparams,
+  const struct alsafd_setup *setup,
+  int format,int samplebits,int quiet
 ) {
-
-  /* Refine hw params against the broadest set of criteria, anything we can technically handle.
-   * (we impose a hard requirement for s16 interleaved; that's about it).
-   */
-  struct snd_pcm_hw_params hwparams;
-  alsafd_hw_params_none(&hwparams);
-  hwparams.flags=SNDRV_PCM_HW_PARAMS_NORESAMPLE;
-  alsafd_hw_params_set_mask(&hwparams,SNDRV_PCM_HW_PARAM_ACCESS,SNDRV_PCM_ACCESS_RW_INTERLEAVED,1);
-  alsafd_hw_params_set_mask(&hwparams,SNDRV_PCM_HW_PARAM_FORMAT,SNDRV_PCM_FORMAT_S16,1);
-  alsafd_hw_params_set_mask(&hwparams,SNDRV_PCM_HW_PARAM_SUBFORMAT,SNDRV_PCM_SUBFORMAT_STD,1);
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_SAMPLE_BITS,16,16);
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_FRAME_BITS,0,UINT_MAX);
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_CHANNELS,ALSAFD_CHANC_MIN,ALSAFD_CHANC_MAX);
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_RATE,ALSAFD_RATE_MIN,ALSAFD_RATE_MAX);
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_PERIOD_TIME,0,UINT_MAX); // us between interrupts
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_PERIOD_SIZE,0,UINT_MAX); // frames between interrupts
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_PERIOD_BYTES,0,UINT_MAX); // bytes between interrupts
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_PERIODS,0,UINT_MAX); // interrupts per buffer
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_BUFFER_TIME,0,UINT_MAX); // us
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_BUFFER_SIZE,ALSAFD_BUF_MIN,ALSAFD_BUF_MAX); // frames
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_BUFFER_BYTES,0,UINT_MAX);
-  alsafd_hw_params_set_interval(&hwparams,SNDRV_PCM_HW_PARAM_TICK_TIME,0,UINT_MAX); // us
-              
-  if (ioctl(alsafd->fd,SNDRV_PCM_IOCTL_HW_REFINE,&hwparams)<0) {
+  alsafd_hw_params_init(hwparams,format,samplebits);
+  if (ioctl(alsafd->fd,SNDRV_PCM_IOCTL_HW_REFINE,hwparams)<0) {
+    if (quiet) return -1;
     return alsafd_error(alsafd,"SNDRV_PCM_IOCTL_HW_REFINE",0);
   }
-
   if (setup) {
-    if (setup->rate>0) alsafd_hw_params_set_nearest_interval(&hwparams,SNDRV_PCM_HW_PARAM_RATE,setup->rate);
-    if (setup->chanc>0) alsafd_hw_params_set_nearest_interval(&hwparams,SNDRV_PCM_HW_PARAM_CHANNELS,setup->chanc);
-    if (setup->buffersize>0) alsafd_hw_params_set_nearest_interval(&hwparams,SNDRV_PCM_HW_PARAM_BUFFER_SIZE,setup->buffersize);
+    if (setup->rate>0) alsafd_hw_params_set_nearest_interval(hwparams,SNDRV_PCM_HW_PARAM_RATE,setup->rate);
+    if (setup->chanc>0) alsafd_hw_params_set_nearest_interval(hwparams,SNDRV_PCM_HW_PARAM_CHANNELS,setup->chanc);
+    if (setup->buffersize>0) alsafd_hw_params_set_nearest_interval(hwparams,SNDRV_PCM_HW_PARAM_BUFFER_SIZE,setup->buffersize);
   }
-
-  if (ioctl(alsafd->fd,SNDRV_PCM_IOCTL_HW_PARAMS,&hwparams)<0) {
+  if (ioctl(alsafd->fd,SNDRV_PCM_IOCTL_HW_PARAMS,hwparams)<0) {
+    if (quiet) return -1;
     return alsafd_error(alsafd,"SNDRV_PCM_IOCTL_HW_PARAMS",0);
   }
+  return 0;
+}
+
+/* Init: With device open, send the handshake ioctls to configure it.
+ */
+ 
+static int alsafd_configure_device(
+  struct alsafd *alsafd,
+  const struct alsafd_setup *setup
+) {
+
+  // Float if the caller can produce it and the device takes it, otherwise s16.
+  struct snd_pcm_hw_params hwparams;
+  if (alsafd->delegate.pcm_outf&&(alsafd_hw_params_commit(alsafd,&hwparams,setup,SNDRV_PCM_FORMAT_FLOAT,32,1)>=0)) {
+    alsafd->floatout=1;
+  } else {
+    alsafd->floatout=0;
+    if (alsafd_hw_params_commit(alsafd,&hwparams,setup,SNDRV_PCM_FORMAT_S16,16,0)<0) return -1;
+  }
+  alsafd->samplesize=alsafd->floatout?sizeof(float):sizeof(int16_t);
 
   if (ioctl(alsafd->fd,SNDRV_PCM_IOCTL_PREPARE)<0) {
     return alsafd_error(alsafd,"SNDRV_PCM_IOCTL_PREPARE",0);
@@ -203,7 +231,7 @@ static int alsafd_configure_device(
   
   alsafd->bufa=(alsafd->hwbufframec*alsafd->chanc)>>1;
   if (alsafd->buf) free(alsafd->buf);
-  if (!(alsafd->buf=malloc(alsafd->bufa<<1))) return -1;
+  if (!(alsafd->buf=malloc(alsafd->bufa*alsafd->samplesize))) return -1;
   alsafd->buftime_s=(double)alsafd->hwbufframec/(double)alsafd->rate;
   
   /* Now set some driver software parameters.
@@ -321,6 +349,11 @@ int alsafd_get_running(const struct alsafd *alsafd) {
   return alsafd->running;
 }
 
+int alsafd_get_floatout(const struct alsafd *alsafd) {
+  if (!alsafd) return 0;
+  return alsafd->floatout;
+}
+
 void alsafd_set_running(struct alsafd *alsafd,int run) {
   if (!alsafd) return;
   alsafd->running=run?1:0;
@@ -25,6 +25,7 @@ static int _alsafd_init(struct hostio_audio *driver,const struct hostio_audio_se
   struct alsafd_delegate delegate={
     .userdata=driver,
     .pcm_out=(void*)driver->delegate.cb_pcm_out,
+    .pcm_outf=(void*)driver->delegate.cb_pcm_outf,
   };
   struct alsafd_setup asetup={
     .rate=setup->rate,
@@ -35,6 +36,7 @@ static int _alsafd_init(struct hostio_audio *driver,const struct hostio_audio_se
   if (!(DRIVER->alsafd=alsafd_new(&delegate,&asetup))) return -1;
   driver->rate=DRIVER->alsafd->rate;
   driver->chanc=DRIVER->alsafd->chanc;
+  driver->floatout=DRIVER->alsafd->floatout;
   return 0;
 }
 
@@ -37,8 +37,10 @@ struct alsafd {
   pthread_t iothd;
   pthread_mutex_t iomtx;
   int ioerror;
-  int16_t *buf;
+  void *buf; // int16_t, or float if (floatout).
   int bufa; // samples
+  int samplesize; // bytes
+  int floatout;
   int64_t buffer_time_us;
   double buftime_s;
 };
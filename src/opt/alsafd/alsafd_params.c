@@ -27,7 +27,7 @@ int alsafd_hw_params_get_mask(const struct snd_pcm_hw_params *params,int k,int b
   if (bit<0) return -1;
   if (bit>=SNDRV_MASK_MAX) return -1;
   const struct snd_mask *mask=params->masks+k-SNDRV_PCM_HW_PARAM_FIRST_MASK;
-  return (mask->bits[bit>>5]&(1<<bit&31))?1:0;
+  return (mask->bits[bit>>5]&(1<<(bit&31)))?1:0;
 }
 
 int alsafd_hw_params_get_interval(int *lo,int *hi,const struct snd_pcm_hw_params *params,int k) {
@@ -12,10 +12,14 @@ static void *asound_iothd(void *arg) {
       usleep(1000);
       continue;
     }
-    if (asound->playing&&asound->delegate.cb_pcm_out) {
+    if (!asound->playing) {
+      memset(asound->buf,0,asound->bufa*asound->samplesize);
+    } else if (asound->floatout) {
+      asound->delegate.cb_pcm_outf(asound->buf,asound->bufa,asound->delegate.userdata);
+    } else if (asound->delegate.cb_pcm_out) {
       asound->delegate.cb_pcm_out(asound->buf,asound->bufa,asound->delegate.userdata);
     } else {
-      memset(asound->buf,0,asound->bufa<<1);
+      memset(asound->buf,0,asound->bufa*asound->samplesize);
     }
     pthread_mutex_unlock(&asound->iomtx);
     asound->buffer_time_us=asound_now();
@@ -26,7 +30,7 @@ static void *asound_iothd(void *arg) {
       pthread_testcancel();
       int pvcancel;
       pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,&pvcancel);
-      int err=snd_pcm_writei(asound->alsa,asound->buf+framep*asound->chanc,framec-framep);
+      int err=snd_pcm_writei(asound->alsa,(char*)asound->buf+framep*asound->chanc*asound->samplesize,framec-framep);
       pthread_setcancelstate(pvcancel,0);
       if (err<=0) {
         if (snd_pcm_recover(asound->alsa,err,0)<0) return 0;
@@ -51,6 +55,34 @@ void asound_del(struct asound *asound) {
   free(asound);
 }
 
+/* Init: Negotiate and commit hardware params in one format.
+ * On failure, (rate,chanc,bufa_frames) are as they were, so we can try again with another.
+ */
+ 
+static int asound_hw_params_commit(struct asound *asound,snd_pcm_format_t format) {
+  unsigned int rate=asound->rate,chanc=asound->chanc;
+  snd_pcm_uframes_t bufa_frames=asound->bufa_frames;
+  snd_pcm_hw_params_t *hwparams=0;
+  if (
+    (snd_pcm_hw_params_malloc(&hwparams)<0)||
+    (snd_pcm_hw_params_any(asound->alsa,hwparams)<0)||
+    (snd_pcm_hw_params_set_access(asound->alsa,hwparams,SND_PCM_ACCESS_RW_INTERLEAVED)<0)||
+    (snd_pcm_hw_params_set_format(asound->alsa,hwparams,format)<0)||
+    (snd_pcm_hw_params_set_rate_near(asound->alsa,hwparams,&rate,0)<0)||
+    (snd_pcm_hw_params_set_channels_near(asound->alsa,hwparams,&chanc)<0)||
+    (snd_pcm_hw_params_set_buffer_size_near(asound->alsa,hwparams,&bufa_frames)<0)||
+    (snd_pcm_hw_params(asound->alsa,hwparams)<0)
+  ) {
+    snd_pcm_hw_params_free(hwparams);
+    return -1;
+  }
+  snd_pcm_hw_params_free(hwparams);
+  asound->rate=rate;
+  asound->chanc=chanc;
+  asound->bufa_frames=bufa_frames;
+  return 0;
+}
+
 /* Init.
  */
  
@@ -70,29 +102,24 @@ static int asound_init(struct asound *asound,const struct asound_setup *setup) {
 
   asound->bufa_frames=asound->rate/30;
 
-  snd_pcm_hw_params_t *hwparams=0;
-  if (
-    (snd_pcm_open(&asound->alsa,device,SND_PCM_STREAM_PLAYBACK,0)<0)||
-    (snd_pcm_hw_params_malloc(&hwparams)<0)||
-    (snd_pcm_hw_params_any(asound->alsa,hwparams)<0)||
-    (snd_pcm_hw_params_set_access(asound->alsa,hwparams,SND_PCM_ACCESS_RW_INTERLEAVED)<0)||
-    (snd_pcm_hw_params_set_format(asound->alsa,hwparams,SND_PCM_FORMAT_S16)<0)||
-    (snd_pcm_hw_params_set_rate_near(asound->alsa,hwparams,&asound->rate,0)<0)||
-    (snd_pcm_hw_params_set_channels_near(asound->alsa,hwparams,&asound->chanc)<0)||
-    (snd_pcm_hw_params_set_buffer_size_near(asound->alsa,hwparams,&asound->bufa_frames)<0)||
-    (snd_pcm_hw_params(asound->alsa,hwparams)<0)
-  ) {
-    snd_pcm_hw_params_free(hwparams);
-    return -1;
-  }
+  if (snd_pcm_open(&asound->alsa,device,SND_PCM_STREAM_PLAYBACK,0)<0) return -1;
   
-  snd_pcm_hw_params_free(hwparams);
+  // Float if the caller can produce it and the device takes it, otherwise s16.
+  // Testing the format isn't enough: A device can still refuse float at commit, with our rate or buffer size.
+  if (asound->delegate.cb_pcm_outf&&(asound_hw_params_commit(asound,SND_PCM_FORMAT_FLOAT)>=0)) {
+    asound->floatout=1;
+    asound->samplesize=sizeof(float);
+  } else {
+    asound->floatout=0;
+    asound->samplesize=sizeof(int16_t);
+    if (asound_hw_params_commit(asound,SND_PCM_FORMAT_S16)<0) return -1;
+  }
   
   if (snd_pcm_nonblock(asound->alsa,0)<0) return -1;
   if (snd_pcm_prepare(asound->alsa)<0) return -1;
 
   asound->bufa=asound->bufa_frames*asound->chanc;
-  if (!(asound->buf=malloc(asound->bufa*2))) return -1;
+  if (!(asound->buf=malloc(asound->bufa*asound->samplesize))) return -1;
   asound->buftime_s=(double)asound->bufa_frames/(double)asound->rate;
 
   pthread_mutexattr_t mattr;
@@ -109,6 +136,7 @@ static int asound_init(struct asound *asound,const struct asound_setup *setup) {
  */
  
 struct asound *asound_new(const struct asound_delegate *delegate,const struct asound_setup *setup) {
+  if (!delegate||!delegate->cb_pcm_out) return 0;
   struct asound *asound=calloc(1,sizeof(struct asound));
   if (!asound) return 0;
   asound->delegate=*delegate;
@@ -137,6 +165,11 @@ int asound_get_playing(const struct asound *asound) {
   return asound->playing;
 }
 
+int asound_get_floatout(const struct asound *asound) {
+  if (!asound) return 0;
+  return asound->floatout;
+}
+
 void asound_play(struct asound *asound,int play) {
   if (!asound) return;
   if (play) {
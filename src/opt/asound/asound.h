@@ -16,7 +16,8 @@ struct asound;
 
 struct asound_delegate {
   void *userdata;
-  void (*cb_pcm_out)(int16_t *v,int c,void *userdata);
+  void (*cb_pcm_out)(int16_t *v,int c,void *userdata); // Required, even with (cb_pcm_outf): Any device might refuse float.
+  void (*cb_pcm_outf)(float *v,int c,void *userdata); // Optional. If the device takes float32, we call this instead. Clamp to -1..1.
 };
 
 struct asound_setup {
@@ -36,6 +37,7 @@ struct asound *asound_new(const struct asound_delegate *delegate,const struct as
 int asound_get_rate(const struct asound *asound);
 int asound_get_chanc(const struct asound *asound);
 int asound_get_playing(const struct asound *asound);
+int asound_get_floatout(const struct asound *asound); // Nonzero if we're calling cb_pcm_outf.
 
 void asound_play(struct asound *asound,int play);
 int asound_lock(struct asound *asound);
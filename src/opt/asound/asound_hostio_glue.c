@@ -25,6 +25,7 @@ static int _asound_init(struct hostio_audio *driver,const struct hostio_audio_se
   struct asound_delegate delegate={
     .userdata=driver,
     .cb_pcm_out=(void*)driver->delegate.cb_pcm_out,
+    .cb_pcm_outf=(void*)driver->delegate.cb_pcm_outf,
   };
   struct asound_setup asetup={
     .rate=setup->rate,
@@ -35,6 +36,7 @@ static int _asound_init(struct hostio_audio *driver,const struct hostio_audio_se
   if (!(DRIVER->asound=asound_new(&delegate,&asetup))) return -1;
   driver->rate=DRIVER->asound->rate;
   driver->chanc=DRIVER->asound->chanc;
+  driver->floatout=DRIVER->asound->floatout;
   return 0;
 }
 
@@ -14,8 +14,10 @@ struct asound {
   int rate,chanc;
   int playing;
   snd_pcm_t *alsa;
-  int16_t *buf;
-  int bufa;
+  void *buf; // int16_t, or float if (floatout).
+  int bufa; // samples
+  int samplesize; // bytes
+  int floatout;
   snd_pcm_uframes_t bufa_frames;
   pthread_t iothd;
   pthread_mutex_t iomtx;
@@ -14,6 +14,11 @@ struct hostio_audio_setup;
 struct hostio_audio_delegate {
   void *userdata;
   void (*cb_pcm_out)(int16_t *v,int c,struct hostio_audio *driver);
+  /* OPTIONAL. Drivers that can, negotiate float32 output and call this instead of (cb_pcm_out).
+   * Keep it in -1..1; drivers pass it straight thru. Check (floatout) after init to see which you got.
+   * (cb_pcm_out) is still required: Any device might refuse float.
+   */
+  void (*cb_pcm_outf)(float *v,int c,struct hostio_audio *driver);
 };
 
 struct hostio_audio {
@@ -21,6 +26,7 @@ struct hostio_audio {
   struct hostio_audio_delegate delegate;
   int rate,chanc;
   int playing;
+  int floatout; // Nonzero if we call (delegate.cb_pcm_outf), otherwise (cb_pcm_out).
 };
 
 struct hostio_audio_setup {
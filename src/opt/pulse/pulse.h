@@ -15,8 +15,15 @@ struct pulse_delegate {
   
   /* You must write (c) samples to (v).
    * (c) is in samples as usual -- not frames, not bytes.
+   * Required even if you supply (pcm_outf), in case the server refuses float.
    */
   void (*pcm_out)(int16_t *v,int c,void *userdata);
+  
+  /* Optional. If present, we ask for float32 and call this instead.
+   * PulseAudio converts whatever it has to, so you should always get it.
+   * Clamp to -1..1 yourself; the server won't.
+   */
+  void (*pcm_outf)(float *v,int c,void *userdata);
 };
 
 struct pulse_setup {
@@ -40,6 +47,7 @@ void *pulse_get_userdata(const struct pulse *pulse);
 int pulse_get_rate(const struct pulse *pulse);
 int pulse_get_chanc(const struct pulse *pulse);
 int pulse_get_running(const struct pulse *pulse);
+int pulse_get_floatout(const struct pulse *pulse); // Nonzero if we're calling pcm_outf.
 
 void pulse_set_running(struct pulse *pulse,int running);
 
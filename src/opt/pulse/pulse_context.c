@@ -12,10 +12,12 @@ static void *pulse_iothd(void *arg) {
       usleep(1000);
       continue;
     }
-    if (pulse->running) {
-      pulse->delegate.pcm_out(pulse->buf,pulse->bufa,pulse->delegate.userdata);
+    if (!pulse->running) {
+      memset(pulse->buf,0,pulse->bufa*pulse->samplesize);
+    } else if (pulse->floatout) {
+      pulse->delegate.pcm_outf(pulse->buf,pulse->bufa,pulse->delegate.userdata);
     } else {
-      memset(pulse->buf,0,pulse->bufa<<1);
+      pulse->delegate.pcm_out(pulse->buf,pulse->bufa,pulse->delegate.userdata);
     }
     pthread_mutex_unlock(&pulse->iomtx);
     pulse->buffer_time_us=pulse_now();
@@ -24,7 +26,7 @@ static void *pulse_iothd(void *arg) {
     pthread_testcancel();
     int pvcancel;
     pthread_setcancelstate(PTHREAD_CANCEL_DISABLE,&pvcancel);
-    result=pa_simple_write(pulse->pa,pulse->buf,sizeof(int16_t)*pulse->bufa,&err);
+    result=pa_simple_write(pulse->pa,pulse->buf,pulse->samplesize*pulse->bufa,&err);
     pthread_setcancelstate(pvcancel,0);
     if (result<0) {
       pulse->ioerror=-1;
@@ -51,39 +53,20 @@ void pulse_del(struct pulse *pulse) {
   free(pulse);
 }
 
-/* Init PulseAudio client.
+/* Init PulseAudio client: Open the stream in one format.
  */
  
-static int pulse_init_pa(struct pulse *pulse,const struct pulse_setup *setup) {
+static int pulse_open(struct pulse *pulse,const char *servername,const char *appname,int buffersize,pa_sample_format_t format) {
   int err;
-  
-  const char *appname="Pulse Client";
-  const char *servername=0;
-  int buffersize=0;
-  if (setup) {
-    if (setup->rate>0) pulse->rate=setup->rate;
-    if (setup->chanc>0) pulse->chanc=setup->chanc;
-    if (setup->buffersize>0) buffersize=setup->buffersize;
-    if (setup->appname) appname=setup->appname;
-    if (setup->servername) servername=setup->servername;
-  }
-  if (pulse->rate<1) pulse->rate=44100;
-  if (pulse->chanc<1) pulse->chanc=2;
-  if (buffersize<1) buffersize=pulse->rate/20;
-  if (buffersize<20) buffersize=20;
-
+  pulse->samplesize=(format==PA_SAMPLE_FLOAT32NE)?sizeof(float):sizeof(int16_t);
   pa_sample_spec sample_spec={
-    #if BYTE_ORDER==BIG_ENDIAN
-      .format=PA_SAMPLE_S16BE,
-    #else
-      .format=PA_SAMPLE_S16LE,
-    #endif
+    .format=format,
     .rate=pulse->rate,
     .channels=pulse->chanc,
   };
   pa_buffer_attr buffer_attr={
-    .maxlength=pulse->chanc*sizeof(int16_t)*buffersize,
-    .tlength=pulse->chanc*sizeof(int16_t)*buffersize,
+    .maxlength=pulse->chanc*pulse->samplesize*buffersize,
+    .tlength=pulse->chanc*pulse->samplesize*buffersize,
     .prebuf=0xffffffff,
     .minreq=0xffffffff,
   };
@@ -108,6 +91,37 @@ static int pulse_init_pa(struct pulse *pulse,const struct pulse_setup *setup) {
   return 0;
 }
 
+/* Init PulseAudio client.
+ */
+ 
+static int pulse_init_pa(struct pulse *pulse,const struct pulse_setup *setup) {
+  
+  const char *appname="Pulse Client";
+  const char *servername=0;
+  int buffersize=0;
+  if (setup) {
+    if (setup->rate>0) pulse->rate=setup->rate;
+    if (setup->chanc>0) pulse->chanc=setup->chanc;
+    if (setup->buffersize>0) buffersize=setup->buffersize;
+    if (setup->appname) appname=setup->appname;
+    if (setup->servername) servername=setup->servername;
+  }
+  if (pulse->rate<1) pulse->rate=44100;
+  if (pulse->chanc<1) pulse->chanc=2;
+  if (buffersize<1) buffersize=pulse->rate/20;
+  if (buffersize<20) buffersize=20;
+  
+  // Float if the caller can produce it. The server converts, so it should always work, but fall back to s16 if not.
+  if (pulse->delegate.pcm_outf&&(pulse_open(pulse,servername,appname,buffersize,PA_SAMPLE_FLOAT32NE)>=0)) {
+    pulse->floatout=1;
+  } else {
+    pulse->floatout=0;
+    if (pulse_open(pulse,servername,appname,buffersize,PA_SAMPLE_S16NE)<0) return -1;
+  }
+  
+  return 0;
+}
+
 /* With the final rate and channel count settled, calculate a good buffer size and allocate it.
  */
  
@@ -128,7 +142,7 @@ static int pulse_init_buffer(struct pulse *pulse,const struct pulse_setup *setup
   // Reduce to next multiple of channel count.
   pulse->bufa-=pulse->bufa%pulse->chanc;
   
-  if (!(pulse->buf=malloc(sizeof(int16_t)*pulse->bufa))) {
+  if (!(pulse->buf=malloc(pulse->samplesize*pulse->bufa))) {
     return -1;
   }
   pulse->buftime_s=(double)(pulse->bufa/pulse->chanc)/(double)pulse->rate;
@@ -197,6 +211,11 @@ int pulse_get_running(const struct pulse *pulse) {
   return pulse->running;
 }
 
+int pulse_get_floatout(const struct pulse *pulse) {
+  if (!pulse) return 0;
+  return pulse->floatout;
+}
+
 void pulse_set_running(struct pulse *pulse,int running) {
   if (!pulse) return;
   pulse->running=running?1:0;
@@ -25,6 +25,7 @@ static int _pulse_init(struct hostio_audio *driver,const struct hostio_audio_set
   struct pulse_delegate delegate={
     .userdata=driver,
     .pcm_out=(void*)driver->delegate.cb_pcm_out,
+    .pcm_outf=(void*)driver->delegate.cb_pcm_outf,
   };
   struct pulse_setup psetup={
     .rate=setup->rate,
@@ -37,6 +38,7 @@ static int _pulse_init(struct hostio_audio *driver,const struct hostio_audio_set
   driver->rate=DRIVER->pulse->rate;
   driver->chanc=DRIVER->pulse->chanc;
   driver->playing=DRIVER->pulse->running;
+  driver->floatout=DRIVER->pulse->floatout;
   return 0;
 }
 
@@ -77,6 +77,17 @@ void render_draw_tile(
 
 void render_draw_to_main(struct render *render,int mainw,int mainh,int texid);
 
+/* GL calls for the last complete frame, ie everything up to the last render_draw_to_main.
+ * (callc) and (skipc) are state changes: bindings, viewport, program, uniforms, and vertex attribs.
+ * Skipped ones would not have changed anything.
+ */
+struct render_stats {
+  int drawc;
+  int callc;
+  int skipc;
+};
+void render_get_stats(struct render_stats *stats,const struct render *render);
+
 void render_coords_fb_from_screen(struct render *render,int *x,int *y);
 void render_coords_screen_from_fb(struct render *render,int *x,int *y);
 
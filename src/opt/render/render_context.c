@@ -3,7 +3,8 @@
 /* Delete.
  */
  
-static void render_texture_cleanup(struct render_texture *texture) {
+static void render_texture_cleanup(struct render *render,struct render_texture *texture) {
+  render_gl_forget(render,texture->texid,texture->fbid);
   if (texture->texid) glDeleteTextures(1,&texture->texid);
   if (texture->fbid) glDeleteFramebuffers(1,&texture->fbid);
 }
@@ -11,10 +12,11 @@ static void render_texture_cleanup(struct render_texture *texture) {
 void render_del(struct render *render) {
   if (!render) return;
   if (render->texturev) {
-    while (render->texturec-->0) render_texture_cleanup(render->texturev+render->texturec);
+    while (render->texturec-->0) render_texture_cleanup(render,render->texturev+render->texturec);
     free(render->texturev);
   }
   if (render->textmp) free(render->textmp);
+  if (render->batchv) free(render->batchv);
   free(render);
 }
 
@@ -34,6 +36,7 @@ struct render *render_new() {
     render_del(render);
     return 0;
   }
+  render_gl_invalidate_all(render);
   
   return render;
 }
@@ -42,10 +45,11 @@ struct render *render_new() {
  */
  
 void render_drop_textures(struct render *render) {
+  render_batch_flush(render);
   while (render->texturec>1) {
     render->texturec--;
     struct render_texture *texture=render->texturev+render->texturec;
-    render_texture_cleanup(texture);
+    render_texture_cleanup(render,texture);
   }
 }
 
@@ -63,9 +67,10 @@ int render_texid_by_index(const struct render *render,int p) {
 
 void render_texture_del(struct render *render,int texid) {
   if ((texid<2)||(texid>render->texturec)) return; // sic "<2", no deleting the main
+  render_batch_flush(render);
   texid--;
   struct render_texture *texture=render->texturev+texid;
-  render_texture_cleanup(texture);
+  render_texture_cleanup(render,texture);
   memset(texture,0,sizeof(struct render_texture));
 }
 
@@ -115,7 +120,7 @@ int render_texture_new(struct render *render) {
     }
   }
   
-  glBindTexture(GL_TEXTURE_2D,texture->texid);
+  render_gl_texture(render,texture->texid);
   glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_S,GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_WRAP_T,GL_CLAMP_TO_EDGE);
   glTexParameteri(GL_TEXTURE_2D,GL_TEXTURE_MIN_FILTER,GL_NEAREST);
@@ -211,7 +216,7 @@ static int render_texture_upload(struct render *render,struct render_texture *te
     default: return -1;
   }
   if (stride!=w*chanc) return -1;
-  glBindTexture(GL_TEXTURE_2D,texture->texid);
+  render_gl_texture(render,texture->texid);
   glTexImage2D(GL_TEXTURE_2D,0,ifmt,w,h,0,glfmt,type,v);
   texture->w=w;
   texture->h=h;
@@ -241,6 +246,7 @@ static int render_force_valid_png(struct render *render,struct png_image *image)
 int render_texture_load(struct render *render,int texid,int w,int h,int stride,int fmt,const void *src,int srcc) {
   if (!srcc) src=0;
   if ((texid<1)||(texid>render->texturec)) return -1;
+  render_batch_flush(render);
   struct render_texture *texture=render->texturev+texid-1;
   
   /* If format is completely unspecified, (src) may be an encoded image.
@@ -310,9 +316,10 @@ void render_texture_get_header(int *w,int *h,int *fmt,const struct render *rende
 void *render_texture_get_pixels(int *w,int *h,int *fmt,struct render *render,int texid) {
   if (!w||!h||!fmt) return 0;
   if ((texid<1)||(texid>render->texturec)) return 0;
+  render_batch_flush(render);
   struct render_texture *texture=render->texturev+texid-1;
   //if (!texture->fbid) return 0; // We can only read from textures that have an associated framebuffer.
-  if (render_texture_require_fb(texture)<0) return 0;
+  if (render_texture_require_fb(render,texture)<0) return 0;
   *w=texture->w;
   *h=texture->h;
   *fmt=texture->fmt;
@@ -328,7 +335,7 @@ void *render_texture_get_pixels(int *w,int *h,int *fmt,struct render *render,int
     case EGG_TEX_FMT_A1: break;
     default: free(dst); return 0;
   }
-  glBindFramebuffer(GL_FRAMEBUFFER,texture->fbid);
+  render_gl_framebuffer(render,texture->fbid);
   glReadPixels(0,0,texture->w,texture->h,glfmt,gltype,dst);
   return dst;
 }
@@ -336,16 +343,16 @@ void *render_texture_get_pixels(int *w,int *h,int *fmt,struct render *render,int
 /* Allocate framebuffer if needed.
  */
  
-int render_texture_require_fb(struct render_texture *texture) {
+int render_texture_require_fb(struct render *render,struct render_texture *texture) {
   if (texture->fbid) return 0;
   glGenFramebuffers(1,&texture->fbid);
   if (!texture->fbid) {
     glGenFramebuffers(1,&texture->fbid);
     if (!texture->fbid) return -1;
   }
-  glBindFramebuffer(GL_FRAMEBUFFER,texture->fbid);
+  // Leave it bound. Whoever asked for it is about to draw there.
+  render_gl_framebuffer(render,texture->fbid);
   glFramebufferTexture2D(GL_FRAMEBUFFER,GL_COLOR_ATTACHMENT0,GL_TEXTURE_2D,texture->texid,0);
-  glBindFramebuffer(GL_FRAMEBUFFER,0);
   return 0;
 }
 
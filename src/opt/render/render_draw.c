@@ -232,9 +232,10 @@ int render_init_programs(struct render *render) {
 
 void render_texture_clear(struct render *render,int texid) {
   if ((texid<1)||(texid>render->texturec)) return;
+  render_batch_flush(render);
   struct render_texture *texture=render->texturev+texid-1;
-  if (render_texture_require_fb(texture)<0) return;
-  glBindFramebuffer(GL_FRAMEBUFFER,texture->fbid);
+  if (render_texture_require_fb(render,texture)<0) return;
+  render_gl_framebuffer(render,texture->fbid);
   glClearColor(0.0f,0.0f,0.0f,0.0f);
   glClear(GL_COLOR_BUFFER_BIT);
 }
@@ -250,6 +251,92 @@ void render_alpha(struct render *render,uint8_t a) {
   render->alpha=a;
 }
 
+/* Flush batch.
+ * render_batch_draw uses the batch's state but takes vertices from the caller.
+ */
+ 
+static void render_batch_draw(struct render *render,const void *v,GLenum mode,int c) {
+  if ((render->batchdst<1)||(render->batchdst>render->texturec)) return;
+  struct render_texture *dsttex=render->texturev+render->batchdst-1;
+  render_gl_framebuffer(render,dsttex->fbid);
+  render_gl_viewport(render,0,0,dsttex->w,dsttex->h);
+  render_gl_attribs(render,3);
+  if (render->batch==RENDER_BATCH_RECT) {
+    const struct egg_draw_line *vtxv=v;
+    render_gl_program(render,render->pgm_raw);
+    render_gl_uniform_screensize(render,&render->u_raw,render->u_raw_screensize,dsttex->w,dsttex->h);
+    render_gl_uniform_tint(render,&render->u_raw,render->u_raw_tint,render->batchtint);
+    render_gl_uniform_alpha(render,&render->u_raw,render->u_raw_alpha,render->batchalpha/255.0f);
+    glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct egg_draw_line),&vtxv[0].x);
+    glVertexAttribPointer(1,4,GL_UNSIGNED_BYTE,1,sizeof(struct egg_draw_line),&vtxv[0].r);
+  } else {
+    const struct render_vertex_decal *vtxv=v;
+    struct render_texture *srctex=render->texturev+render->batchsrc-1;
+    render_gl_program(render,render->pgm_decal);
+    render_gl_uniform_screensize(render,&render->u_decal,render->u_decal_screensize,dsttex->w,dsttex->h);
+    render_gl_uniform_sampler(render,&render->u_decal,render->u_decal_sampler,0);
+    render_gl_texture(render,srctex->texid);
+    render_gl_uniform_tint(render,&render->u_decal,render->u_decal_tint,render->batchtint);
+    render_gl_uniform_alpha(render,&render->u_decal,render->u_decal_alpha,render->batchalpha/255.0f);
+    glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct render_vertex_decal),&vtxv[0].x);
+    glVertexAttribPointer(1,2,GL_FLOAT,0,sizeof(struct render_vertex_decal),&vtxv[0].tx);
+  }
+  render_gl_draw(render,mode,0,c);
+}
+ 
+void render_batch_flush(struct render *render) {
+  if (render->batchc<1) return;
+  int c=render->batchc;
+  render->batchc=0;
+  render_batch_draw(render,render->batchv,GL_TRIANGLES,c);
+}
+
+/* Add one quad to the batch, flushing first if it doesn't match.
+ * (src) is four vertices in triangle-strip order, same as we'd have drawn alone.
+ * They go in as two triangles, since strips can't be joined.
+ * If we can't grow the batch, draw what's there and then this quad alone, as a strip.
+ */
+ 
+static void render_batch_quad(struct render *render,int batch,int dsttexid,int srctexid,const void *src,int vtxsize) {
+  if (
+    (render->batchc>0)&&(
+      (render->batch!=batch)||
+      (render->batchdst!=dsttexid)||
+      (render->batchsrc!=srctexid)||
+      (render->batchtint!=render->tint)||
+      (render->batchalpha!=render->alpha)||
+      (render->batchc>RENDER_BATCH_LIMIT-6)
+    )
+  ) render_batch_flush(render);
+  if (render->batchc<1) {
+    render->batch=batch;
+    render->batchdst=dsttexid;
+    render->batchsrc=srctexid;
+    render->batchtint=render->tint;
+    render->batchalpha=render->alpha;
+  }
+  int na=(render->batchc+6)*vtxsize;
+  if (na>render->batcha) {
+    int a=RENDER_BATCH_LIMIT*sizeof(struct render_vertex_decal);
+    if (a<na) a=na;
+    void *nv=realloc(render->batchv,a);
+    if (!nv) {
+      render_batch_flush(render);
+      render_batch_draw(render,src,GL_TRIANGLE_STRIP,4);
+      return;
+    }
+    render->batchv=nv;
+    render->batcha=a;
+  }
+  uint8_t *dst=(uint8_t*)render->batchv+render->batchc*vtxsize;
+  const uint8_t *v=src;
+  memcpy(dst,v,vtxsize*3); dst+=vtxsize*3;
+  memcpy(dst,v+vtxsize*2,vtxsize); dst+=vtxsize;
+  memcpy(dst,v+vtxsize,vtxsize); dst+=vtxsize;
+  memcpy(dst,v+vtxsize*3,vtxsize);
+  render->batchc+=6;
+}
+
 /* Flat rect.
  */
 
@@ -257,26 +344,14 @@ void render_draw_rect(struct render *render,int texid,int x,int y,int w,int h,ui
   if ((texid<1)||(texid>render->texturec)) return;
   struct render_texture *texture=render->texturev+texid-1;
   uint8_t r=pixel>>24,g=pixel>>16,b=pixel>>8,a=pixel;
-  if (render_texture_require_fb(texture)<0) return;
-  glBindFramebuffer(GL_FRAMEBUFFER,texture->fbid);
-  glUseProgram(render->pgm_raw);
-  glViewport(0,0,texture->w,texture->h);
-  glUniform2f(render->u_raw_screensize,texture->w,texture->h);
-  glUniform4f(render->u_raw_tint,(render->tint>>24)/255.0f,((render->tint>>16)&0xff)/255.0f,((render->tint>>8)&0xff)/255.0f,(render->tint&0xff)/255.0f);
-  glUniform1f(render->u_raw_alpha,render->alpha/255.0f);
+  if (render_texture_require_fb(render,texture)<0) return;
   struct egg_draw_line vtxv[]={
     {x  ,y  ,r,g,b,a},
     {x,  y+h,r,g,b,a},
     {x+w,y  ,r,g,b,a},
     {x+w,y+h,r,g,b,a},
   };
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct egg_draw_line),&vtxv[0].x);
-  glVertexAttribPointer(1,4,GL_UNSIGNED_BYTE,1,sizeof(struct egg_draw_line),&vtxv[0].r);
-  glDrawArrays(GL_TRIANGLE_STRIP,0,4);
-  glDisableVertexAttribArray(0);
-  glDisableVertexAttribArray(1);
+  render_batch_quad(render,RENDER_BATCH_RECT,texid,0,vtxv,sizeof(struct egg_draw_line));
 }
 
 /* Line strip and triangle strip.
@@ -286,20 +361,18 @@ static void render_draw_raw(struct render *render,int texid,int mode,const struc
   if (c<1) return;
   if ((texid<1)||(texid>render->texturec)) return;
   struct render_texture *texture=render->texturev+texid-1;
-  if (render_texture_require_fb(texture)<0) return;
-  glBindFramebuffer(GL_FRAMEBUFFER,texture->fbid);
-  glUseProgram(render->pgm_raw);
-  glViewport(0,0,texture->w,texture->h);
-  glUniform2f(render->u_raw_screensize,texture->w,texture->h);
-  glUniform4f(render->u_raw_tint,(render->tint>>24)/255.0f,((render->tint>>16)&0xff)/255.0f,((render->tint>>8)&0xff)/255.0f,(render->tint&0xff)/255.0f);
-  glUniform1f(render->u_raw_alpha,render->alpha/255.0f);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
+  if (render_texture_require_fb(render,texture)<0) return;
+  render_batch_flush(render);
+  render_gl_framebuffer(render,texture->fbid);
+  render_gl_program(render,render->pgm_raw);
+  render_gl_viewport(render,0,0,texture->w,texture->h);
+  render_gl_uniform_screensize(render,&render->u_raw,render->u_raw_screensize,texture->w,texture->h);
+  render_gl_uniform_tint(render,&render->u_raw,render->u_raw_tint,render->tint);
+  render_gl_uniform_alpha(render,&render->u_raw,render->u_raw_alpha,render->alpha/255.0f);
+  render_gl_attribs(render,3);
   glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct egg_draw_line),&v[0].x);
   glVertexAttribPointer(1,4,GL_UNSIGNED_BYTE,1,sizeof(struct egg_draw_line),&v[0].r);
-  glDrawArrays(mode,0,c);
-  glDisableVertexAttribArray(0);
-  glDisableVertexAttribArray(1);
+  render_gl_draw(render,mode,0,c);
 }
 
 void render_draw_line(struct render *render,int texid,const struct egg_draw_line *v,int c) {
@@ -327,7 +400,7 @@ void render_draw_decal(
   struct render_texture *dsttex=render->texturev+dsttexid-1;
   struct render_texture *srctex=render->texturev+srctexid-1;
   if ((srctex->w<1)||(srctex->h<1)) return;
-  if (render_texture_require_fb(dsttex)<0) return;
+  if (render_texture_require_fb(render,dsttex)<0) return;
   int dstw=w,dsth=h;
   if (xform&EGG_XFORM_SWAP) {
     dstw=h;
@@ -366,20 +439,7 @@ void render_draw_decal(
       vtx->ty=ty0+ty1*vtx->ty;
     }
   }
-  glBindFramebuffer(GL_FRAMEBUFFER,dsttex->fbid);
-  glViewport(0,0,dsttex->w,dsttex->h);
-  glUseProgram(render->pgm_decal);
-  glUniform2f(render->u_decal_screensize,dsttex->w,dsttex->h);
-  glBindTexture(GL_TEXTURE_2D,srctex->texid);
-  glUniform4f(render->u_decal_tint,(render->tint>>24)/255.0f,((render->tint>>16)&0xff)/255.0f,((render->tint>>8)&0xff)/255.0f,(render->tint&0xff)/255.0f);
-  glUniform1f(render->u_decal_alpha,render->alpha/255.0f);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct render_vertex_decal),&vtxv[0].x);
-  glVertexAttribPointer(1,2,GL_FLOAT,0,sizeof(struct render_vertex_decal),&vtxv[0].tx);
-  glDrawArrays(GL_TRIANGLE_STRIP,0,4);
-  glDisableVertexAttribArray(0);
-  glDisableVertexAttribArray(1);
+  render_batch_quad(render,RENDER_BATCH_DECAL,dsttexid,srctexid,vtxv,sizeof(struct render_vertex_decal));
 }
 
 /* Decal with free scale and rotation.
@@ -399,7 +459,7 @@ void render_draw_decal_mode7(
   struct render_texture *dsttex=render->texturev+dsttexid-1;
   struct render_texture *srctex=render->texturev+srctexid-1;
   if ((srctex->w<1)||(srctex->h<1)) return;
-  if (render_texture_require_fb(dsttex)<0) return;
+  if (render_texture_require_fb(render,dsttex)<0) return;
   
   // Transform the output vertices right here, CPU-side.
   double cost=cos(-rotation);
@@ -428,20 +488,7 @@ void render_draw_decal_mode7(
     }
   }
   
-  glBindFramebuffer(GL_FRAMEBUFFER,dsttex->fbid);
-  glViewport(0,0,dsttex->w,dsttex->h);
-  glUseProgram(render->pgm_decal);
-  glUniform2f(render->u_decal_screensize,dsttex->w,dsttex->h);
-  glBindTexture(GL_TEXTURE_2D,srctex->texid);
-  glUniform4f(render->u_decal_tint,(render->tint>>24)/255.0f,((render->tint>>16)&0xff)/255.0f,((render->tint>>8)&0xff)/255.0f,(render->tint&0xff)/255.0f);
-  glUniform1f(render->u_decal_alpha,render->alpha/255.0f);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
-  glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct render_vertex_decal),&vtxv[0].x);
-  glVertexAttribPointer(1,2,GL_FLOAT,0,sizeof(struct render_vertex_decal),&vtxv[0].tx);
-  glDrawArrays(GL_TRIANGLE_STRIP,0,4);
-  glDisableVertexAttribArray(0);
-  glDisableVertexAttribArray(1);
+  render_batch_quad(render,RENDER_BATCH_DECAL,dsttexid,srctexid,vtxv,sizeof(struct render_vertex_decal));
 }
 
 /* Tiles.
@@ -457,33 +504,29 @@ void render_draw_tile(
   if ((srctexid<1)||(srctexid>render->texturec)) return;
   struct render_texture *dsttex=render->texturev+dsttexid-1;
   struct render_texture *srctex=render->texturev+srctexid-1;
-  if (render_texture_require_fb(dsttex)<0) return;
-  glBindFramebuffer(GL_FRAMEBUFFER,dsttex->fbid);
-  glViewport(0,0,dsttex->w,dsttex->h);
-  glUseProgram(render->pgm_tile);
-  glUniform2f(render->u_tile_screensize,dsttex->w,dsttex->h);
-  glActiveTexture(GL_TEXTURE0);
-  glUniform1i(render->u_tile_sampler,0);
-  glBindTexture(GL_TEXTURE_2D,srctex->texid);
-  glUniform4f(render->u_tile_tint,(render->tint>>24)/255.0f,((render->tint>>16)&0xff)/255.0f,((render->tint>>8)&0xff)/255.0f,(render->tint&0xff)/255.0f);
-  glUniform1f(render->u_tile_alpha,render->alpha/255.0f);
-  glUniform1f(render->u_tile_pointsize,srctex->w>>4);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
-  glEnableVertexAttribArray(2);
+  if (render_texture_require_fb(render,dsttex)<0) return;
+  render_batch_flush(render);
+  render_gl_framebuffer(render,dsttex->fbid);
+  render_gl_viewport(render,0,0,dsttex->w,dsttex->h);
+  render_gl_program(render,render->pgm_tile);
+  render_gl_uniform_screensize(render,&render->u_tile,render->u_tile_screensize,dsttex->w,dsttex->h);
+  render_gl_uniform_sampler(render,&render->u_tile,render->u_tile_sampler,0);
+  render_gl_texture(render,srctex->texid);
+  render_gl_uniform_tint(render,&render->u_tile,render->u_tile_tint,render->tint);
+  render_gl_uniform_alpha(render,&render->u_tile,render->u_tile_alpha,render->alpha/255.0f);
+  render_gl_uniform_pointsize(render,&render->u_tile,render->u_tile_pointsize,srctex->w>>4);
+  render_gl_attribs(render,7);
   glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct egg_draw_tile),&v[0].x);
   glVertexAttribPointer(1,1,GL_UNSIGNED_BYTE,0,sizeof(struct egg_draw_tile),&v[0].tileid);
   glVertexAttribPointer(2,1,GL_UNSIGNED_BYTE,0,sizeof(struct egg_draw_tile),&v[0].xform);
-  glDrawArrays(GL_POINTS,0,c);
-  glDisableVertexAttribArray(0);
-  glDisableVertexAttribArray(1);
-  glDisableVertexAttribArray(2);
+  render_gl_draw(render,GL_POINTS,0,c);
 }
 
 /* Draw to main.
  */
  
 void render_draw_to_main(struct render *render,int mainw,int mainh,int texid) {
+  render_batch_flush(render);
   if ((texid<1)||(texid>render->texturec)) return;
   struct render_texture *texture=render->texturev+texid-1;
   if ((texture->w<1)||(texture->h<1)) return;
@@ -517,26 +560,28 @@ void render_draw_to_main(struct render *render,int mainw,int mainh,int texid) {
     {dstx+w,dsty  ,1.0f,1.0f},
     {dstx+w,dsty+h,1.0f,0.0f},
   };
-  glBindFramebuffer(GL_FRAMEBUFFER,0);
-  glViewport(0,0,mainw,mainh);
+  render_gl_framebuffer(render,0);
+  render_gl_viewport(render,0,0,mainw,mainh);
   if ((w<mainw)||(h<mainh)) {
     glClearColor(0.0f,0.0f,0.0f,1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
   }
-  glUseProgram(render->pgm_decal);
-  glUniform2f(render->u_decal_screensize,mainw,mainh);
-  glUniform1i(render->u_decal_sampler,0);
-  glActiveTexture(GL_TEXTURE0);
-  glBindTexture(GL_TEXTURE_2D,texture->texid);
+  render_gl_program(render,render->pgm_decal);
+  render_gl_uniform_screensize(render,&render->u_decal,render->u_decal_screensize,mainw,mainh);
+  render_gl_uniform_sampler(render,&render->u_decal,render->u_decal_sampler,0);
+  render_gl_texture(render,texture->texid);
   glDisable(GL_BLEND);
-  glUniform4f(render->u_decal_tint,0.0f,0.0f,0.0f,0.0f);
-  glUniform1f(render->u_decal_alpha,1.0f);
-  glEnableVertexAttribArray(0);
-  glEnableVertexAttribArray(1);
+  render_gl_uniform_tint(render,&render->u_decal,render->u_decal_tint,0);
+  render_gl_uniform_alpha(render,&render->u_decal,render->u_decal_alpha,1.0f);
+  render_gl_attribs(render,3);
   glVertexAttribPointer(0,2,GL_SHORT,0,sizeof(struct render_vertex_decal),&vtxv[0].x);
   glVertexAttribPointer(1,2,GL_FLOAT,0,sizeof(struct render_vertex_decal),&vtxv[0].tx);
-  glDrawArrays(GL_TRIANGLE_STRIP,0,4);
-  glDisableVertexAttribArray(0);
-  glDisableVertexAttribArray(1);
+  render_gl_draw(render,GL_TRIANGLE_STRIP,0,4);
   glEnable(GL_BLEND);
+  
+  /* Leave attribs disabled for the video driver, and forget everything else, since it might change things too.
+   */
+  render_gl_attribs(render,0);
+  render_gl_invalidate(render);
+  render_gl_end_frame(render);
 }
@@ -18,6 +18,37 @@ struct render_vertex_decal {
   GLfloat tx,ty;
 };
 
+/* Consecutive rects, or consecutive decals with the same source, going to the same destination
+ * with the same tint and alpha, accumulate here and go out as one GL_TRIANGLES draw.
+ * Anything else that touches GL state or texture content must call render_batch_flush first.
+ */
+#define RENDER_BATCH_NONE 0
+#define RENDER_BATCH_RECT 1 /* egg_draw_line vertices, pgm_raw */
+#define RENDER_BATCH_DECAL 2 /* render_vertex_decal, pgm_decal */
+#define RENDER_BATCH_LIMIT 6144 /* Vertices, 6 per quad. */
+
+#define RENDER_ATTR_COUNT 3
+
+/* Last value we gave GL for each piece of state we touch, or -1 if unknown.
+ */
+struct render_glstate {
+  GLint fbid;
+  GLint vx,vy,vw,vh;
+  GLint program;
+  GLint activetexture; // Unit index, not GL_TEXTURE0.
+  GLint texid;
+  int attrmask;
+};
+
+// Same idea, one per program. NAN or -1 if unknown.
+struct render_uniforms {
+  GLfloat screensize[2];
+  GLfloat tint[4];
+  GLfloat alpha;
+  GLfloat pointsize;
+  GLint sampler;
+};
+
 struct render_texture {
   GLuint texid;
   GLuint fbid;
@@ -52,15 +83,48 @@ struct render {
   GLuint u_tile_tint;
   GLuint u_tile_pointsize;
   
+  struct render_glstate gl;
+  struct render_uniforms u_raw,u_decal,u_tile;
+  struct render_stats glstats; // Current frame.
+  struct render_stats glstats_frame; // Last complete frame.
+  
   // Temporary buffer for expanding 1-bit textures.
   void *textmp;
   int textmpa;
   
   // Frame of last output framebuffer, in window coords.
   int outx,outy,outw,outh;
+  
+  // Pending batch. Key fields are only meaningful while (batchc>0).
+  int batch; // RENDER_BATCH_*
+  int batchdst,batchsrc; // texid
+  uint32_t batchtint;
+  uint8_t batchalpha;
+  void *batchv;
+  int batchc; // Vertices.
+  int batcha; // Bytes.
 };
 
 int render_init_programs(struct render *render);
-int render_texture_require_fb(struct render_texture *texture);
+void render_batch_flush(struct render *render);
+int render_texture_require_fb(struct render *render,struct render_texture *texture);
+
+/* render_state.c: All GL state changes go through these, so we can skip the redundant ones.
+ */
+void render_gl_invalidate(struct render *render);
+void render_gl_invalidate_all(struct render *render);
+void render_gl_forget(struct render *render,GLuint texid,GLuint fbid);
+void render_gl_framebuffer(struct render *render,GLuint fbid);
+void render_gl_viewport(struct render *render,int x,int y,int w,int h);
+void render_gl_program(struct render *render,GLint program);
+void render_gl_texture(struct render *render,GLuint texid);
+void render_gl_attribs(struct render *render,int mask);
+void render_gl_uniform_screensize(struct render *render,struct render_uniforms *u,GLint loc,int w,int h);
+void render_gl_uniform_tint(struct render *render,struct render_uniforms *u,GLint loc,uint32_t rgba);
+void render_gl_uniform_alpha(struct render *render,struct render_uniforms *u,GLint loc,GLfloat alpha);
+void render_gl_uniform_pointsize(struct render *render,struct render_uniforms *u,GLint loc,GLfloat pointsize);
+void render_gl_uniform_sampler(struct render *render,struct render_uniforms *u,GLint loc,GLint unit);
+void render_gl_draw(struct render *render,GLenum mode,GLint first,GLsizei c);
+void render_gl_end_frame(struct render *render);
 
 #endif
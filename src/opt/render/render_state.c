@@ -0,0 +1,155 @@
+#include "render_internal.h"
+#include <math.h>
+
+/* Shadow GL state.
+ * Every state change in render goes through here, and we skip the ones that wouldn't change anything.
+ * Anything we don't own can change GL state behind our back, so render_gl_invalidate() forgets it all.
+ * Uniforms live in the program objects, which only we touch, so those survive invalidation.
+ */
+
+#define SKIP(cond) if (cond) { render->glstats.skipc++; return; } render->glstats.callc++;
+
+/* Invalidate.
+ */
+ 
+void render_gl_invalidate(struct render *render) {
+  render->gl.fbid=-1;
+  render->gl.vx=render->gl.vy=render->gl.vw=render->gl.vh=-1;
+  render->gl.program=-1;
+  render->gl.activetexture=-1;
+  render->gl.texid=-1;
+  render->gl.attrmask=-1;
+}
+
+static void render_uniforms_invalidate(struct render_uniforms *u) {
+  u->screensize[0]=u->screensize[1]=NAN;
+  u->tint[0]=u->tint[1]=u->tint[2]=u->tint[3]=NAN;
+  u->alpha=NAN;
+  u->pointsize=NAN;
+  u->sampler=-1;
+}
+
+void render_gl_invalidate_all(struct render *render) {
+  render_gl_invalidate(render);
+  render_uniforms_invalidate(&render->u_raw);
+  render_uniforms_invalidate(&render->u_decal);
+  render_uniforms_invalidate(&render->u_tile);
+}
+
+/* Forget a framebuffer or texture that's about to be deleted.
+ * GL reverts the binding to zero, and the name may come back for something else.
+ */
+ 
+void render_gl_forget(struct render *render,GLuint texid,GLuint fbid) {
+  if (texid&&(render->gl.texid==(GLint)texid)) render->gl.texid=-1;
+  if (fbid&&(render->gl.fbid==(GLint)fbid)) render->gl.fbid=-1;
+}
+
+/* Bindings.
+ */
+ 
+void render_gl_framebuffer(struct render *render,GLuint fbid) {
+  SKIP(render->gl.fbid==(GLint)fbid)
+  glBindFramebuffer(GL_FRAMEBUFFER,fbid);
+  render->gl.fbid=fbid;
+}
+
+void render_gl_viewport(struct render *render,int x,int y,int w,int h) {
+  SKIP((render->gl.vx==x)&&(render->gl.vy==y)&&(render->gl.vw==w)&&(render->gl.vh==h))
+  glViewport(x,y,w,h);
+  render->gl.vx=x;
+  render->gl.vy=y;
+  render->gl.vw=w;
+  render->gl.vh=h;
+}
+
+void render_gl_program(struct render *render,GLint program) {
+  SKIP(render->gl.program==program)
+  glUseProgram(program);
+  render->gl.program=program;
+}
+
+// We only ever use texture unit zero.
+void render_gl_texture(struct render *render,GLuint texid) {
+  if (render->gl.activetexture) {
+    render->glstats.callc++;
+    glActiveTexture(GL_TEXTURE0);
+    render->gl.activetexture=0;
+  }
+  SKIP(render->gl.texid==(GLint)texid)
+  glBindTexture(GL_TEXTURE_2D,texid);
+  render->gl.texid=texid;
+}
+
+void render_gl_attribs(struct render *render,int mask) {
+  int i=0,bit=1;
+  for (;i<RENDER_ATTR_COUNT;i++,bit<<=1) {
+    if ((render->gl.attrmask>=0)&&((render->gl.attrmask&bit)==(mask&bit))) {
+      render->glstats.skipc++;
+      continue;
+    }
+    render->glstats.callc++;
+    if (mask&bit) glEnableVertexAttribArray(i);
+    else glDisableVertexAttribArray(i);
+  }
+  render->gl.attrmask=mask;
+}
+
+/* Uniforms.
+ * The caller is responsible for having the right program in use.
+ */
+ 
+void render_gl_uniform_screensize(struct render *render,struct render_uniforms *u,GLint loc,int w,int h) {
+  SKIP((u->screensize[0]==w)&&(u->screensize[1]==h))
+  glUniform2f(loc,w,h);
+  u->screensize[0]=w;
+  u->screensize[1]=h;
+}
+
+void render_gl_uniform_tint(struct render *render,struct render_uniforms *u,GLint loc,uint32_t rgba) {
+  GLfloat r=(rgba>>24)/255.0f,g=((rgba>>16)&0xff)/255.0f,b=((rgba>>8)&0xff)/255.0f,a=(rgba&0xff)/255.0f;
+  SKIP((u->tint[0]==r)&&(u->tint[1]==g)&&(u->tint[2]==b)&&(u->tint[3]==a))
+  glUniform4f(loc,r,g,b,a);
+  u->tint[0]=r;
+  u->tint[1]=g;
+  u->tint[2]=b;
+  u->tint[3]=a;
+}
+
+void render_gl_uniform_alpha(struct render *render,struct render_uniforms *u,GLint loc,GLfloat alpha) {
+  SKIP(u->alpha==alpha)
+  glUniform1f(loc,alpha);
+  u->alpha=alpha;
+}
+
+void render_gl_uniform_pointsize(struct render *render,struct render_uniforms *u,GLint loc,GLfloat pointsize) {
+  SKIP(u->pointsize==pointsize)
+  glUniform1f(loc,pointsize);
+  u->pointsize=pointsize;
+}
+
+void render_gl_uniform_sampler(struct render *render,struct render_uniforms *u,GLint loc,GLint unit) {
+  SKIP(u->sampler==unit)
+  glUniform1i(loc,unit);
+  u->sampler=unit;
+}
+
+/* Draw.
+ */
+ 
+void render_gl_draw(struct render *render,GLenum mode,GLint first,GLsizei c) {
+  render->glstats.drawc++;
+  glDrawArrays(mode,first,c);
+}
+
+/* Frame boundary and stats.
+ */
+ 
+void render_gl_end_frame(struct render *render) {
+  render->glstats_frame=render->glstats;
+  memset(&render->glstats,0,sizeof(struct render_stats));
+}
+
+void render_get_stats(struct render_stats *stats,const struct render *render) {
+  *stats=render->glstats_frame;
+}
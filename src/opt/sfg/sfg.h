@@ -6,22 +6,49 @@
 #define SFG_H
 
 #include <stdint.h>
+#include <stddef.h>
+#include <stdatomic.h>
 
 struct sr_encoder;
 
 /* Dumb PCM dump.
+ * Safe to share across threads: Reference counting is atomic,
+ * and (ready) tells how many samples the printer has finished so far.
+ * Readers must not look beyond (ready), and should load it with acquire semantics.
+ * Printers always produce float. A finished one can be copied into compact int16 form,
+ * then exactly one of (v,iv) is set. Check (iv) first.
  ********************************************************/
 
 struct sfg_pcm {
-  int refc;
+  atomic_int refc;
+  atomic_int ready;
   int c;
-  float v[];
+  float *v; // Usually points just past this header, in the same allocation.
+  int16_t *iv; // If not null, we're compact: Samples are (iv[i]*iscale), and (v) is null.
+  float iscale;
+  void *map; // If not null, (v) points into this read-only file mapping.
+  size_t mapc;
 };
 
 void sfg_pcm_del(struct sfg_pcm *pcm);
 int sfg_pcm_ref(struct sfg_pcm *pcm);
 struct sfg_pcm *sfg_pcm_new(int c);
 
+/* Wrap a read-only mapping (eg from mmap) that contains (c) samples at (v).
+ * HANDOFF (map) on success; we munmap it when the last reference drops.
+ * The new pcm is fully ready.
+ */
+struct sfg_pcm *sfg_pcm_new_mapped(void *map,size_t mapc,const float *v,int c);
+
+/* New compact pcm with the same content as (src), which must be float and fully ready.
+ * Scaled to (src)'s peak, so loud sounds don't clip and quiet ones keep their resolution.
+ * The new pcm is fully ready. (src) is unchanged.
+ */
+struct sfg_pcm *sfg_pcm_compact(const struct sfg_pcm *src);
+
+// Bytes of sample data plus the header. Mapped ones count too, even though they're not on the heap.
+size_t sfg_pcm_size(const struct sfg_pcm *pcm);
+
 /* Printer.
  * You must supply an sfg sound in the binary format.
  *******************************************************/
@@ -38,11 +65,47 @@ struct sfg_printer *sfg_printer_new(int rate,const void *bin,int binc);
 struct sfg_pcm *sfg_printer_get_pcm(const struct sfg_printer *printer);
 
 /* Print at least (c) more samples, or stop at end of sound.
+ * Advances (pcm->ready) as it goes, so another thread can start reading before we finish.
  * Returns zero if more samples remain to be printed, nonzero if finished.
  * It's legal to call with (c<1), to only test for completion.
  */
 int sfg_printer_update(struct sfg_printer *printer,int c);
 
+/* Print voices on up to (threadc) threads, including the caller. Default 1.
+ * Each voice prints into a private buffer, then we sum them in order, so output is bit-identical to serial printing.
+ * Only worth it for long sounds with several voices: Updates shorter than a few thousand samples still run serially.
+ * Don't call during an update.
+ */
+int sfg_printer_set_threads(struct sfg_printer *printer,int threadc);
+
+/* Size of the signal graph as encoded (voicec0,opc0), and as we'll actually run it (voicec,opc).
+ * At decode, we fold constants, merge adjacent ops, drop ones that do nothing, and pick the simplest oscillators.
+ * Voices that can only produce silence are dropped entirely.
+ */
+struct sfg_printer_stats {
+  int voicec0,opc0;
+  int voicec,opc;
+};
+void sfg_printer_get_stats(struct sfg_printer_stats *stats,const struct sfg_printer *printer);
+
+/* Disable the decode-time optimizer, for printers created after, process-wide.
+ * Optimized output differs only in float rounding; this is for verifying that.
+ */
+void sfg_set_optimize(int enable);
+
+/* Force a specific set of inner-loop kernels: "scalar", "sse2", "avx2", "neon".
+ * Null or empty to use the best one for this CPU, which is the default.
+ * Applies to printers created after, process-wide. Don't call while another thread might be creating a printer.
+ * Fails if unknown or unsupported here, and nothing changes.
+ * All kernels print exactly the same thing; this is for benchmarking and verifying that.
+ */
+int sfg_set_simd(const char *name);
+
+/* Fill (v) with (c) seeds for xorshift32 generators, none of them zero, deterministically from (seed).
+ * splitmix32. Noise in synth seeds thru this too, so one seed means the same thing everywhere.
+ */
+void sfg_noise_seed_lanes(uint32_t *v,int c,uint32_t seed);
+
 /* Compiler.
  * Generate our binary format from our text format.
  ********************************************************/
@@ -7,10 +7,27 @@
  */
  
 static void sfg_generate_sine(float *v) {
-  float p=0.0f;
-  float dp=(M_PI*2.0f)/(float)SFG_WAVE_SIZE_SAMPLES;
-  int i=SFG_WAVE_SIZE_SAMPLES;
-  for (;i-->0;v++,p+=dp) *v=sinf(p);
+  // Phase from the index each time: Accumulating it in float drifts by 1.6e-5 toward the end.
+  int i=0;
+  for (;i<SFG_WAVE_SIZE_SAMPLES;i++,v++) *v=(float)sin((i*M_PI*2.0)/SFG_WAVE_SIZE_SAMPLES);
+}
+
+/* Shared sine table.
+ * Printers can run on any thread. The first one in builds it, and any others arriving meanwhile wait.
+ */
+ 
+float sfg_sine[SFG_WAVE_SIZE_SAMPLES];
+static atomic_int sfg_sine_state=0; // 0,1,2 = empty,building,ready
+ 
+void sfg_sine_require() {
+  if (atomic_load_explicit(&sfg_sine_state,memory_order_acquire)==2) return;
+  int expect=0;
+  if (atomic_compare_exchange_strong(&sfg_sine_state,&expect,1)) {
+    sfg_generate_sine(sfg_sine);
+    atomic_store_explicit(&sfg_sine_state,2,memory_order_release);
+  } else {
+    while (atomic_load_explicit(&sfg_sine_state,memory_order_acquire)!=2) ;
+  }
 }
 
 static void sfg_generate_square(float *v) {
@@ -66,21 +83,21 @@ static void sfg_apply_wave_harmonics(float *wave,const uint8_t *coefv,int coefc)
 static int sfg_printer_decode_op_level(struct sfg_op *op,struct sfg_voice *voice,struct sfg_printer *printer,const uint8_t *src,int srcc) {
   int srcp=sfg_env_decode(&op->env,src,srcc,printer->rate,1.0f/65535.0f);
   if (srcp<1) return -1;
-  op->update=sfg_op_level_update;
+  op->update=printer->simd->level;
   return srcp;
 }
   
 static int sfg_printer_decode_op_gain(struct sfg_op *op,struct sfg_voice *voice,struct sfg_printer *printer,const uint8_t *src,int srcc) {
   if (srcc<2) return -1;
   op->fv[0]=(float)src[0]+(float)src[1]/256.0f;
-  op->update=sfg_op_gain_update;
+  op->update=printer->simd->gain;
   return 2;
 }
   
 static int sfg_printer_decode_op_clip(struct sfg_op *op,struct sfg_voice *voice,struct sfg_printer *printer,const uint8_t *src,int srcc) {
   if (srcc<1) return -1;
   op->fv[0]=(float)src[0]/255.0f;
-  op->update=sfg_op_clip_update;
+  op->update=printer->simd->clip;
   return 1;
 }
   
@@ -94,7 +111,7 @@ static int sfg_printer_decode_op_delay(struct sfg_op *op,struct sfg_voice *voice
   op->fv[1]=src[3]/255.0f;
   op->fv[2]=src[4]/255.0f;
   op->fv[3]=src[5]/255.0f;
-  op->update=sfg_op_delay_update;
+  op->update=printer->simd->delay;
   return 6;
 }
   
@@ -110,7 +127,7 @@ static int sfg_printer_decode_op_bandpass(struct sfg_op *op,struct sfg_voice *vo
   op->fv[2]=r*r-k;
   op->fv[3]=2.0f*r*cosfreq;
   op->fv[4]=-r*r;
-  op->update=sfg_op_filter_update;
+  op->update=printer->simd->filter;
   return 4;
 }
   
@@ -126,7 +143,7 @@ static int sfg_printer_decode_op_notch(struct sfg_op *op,struct sfg_voice *voice
   op->fv[2]=k;
   op->fv[3]=2.0f*r*cosfreq;
   op->fv[4]=-r*r;
-  op->update=sfg_op_filter_update;
+  op->update=printer->simd->filter;
   return 4;
 }
   
@@ -150,7 +167,7 @@ static int sfg_printer_decode_op_lopass(struct sfg_op *op,struct sfg_voice *voic
   op->fv[2]=(x0*k*k-x1*k+x2)/d;
   op->fv[3]=(2.0f*k+y1+y1*k*k-2.0f*y2*k)/d;
   op->fv[4]=(-k*k-y1*k+y2)/d;
-  op->update=sfg_op_filter_update;
+  op->update=printer->simd->filter;
   return 2;
 }
   
@@ -174,7 +191,7 @@ static int sfg_printer_decode_op_hipass(struct sfg_op *op,struct sfg_voice *voic
   op->fv[2]=(x0*k*k-x1*k+x2)/d;
   op->fv[3]=-(2.0f*k+y1+y1*k*k-2.0f*y2*k)/d;
   op->fv[4]=(-k*k-y1*k+y2)/d;
-  op->update=sfg_op_filter_update;
+  op->update=printer->simd->filter;
   return 2;
 }
 
@@ -206,7 +223,6 @@ static int sfg_printer_decode_oscillator(struct sfg_voice *voice,struct sfg_prin
     if (srcp>srcc-4) return -1;
     voice->fmrate=(float)src[srcp]+(float)src[srcp+1]/256.0f; srcp+=2;
     fmscale=(float)src[srcp]+(float)src[srcp+1]/256.0f; srcp+=2;
-    voice->fmrate*=M_PI*2.0f; // radians, not a plain multiplier
   }
   
   if (features&0x08) {
@@ -229,7 +245,7 @@ static int sfg_printer_decode_oscillator(struct sfg_voice *voice,struct sfg_prin
     if (srcp>srcc-4) return -1;
     float ratelforate=(float)src[srcp]+(float)src[srcp+1]/256.0f; srcp+=2;
     int ratelfodepth=(src[srcp]<<8)|src[srcp+1]; srcp+=2; // cents
-    voice->ratelfodp=(ratelforate*M_PI*2.0f)/(float)printer->rate;
+    voice->ratelfodp=ratelforate/(float)printer->rate;
     voice->ratelforange=(float)ratelfodepth/1200.0f; // cents=>power of 2
   }
   
@@ -238,6 +254,7 @@ static int sfg_printer_decode_oscillator(struct sfg_voice *voice,struct sfg_prin
   // Noise or silence, all other params would be noop, don't bother. (we do have to read them, can't short circuit earlier than this).
   if (voice->shape==5) {
     voice->oscillate=sfg_oscillate_noise;
+    sfg_noise_seed(voice,(uint32_t)(voice-printer->voicev));
     return srcp;
   }
   if (voice->shape==6) {
@@ -261,7 +278,7 @@ static int sfg_printer_decode_oscillator(struct sfg_voice *voice,struct sfg_prin
   // Select the appropriate oscillator hook.
   if (!voice->rate.pointc&&!(features&0x24)) {
     // No rate envelope, rate LFO, or FM (no need to check the 'fmenv' bit 0x08).
-    voice->oscillate=sfg_oscillate_flat;
+    voice->oscillate=printer->simd->oscillate_flat;
     voice->cardpi=(uint32_t)(voice->rate.v*4294967296.0f);
   } else if (!(features&0x20)) {
     // No rate LFO.
@@ -322,6 +339,7 @@ static int sfg_printer_decode_voice(struct sfg_voice *voice,struct sfg_printer *
  
 int sfg_printer_decode(struct sfg_printer *printer,const uint8_t *src,int srcc) {
   if (!printer||printer->pcm||!src) return -1;
+  sfg_sine_require();
   
   /* Starts with fixed header:
    *   u16  Signature: 0xebeb
@@ -355,6 +373,8 @@ int sfg_printer_decode(struct sfg_printer *printer,const uint8_t *src,int srcc)
     if (!err) err=-1;
     if (err<0) return err;
     srcp+=err;
+    printer->voicec0++;
+    printer->opc0+=voice->opc;
     
     // If it uses the noop silence oscillator, drop the voice.
     if (voice->oscillate==sfg_oscillate_silence) {
@@ -363,5 +383,6 @@ int sfg_printer_decode(struct sfg_printer *printer,const uint8_t *src,int srcc)
     }
   }
   
+  sfg_printer_optimize(printer);
   return 0;
 }
@@ -1,5 +1,20 @@
 #include "sfg_internal.h"
 
+/* Return to the first leg.
+ */
+ 
+static void sfg_env_restart(struct sfg_env *env) {
+  env->v=env->v0;
+  env->pointp=0;
+  if (env->pointc>0) {
+    env->ttl=env->pointv[0].t;
+    env->dv=(env->pointv[0].v-env->v)/env->ttl;
+  } else {
+    env->ttl=INT_MAX;
+    env->dv=0.0f;
+  }
+}
+
 /* Decode.
  */
  
@@ -27,15 +42,7 @@ int sfg_env_decode(struct sfg_env *env,const uint8_t *src,int srcc,int rate,floa
     point->v=v;
     point->t=now+framec;
   }
-  env->v=env->v0;
-  env->pointp=0;
-  if (env->pointc>0) {
-    env->ttl=env->pointv[0].t;
-    env->dv=(env->pointv[0].v-env->v)/env->ttl;
-  } else {
-    env->ttl=INT_MAX;
-    env->dv=0.0f;
-  }
+  sfg_env_restart(env);
   return srcp;
 }
 
@@ -50,6 +57,17 @@ void sfg_env_constant(struct sfg_env *env,float v) {
   env->pointc=0;
 }
 
+/* Multiply all values.
+ */
+ 
+void sfg_env_scale(struct sfg_env *env,float scale) {
+  env->v0*=scale;
+  struct sfg_env_point *point=env->pointv;
+  int i=env->pointc;
+  for (;i-->0;point++) point->v*=scale;
+  sfg_env_restart(env);
+}
+
 /* Advance.
  */
  
@@ -67,3 +85,29 @@ void sfg_env_advance(struct sfg_env *env) {
     env->dv=(env->pointv[env->pointp].v-env->v)/env->ttl;
   }
 }
+
+/* Fill buffer.
+ */
+ 
+void sfg_env_fill(float *dst,int c,struct sfg_env *env) {
+  while (c>0) {
+    if (env->ttl<=0) {
+      sfg_env_advance(env);
+      *dst=env->v;
+      dst++;
+      c--;
+      continue;
+    }
+    int segc=(env->ttl<c)?env->ttl:c;
+    env->ttl-=segc;
+    c-=segc;
+    float v=env->v;
+    if (env->dv==0.0f) {
+      for (;segc-->0;dst++) *dst=v;
+    } else {
+      float dv=env->dv;
+      for (;segc-->0;dst++) *dst=(v+=dv);
+    }
+    env->v=v;
+  }
+}
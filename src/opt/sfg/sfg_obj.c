@@ -1,19 +1,22 @@
 #include "sfg_internal.h"
+#include <sys/mman.h>
 
 /* PCM dump.
  */
  
 void sfg_pcm_del(struct sfg_pcm *pcm) {
   if (!pcm) return;
-  if (pcm->refc-->1) return;
+  if (atomic_fetch_sub_explicit(&pcm->refc,1,memory_order_acq_rel)>1) return;
+  if (pcm->map) munmap(pcm->map,pcm->mapc);
   free(pcm);
 }
 
 int sfg_pcm_ref(struct sfg_pcm *pcm) {
   if (!pcm) return -1;
-  if (pcm->refc<1) return -1;
-  if (pcm->refc==INT_MAX) return -1;
-  pcm->refc++;
+  int refc=atomic_load_explicit(&pcm->refc,memory_order_relaxed);
+  if (refc<1) return -1;
+  if (refc==INT_MAX) return -1;
+  atomic_fetch_add_explicit(&pcm->refc,1,memory_order_relaxed);
   return 0;
 }
 
@@ -22,11 +25,67 @@ struct sfg_pcm *sfg_pcm_new(int c) {
   if (c>(INT_MAX-sizeof(struct sfg_pcm))/sizeof(float)) return 0;
   struct sfg_pcm *pcm=calloc(1,sizeof(struct sfg_pcm)+c*sizeof(float));
   if (!pcm) return 0;
-  pcm->refc=1;
+  atomic_init(&pcm->refc,1);
+  atomic_init(&pcm->ready,0);
   pcm->c=c;
+  pcm->v=(float*)(pcm+1);
   return pcm;
 }
 
+struct sfg_pcm *sfg_pcm_new_mapped(void *map,size_t mapc,const float *v,int c) {
+  if (!map||!v||(c<1)) return 0;
+  if ((const char*)v<(const char*)map) return 0;
+  if ((const char*)(v+c)>(const char*)map+mapc) return 0;
+  struct sfg_pcm *pcm=calloc(1,sizeof(struct sfg_pcm));
+  if (!pcm) return 0;
+  atomic_init(&pcm->refc,1);
+  atomic_init(&pcm->ready,c);
+  pcm->c=c;
+  pcm->v=(float*)v;
+  pcm->map=map;
+  pcm->mapc=mapc;
+  return pcm;
+}
+
+struct sfg_pcm *sfg_pcm_compact(const struct sfg_pcm *src) {
+  if (!src||!src->v||(src->c<1)) return 0;
+  if (atomic_load_explicit(&((struct sfg_pcm*)src)->ready,memory_order_acquire)<src->c) return 0;
+  if (src->c>(INT_MAX-sizeof(struct sfg_pcm))/sizeof(int16_t)) return 0;
+  struct sfg_pcm *pcm=calloc(1,sizeof(struct sfg_pcm)+src->c*sizeof(int16_t));
+  if (!pcm) return 0;
+  atomic_init(&pcm->refc,1);
+  atomic_init(&pcm->ready,src->c);
+  pcm->c=src->c;
+  pcm->iv=(int16_t*)(pcm+1);
+  float peak=0.0f;
+  const float *v=src->v;
+  int i=src->c;
+  for (;i-->0;v++) {
+    float a=(*v<0.0f)?-*v:*v;
+    if (a>peak) peak=a;
+  }
+  if (peak<=0.0f) {
+    pcm->iscale=1.0f/32767.0f;
+    return pcm;
+  }
+  pcm->iscale=peak/32767.0f;
+  float scale=32767.0f/peak;
+  int16_t *dst=pcm->iv;
+  for (v=src->v,i=src->c;i-->0;v++,dst++) {
+    int sample=lroundf((*v)*scale);
+    if (sample>32767) sample=32767;
+    else if (sample<-32767) sample=-32767;
+    *dst=sample;
+  }
+  return pcm;
+}
+
+size_t sfg_pcm_size(const struct sfg_pcm *pcm) {
+  if (!pcm) return 0;
+  if (pcm->iv) return sizeof(struct sfg_pcm)+sizeof(int16_t)*pcm->c;
+  return sizeof(struct sfg_pcm)+sizeof(float)*pcm->c;
+}
+
 /* Printer object.
  */
  
@@ -34,7 +93,7 @@ static void sfg_env_cleanup(struct sfg_env *env) {
   if (env->pointv) free(env->pointv);
 }
  
-static void sfg_op_cleanup(struct sfg_op *op) {
+void sfg_op_cleanup(struct sfg_op *op) {
   sfg_env_cleanup(&op->env);
   if (op->buf) free(op->buf);
 }
@@ -55,6 +114,7 @@ void sfg_printer_del(struct sfg_printer *printer) {
     while (printer->voicec-->0) sfg_voice_cleanup(printer->voicev+printer->voicec);
     free(printer->voicev);
   }
+  if (printer->vbuf) free(printer->vbuf);
   free(printer);
 }
 
@@ -63,6 +123,8 @@ struct sfg_printer *sfg_printer_new(int rate,const void *bin,int binc) {
   struct sfg_printer *printer=calloc(1,sizeof(struct sfg_printer));
   if (!printer) return 0;
   printer->rate=rate;
+  printer->threadc=1;
+  printer->simd=sfg_simd_get();
   if ((sfg_printer_decode(printer,bin,binc)<0)||!printer->pcm) {
     sfg_printer_del(printer);
     return 0;
@@ -0,0 +1,233 @@
+#include "sfg_internal.h"
+
+/* Decode-time optimizer.
+ * Sounds are encoded exactly as their authors wrote them, which is not necessarily the cheapest way to print them.
+ * After decoding, we rewrite each voice into something equivalent:
+ *  - Oscillators drop to the simplest variant that produces the same signal.
+ *  - Constant levels become gains. Gains fold into an adjacent level, or into the wave itself, or into each other.
+ *  - Gains of one, clips that can never trigger, and delays that can never echo go away.
+ *  - Voices that can only produce silence go away entirely.
+ * Output is the same, except that multiplications happen in a different order, so the low bits can differ.
+ */
+
+static int sfg_optimize_enable=1;
+
+void sfg_set_optimize(int enable) {
+  sfg_optimize_enable=enable?1:0;
+}
+
+/* Envelope helpers.
+ */
+
+static int sfg_env_is_constant(float *v,const struct sfg_env *env) {
+  const struct sfg_env_point *point=env->pointv;
+  int i=env->pointc;
+  for (;i-->0;point++) if (point->v!=env->v0) return 0;
+  *v=env->v0;
+  return 1;
+}
+
+static float sfg_env_peak(const struct sfg_env *env) {
+  float peak=(env->v0<0.0f)?-env->v0:env->v0;
+  const struct sfg_env_point *point=env->pointv;
+  int i=env->pointc;
+  for (;i-->0;point++) {
+    float v=(point->v<0.0f)?-point->v:point->v;
+    if (v>peak) peak=v;
+  }
+  return peak;
+}
+
+/* Op identification and removal.
+ * Op types are only recorded by their update hook.
+ */
+
+#define SFG_OP_IS(op,name) ((op)->update==printer->simd->name)
+
+static void sfg_voice_remove_op(struct sfg_voice *voice,int p) {
+  sfg_op_cleanup(voice->opv+p);
+  voice->opc--;
+  memmove(voice->opv+p,voice->opv+p+1,sizeof(struct sfg_op)*(voice->opc-p));
+}
+
+// Turn any op into a gain, dropping whatever it had allocated.
+static void sfg_op_become_gain(struct sfg_op *op,struct sfg_printer *printer,float gain) {
+  sfg_op_cleanup(op);
+  memset(op,0,sizeof(struct sfg_op));
+  op->fv[0]=gain;
+  op->update=printer->simd->gain;
+}
+
+/* Simplest oscillator that produces the same signal.
+ * A rate LFO with zero depth or zero rate is a multiplier of exactly one.
+ * FM with zero rate or zero range is a modulation of exactly zero.
+ */
+
+static void sfg_optimize_oscillator(struct sfg_voice *voice,struct sfg_printer *printer) {
+  if (voice->oscillate==sfg_oscillate_full) {
+    if ((voice->ratelforange==0.0f)||(voice->ratelfodp==0.0f)) {
+      voice->oscillate=sfg_oscillate_lfno;
+    }
+  }
+  if (voice->oscillate==sfg_oscillate_lfno) {
+    float rate,range;
+    if (!sfg_env_is_constant(&rate,&voice->rate)) return;
+    if ((rate<0.0f)||(rate>=1.0f)) return;
+    if ((voice->fmrate!=0.0f)&&(!sfg_env_is_constant(&range,&voice->range)||(range!=0.0f))) return;
+    voice->oscillate=printer->simd->oscillate_flat;
+    voice->cardpi=(uint32_t)(rate*4294967296.0f);
+  }
+}
+
+/* One pass of local rewrites over a voice's ops.
+ * Returns >0 if anything changed, 0 if not, or <0 if the voice is certainly silent.
+ */
+
+static int sfg_optimize_ops(struct sfg_voice *voice,struct sfg_printer *printer) {
+  int changed=0,i=0;
+  while (i<voice->opc) {
+    struct sfg_op *op=voice->opv+i;
+    struct sfg_op *next=(i<voice->opc-1)?(op+1):0;
+
+    if (SFG_OP_IS(op,level)) {
+      float v;
+      if (sfg_env_is_constant(&v,&op->env)) {
+        sfg_op_become_gain(op,printer,v);
+        changed=1;
+        continue;
+      }
+
+    } else if (SFG_OP_IS(op,gain)) {
+      float gain=op->fv[0];
+      if (gain==0.0f) return -1;
+      if (gain==1.0f) {
+        sfg_voice_remove_op(voice,i);
+        changed=1;
+        continue;
+      }
+      // Everything but noise reads from the wave, so a gain right after the oscillator can live there instead.
+      if (!i&&(voice->oscillate!=sfg_oscillate_noise)) {
+        float *v=voice->wave;
+        int c=SFG_WAVE_SIZE_SAMPLES;
+        for (;c-->0;v++) (*v)*=gain;
+        sfg_voice_remove_op(voice,i);
+        changed=1;
+        continue;
+      }
+      if (next&&SFG_OP_IS(next,gain)) {
+        next->fv[0]*=gain;
+        sfg_voice_remove_op(voice,i);
+        changed=1;
+        continue;
+      }
+      struct sfg_op *level=0;
+      if (next&&SFG_OP_IS(next,level)) level=next;
+      else if (i&&SFG_OP_IS(op-1,level)) level=op-1;
+      if (level) {
+        sfg_env_scale(&level->env,gain);
+        sfg_voice_remove_op(voice,i);
+        changed=1;
+        continue;
+      }
+
+    } else if (SFG_OP_IS(op,clip)) {
+      if (op->fv[0]<=0.0f) return -1;
+      if (next&&SFG_OP_IS(next,clip)) {
+        if (next->fv[0]>op->fv[0]) next->fv[0]=op->fv[0];
+        sfg_voice_remove_op(voice,i);
+        changed=1;
+        continue;
+      }
+
+    } else if (SFG_OP_IS(op,delay)) {
+      // If nothing gets stored, or nothing gets played back, the buffer stays silent and it's just a gain on the dry signal.
+      if ((op->fv[1]==0.0f)||(op->fv[2]==0.0f)) {
+        sfg_op_become_gain(op,printer,op->fv[0]);
+        changed=1;
+        continue;
+      }
+    }
+    i++;
+  }
+  return changed;
+}
+
+/* Track an upper bound for the signal's magnitude through the chain, and drop clips that it never reaches.
+ * Filters can resonate past their input, so we stop knowing anything after one.
+ * Returns <0 if the voice is certainly silent.
+ */
+
+static int sfg_optimize_clips(struct sfg_voice *voice,struct sfg_printer *printer) {
+  float bound=0.0f;
+  if (voice->oscillate==sfg_oscillate_noise) {
+    bound=1.0f;
+  } else {
+    const float *v=voice->wave;
+    int c=SFG_WAVE_SIZE_SAMPLES;
+    for (;c-->0;v++) {
+      float a=(*v<0.0f)?-*v:*v;
+      if (a>bound) bound=a;
+    }
+  }
+  if (bound<=0.0f) return -1;
+  int i=0;
+  while (i<voice->opc) {
+    struct sfg_op *op=voice->opv+i;
+    if (SFG_OP_IS(op,level)) {
+      bound*=sfg_env_peak(&op->env);
+    } else if (SFG_OP_IS(op,gain)) {
+      bound*=(op->fv[0]<0.0f)?-op->fv[0]:op->fv[0];
+    } else if (SFG_OP_IS(op,clip)) {
+      if (op->fv[0]>=bound) {
+        sfg_voice_remove_op(voice,i);
+        continue;
+      }
+      bound=op->fv[0];
+    } else if (SFG_OP_IS(op,delay)) {
+      float dry=fabsf(op->fv[0]),wet=fabsf(op->fv[1]),sto=fabsf(op->fv[2]),fbk=fabsf(op->fv[3]);
+      if (fbk>=1.0f) bound=INFINITY;
+      else bound=dry*bound+(wet*sto*bound)/(1.0f-fbk);
+    } else {
+      bound=INFINITY;
+    }
+    i++;
+  }
+  return 0;
+}
+
+/* Optimize, main entry point.
+ */
+
+void sfg_printer_optimize(struct sfg_printer *printer) {
+  if (!sfg_optimize_enable) return;
+  int i=printer->voicec;
+  while (i-->0) {
+    struct sfg_voice *voice=printer->voicev+i;
+    int err=0;
+    if (printer->master==0.0f) err=-1;
+    else {
+      sfg_optimize_oscillator(voice,printer);
+      while ((err=sfg_optimize_ops(voice,printer))>0) ;
+      if (!err) err=sfg_optimize_clips(voice,printer);
+    }
+    if (err<0) {
+      sfg_voice_cleanup(voice);
+      printer->voicec--;
+      memmove(voice,voice+1,sizeof(struct sfg_voice)*(printer->voicec-i));
+    }
+  }
+}
+
+/* Stats.
+ */
+
+void sfg_printer_get_stats(struct sfg_printer_stats *stats,const struct sfg_printer *printer) {
+  memset(stats,0,sizeof(struct sfg_printer_stats));
+  if (!printer) return;
+  stats->voicec0=printer->voicec0;
+  stats->opc0=printer->opc0;
+  stats->voicec=printer->voicec;
+  const struct sfg_voice *voice=printer->voicev;
+  int i=printer->voicec;
+  for (;i-->0;voice++) stats->opc+=voice->opc;
+}
@@ -0,0 +1,139 @@
+#include "sfg_internal.h"
+#include <pthread.h>
+#include <fenv.h>
+
+/* Parallel printing.
+ * Each voice prints a span into its own buffer, on whichever thread claims it.
+ * Workers start once per update and wait between spans, same handshake as synth_pool.
+ * Then the caller sums them in voice order and applies master, exactly the arithmetic sfg_printer_update does.
+ * Workers adopt the caller's floating-point environment, so denormal handling and rounding match too.
+ */
+
+struct sfg_parallel {
+  struct sfg_printer *printer;
+  int c;
+  atomic_int voicep;
+  fenv_t fenv;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond_start;
+  pthread_cond_t cond_done;
+  int generation;
+  int pending;
+  int quit;
+};
+
+static void sfg_parallel_run(struct sfg_parallel *ctx) {
+  struct sfg_printer *printer=ctx->printer;
+  for (;;) {
+    int p=atomic_fetch_add(&ctx->voicep,1);
+    if (p>=printer->voicec) break;
+    struct sfg_voice *voice=printer->voicev+p;
+    float *dst=printer->vbuf+p*SFG_PARALLEL_SPAN;
+    int c=ctx->c;
+    while (c>0) {
+      int updc=(c>SFG_BUFFER_SIZE)?SFG_BUFFER_SIZE:c;
+      sfg_voice_update(dst,updc,voice);
+      dst+=updc;
+      c-=updc;
+    }
+  }
+}
+
+static void *sfg_parallel_thread(void *arg) {
+  struct sfg_parallel *ctx=arg;
+  int generation=0;
+  fesetenv(&ctx->fenv);
+  pthread_mutex_lock(&ctx->mutex);
+  for (;;) {
+    while (!ctx->quit&&(ctx->generation==generation)) pthread_cond_wait(&ctx->cond_start,&ctx->mutex);
+    if (ctx->quit) break;
+    generation=ctx->generation;
+    pthread_mutex_unlock(&ctx->mutex);
+    sfg_parallel_run(ctx);
+    pthread_mutex_lock(&ctx->mutex);
+    if (!--(ctx->pending)) pthread_cond_signal(&ctx->cond_done);
+  }
+  pthread_mutex_unlock(&ctx->mutex);
+  return 0;
+}
+
+/* Set thread count.
+ */
+
+int sfg_printer_set_threads(struct sfg_printer *printer,int threadc) {
+  if (!printer) return -1;
+  if (threadc<1) threadc=1;
+  else if (threadc>SFG_THREAD_LIMIT) threadc=SFG_THREAD_LIMIT;
+  printer->threadc=threadc;
+  return 0;
+}
+
+/* Update with threads.
+ */
+
+int sfg_printer_update_parallel(struct sfg_printer *printer,int c) {
+  if (!printer->vbuf) {
+    if (printer->voicec>INT_MAX/sizeof(float)/SFG_PARALLEL_SPAN) return -1;
+    if (!(printer->vbuf=malloc(sizeof(float)*SFG_PARALLEL_SPAN*printer->voicec))) return -1;
+  }
+  int threadc=printer->threadc;
+  if (threadc>printer->voicec) threadc=printer->voicec;
+  struct sfg_parallel ctx={.printer=printer};
+  fegetenv(&ctx.fenv);
+  pthread_mutex_init(&ctx.mutex,0);
+  pthread_cond_init(&ctx.cond_start,0);
+  pthread_cond_init(&ctx.cond_done,0);
+  pthread_t threadv[SFG_THREAD_LIMIT];
+  int threadc_running=0;
+  while (threadc_running<threadc-1) {
+    if (pthread_create(threadv+threadc_running,0,sfg_parallel_thread,&ctx)) break;
+    threadc_running++;
+  }
+  
+  while (c>0) {
+    int updc=printer->pcm->c-printer->pcmp;
+    if (updc>c) updc=c;
+    if (updc>SFG_PARALLEL_SPAN) updc=SFG_PARALLEL_SPAN;
+    if (updc<1) break;
+
+    if (threadc_running>0) {
+      pthread_mutex_lock(&ctx.mutex);
+      ctx.c=updc;
+      atomic_store(&ctx.voicep,0);
+      ctx.pending=threadc_running;
+      ctx.generation++;
+      pthread_cond_broadcast(&ctx.cond_start);
+      pthread_mutex_unlock(&ctx.mutex);
+      sfg_parallel_run(&ctx);
+      pthread_mutex_lock(&ctx.mutex);
+      while (ctx.pending>0) pthread_cond_wait(&ctx.cond_done,&ctx.mutex);
+      pthread_mutex_unlock(&ctx.mutex);
+    } else {
+      ctx.c=updc;
+      atomic_store(&ctx.voicep,0);
+      sfg_parallel_run(&ctx);
+    }
+
+    float *dst=printer->pcm->v+printer->pcmp;
+    const float *src=printer->vbuf;
+    int i=printer->voicec;
+    for (;i-->0;src+=SFG_PARALLEL_SPAN) printer->simd->add(dst,src,updc);
+    printer->simd->mlt_s(dst,updc,printer->master);
+
+    printer->pcmp+=updc;
+    c-=updc;
+    atomic_store_explicit(&printer->pcm->ready,printer->pcmp,memory_order_release);
+  }
+  
+  if (threadc_running>0) {
+    pthread_mutex_lock(&ctx.mutex);
+    ctx.quit=1;
+    pthread_cond_broadcast(&ctx.cond_start);
+    pthread_mutex_unlock(&ctx.mutex);
+    while (threadc_running-->0) pthread_join(threadv[threadc_running],0);
+  }
+  pthread_cond_destroy(&ctx.cond_start);
+  pthread_cond_destroy(&ctx.cond_done);
+  pthread_mutex_destroy(&ctx.mutex);
+  return (printer->pcmp<printer->pcm->c)?0:1;
+}
@@ -0,0 +1,484 @@
+#include "sfg_internal.h"
+
+/* Which implementations are we compiling?
+ * Same rules as synth_simd.c: SSE2 is baseline on x86_64, AVX2 gets selected at runtime, NEON is decided at compile time.
+ * Every vector kernel does the same arithmetic in the same order as its scalar reference in sfg_update.c,
+ * so output should be identical, not just close. (No FMA; that would change the rounding).
+ */
+#if defined(__SSE2__)
+  #define SFG_SIMD_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define SFG_SIMD_SSE2 0
+#endif
+#if (defined(__x86_64__)||defined(__i386__))&&defined(__GNUC__)
+  #define SFG_SIMD_AVX2 1
+  #include <immintrin.h>
+  #define SFG_AVX2 __attribute__((target("avx2")))
+#else
+  #define SFG_SIMD_AVX2 0
+#endif
+#if defined(__ARM_NEON)
+  #define SFG_SIMD_NEON 1
+  #include <arm_neon.h>
+#else
+  #define SFG_SIMD_NEON 0
+#endif
+
+/* Scalar.
+ * The ops and oscillators live in sfg_update.c. Only the signal helpers are here.
+ *********************************************************************/
+
+static void sfg_simd_add_scalar(float *dst,const float *src,int c) {
+  for (;c-->0;dst++,src++) (*dst)+=(*src);
+}
+
+static void sfg_simd_mlt_s_scalar(float *v,int c,float a) {
+  for (;c-->0;v++) (*v)*=a;
+}
+
+static const struct sfg_simd sfg_simd_scalar={
+  .name="scalar",
+  .add=sfg_simd_add_scalar,
+  .mlt_s=sfg_simd_mlt_s_scalar,
+  .oscillate_flat=sfg_oscillate_flat,
+  .level=sfg_op_level_update,
+  .gain=sfg_op_gain_update,
+  .clip=sfg_op_clip_update,
+  .delay=sfg_op_delay_update,
+  .filter=sfg_op_filter_update,
+};
+
+/* Shared by all vector filters: The feedback half, which can't be vectorized.
+ * (v) has the feed-forward sums. Adds feedback in the scalar's order.
+ * Then sfg_filter_state() with (tmp), which has the two previous inputs and then (c) new ones, leaves state exactly as the scalar would.
+ */
+
+static inline void sfg_filter_feedback(float *v,int c,struct sfg_op *op) {
+  const float *coefv=op->fv;
+  float *statev=op->fv+5;
+  float y1=statev[3],y2=statev[4];
+  for (;c-->0;v++) {
+    *v=(*v)+y1*coefv[3]+y2*coefv[4];
+    y2=y1;
+    y1=*v;
+  }
+  statev[3]=y1;
+  statev[4]=y2;
+}
+
+static inline void sfg_filter_state(const float *tmp,int c,struct sfg_op *op) {
+  float *statev=op->fv+5;
+  statev[0]=tmp[c+1];
+  statev[1]=tmp[c];
+  statev[2]=tmp[c-1];
+}
+
+/* SSE2, 4 samples at a time.
+ **********************************************************************/
+
+#if SFG_SIMD_SSE2
+
+static void sfg_simd_add_sse2(float *dst,const float *src,int c) {
+  for (;c>=4;c-=4,dst+=4,src+=4) {
+    _mm_storeu_ps(dst,_mm_add_ps(_mm_loadu_ps(dst),_mm_loadu_ps(src)));
+  }
+  if (c>0) sfg_simd_add_scalar(dst,src,c);
+}
+
+static void sfg_simd_mlt_s_sse2(float *v,int c,float a) {
+  __m128 va=_mm_set1_ps(a);
+  for (;c>=4;c-=4,v+=4) {
+    _mm_storeu_ps(v,_mm_mul_ps(_mm_loadu_ps(v),va));
+  }
+  if (c>0) sfg_simd_mlt_s_scalar(v,c,a);
+}
+
+static void sfg_simd_oscillate_flat_sse2(float *v,int c,struct sfg_voice *voice) {
+  uint32_t p=voice->carpi,dp=voice->cardpi;
+  __m128i vp=_mm_set_epi32(p+dp*3,p+dp*2,p+dp,p);
+  __m128i vstep=_mm_set1_epi32(dp*4);
+  uint32_t ix[4];
+  for (;c>=4;c-=4,v+=4) {
+    _mm_storeu_si128((__m128i*)ix,_mm_srli_epi32(vp,SFG_WAVE_SHIFT));
+    _mm_storeu_ps(v,_mm_set_ps(voice->wave[ix[3]],voice->wave[ix[2]],voice->wave[ix[1]],voice->wave[ix[0]]));
+    vp=_mm_add_epi32(vp,vstep);
+  }
+  voice->carpi=(uint32_t)_mm_cvtsi128_si32(vp);
+  if (c>0) sfg_oscillate_flat(v,c,voice);
+}
+
+static void sfg_simd_level_sse2(float *v,int c,struct sfg_op *op) {
+  float levelv[SFG_BUFFER_SIZE];
+  sfg_env_fill(levelv,c,&op->env);
+  const float *level=levelv;
+  for (;c>=4;c-=4,v+=4,level+=4) {
+    _mm_storeu_ps(v,_mm_mul_ps(_mm_loadu_ps(v),_mm_loadu_ps(level)));
+  }
+  for (;c-->0;v++,level++) (*v)*=(*level);
+}
+
+static void sfg_simd_gain_sse2(float *v,int c,struct sfg_op *op) {
+  sfg_simd_mlt_s_sse2(v,c,op->fv[0]);
+}
+
+static void sfg_simd_clip_sse2(float *v,int c,struct sfg_op *op) {
+  __m128 hi=_mm_set1_ps(op->fv[0]);
+  __m128 lo=_mm_set1_ps(-op->fv[0]);
+  for (;c>=4;c-=4,v+=4) {
+    _mm_storeu_ps(v,_mm_max_ps(_mm_min_ps(_mm_loadu_ps(v),hi),lo));
+  }
+  if (c>0) sfg_op_clip_update(v,c,op);
+}
+
+/* Within one unwrapped run of the ring, every position is read and then written once,
+ * so four at a time is the same as one at a time.
+ */
+static void sfg_simd_delay_sse2(float *v,int c,struct sfg_op *op) {
+  __m128 dry=_mm_set1_ps(op->fv[0]);
+  __m128 wet=_mm_set1_ps(op->fv[1]);
+  __m128 sto=_mm_set1_ps(op->fv[2]);
+  __m128 fbk=_mm_set1_ps(op->fv[3]);
+  while (c>0) {
+    int runc=op->iv[0]-op->iv[1];
+    if (runc>c) runc=c;
+    float *buf=op->buf+op->iv[1];
+    int i=runc;
+    for (;i>=4;i-=4,v+=4,buf+=4) {
+      __m128 d=_mm_loadu_ps(v);
+      __m128 w=_mm_loadu_ps(buf);
+      _mm_storeu_ps(v,_mm_add_ps(_mm_mul_ps(d,dry),_mm_mul_ps(w,wet)));
+      _mm_storeu_ps(buf,_mm_add_ps(_mm_mul_ps(d,sto),_mm_mul_ps(w,fbk)));
+    }
+    for (;i-->0;v++,buf++) {
+      float d=*v,w=*buf;
+      *v=d*op->fv[0]+w*op->fv[1];
+      *buf=d*op->fv[2]+w*op->fv[3];
+    }
+    op->iv[1]+=runc;
+    if (op->iv[1]>=op->iv[0]) op->iv[1]=0;
+    c-=runc;
+  }
+}
+
+static void sfg_simd_filter_sse2(float *v,int c,struct sfg_op *op) {
+  if (c<1) return;
+  float tmp[SFG_BUFFER_SIZE+2];
+  tmp[0]=op->fv[6];
+  tmp[1]=op->fv[5];
+  memcpy(tmp+2,v,sizeof(float)*c);
+  __m128 c0=_mm_set1_ps(op->fv[0]);
+  __m128 c1=_mm_set1_ps(op->fv[1]);
+  __m128 c2=_mm_set1_ps(op->fv[2]);
+  float *dst=v;
+  const float *x=tmp+2;
+  int i=c;
+  for (;i>=4;i-=4,dst+=4,x+=4) {
+    __m128 sum=_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(x),c0),_mm_mul_ps(_mm_loadu_ps(x-1),c1));
+    _mm_storeu_ps(dst,_mm_add_ps(sum,_mm_mul_ps(_mm_loadu_ps(x-2),c2)));
+  }
+  for (;i-->0;dst++,x++) *dst=x[0]*op->fv[0]+x[-1]*op->fv[1]+x[-2]*op->fv[2];
+  sfg_filter_feedback(v,c,op);
+  sfg_filter_state(tmp,c,op);
+}
+
+static const struct sfg_simd sfg_simd_sse2={
+  .name="sse2",
+  .add=sfg_simd_add_sse2,
+  .mlt_s=sfg_simd_mlt_s_sse2,
+  .oscillate_flat=sfg_simd_oscillate_flat_sse2,
+  .level=sfg_simd_level_sse2,
+  .gain=sfg_simd_gain_sse2,
+  .clip=sfg_simd_clip_sse2,
+  .delay=sfg_simd_delay_sse2,
+  .filter=sfg_simd_filter_sse2,
+};
+
+#endif
+
+/* AVX2, 8 samples at a time, and a real gather for the oscillator.
+ **********************************************************************/
+
+#if SFG_SIMD_AVX2
+
+static SFG_AVX2 void sfg_simd_add_avx2(float *dst,const float *src,int c) {
+  for (;c>=8;c-=8,dst+=8,src+=8) {
+    _mm256_storeu_ps(dst,_mm256_add_ps(_mm256_loadu_ps(dst),_mm256_loadu_ps(src)));
+  }
+  if (c>0) sfg_simd_add_scalar(dst,src,c);
+}
+
+static SFG_AVX2 void sfg_simd_mlt_s_avx2(float *v,int c,float a) {
+  __m256 va=_mm256_set1_ps(a);
+  for (;c>=8;c-=8,v+=8) {
+    _mm256_storeu_ps(v,_mm256_mul_ps(_mm256_loadu_ps(v),va));
+  }
+  if (c>0) sfg_simd_mlt_s_scalar(v,c,a);
+}
+
+static SFG_AVX2 void sfg_simd_oscillate_flat_avx2(float *v,int c,struct sfg_voice *voice) {
+  uint32_t p=voice->carpi,dp=voice->cardpi;
+  __m256i vp=_mm256_add_epi32(_mm256_set1_epi32(p),_mm256_mullo_epi32(_mm256_set1_epi32(dp),_mm256_setr_epi32(0,1,2,3,4,5,6,7)));
+  __m256i vstep=_mm256_set1_epi32(dp*8);
+  for (;c>=8;c-=8,v+=8) {
+    _mm256_storeu_ps(v,_mm256_i32gather_ps(voice->wave,_mm256_srli_epi32(vp,SFG_WAVE_SHIFT),4));
+    vp=_mm256_add_epi32(vp,vstep);
+  }
+  voice->carpi=(uint32_t)_mm256_extract_epi32(vp,0);
+  if (c>0) sfg_oscillate_flat(v,c,voice);
+}
+
+static SFG_AVX2 void sfg_simd_level_avx2(float *v,int c,struct sfg_op *op) {
+  float levelv[SFG_BUFFER_SIZE];
+  sfg_env_fill(levelv,c,&op->env);
+  const float *level=levelv;
+  for (;c>=8;c-=8,v+=8,level+=8) {
+    _mm256_storeu_ps(v,_mm256_mul_ps(_mm256_loadu_ps(v),_mm256_loadu_ps(level)));
+  }
+  for (;c-->0;v++,level++) (*v)*=(*level);
+}
+
+static SFG_AVX2 void sfg_simd_gain_avx2(float *v,int c,struct sfg_op *op) {
+  sfg_simd_mlt_s_avx2(v,c,op->fv[0]);
+}
+
+static SFG_AVX2 void sfg_simd_clip_avx2(float *v,int c,struct sfg_op *op) {
+  __m256 hi=_mm256_set1_ps(op->fv[0]);
+  __m256 lo=_mm256_set1_ps(-op->fv[0]);
+  for (;c>=8;c-=8,v+=8) {
+    _mm256_storeu_ps(v,_mm256_max_ps(_mm256_min_ps(_mm256_loadu_ps(v),hi),lo));
+  }
+  if (c>0) sfg_op_clip_update(v,c,op);
+}
+
+static SFG_AVX2 void sfg_simd_delay_avx2(float *v,int c,struct sfg_op *op) {
+  __m256 dry=_mm256_set1_ps(op->fv[0]);
+  __m256 wet=_mm256_set1_ps(op->fv[1]);
+  __m256 sto=_mm256_set1_ps(op->fv[2]);
+  __m256 fbk=_mm256_set1_ps(op->fv[3]);
+  while (c>0) {
+    int runc=op->iv[0]-op->iv[1];
+    if (runc>c) runc=c;
+    float *buf=op->buf+op->iv[1];
+    int i=runc;
+    for (;i>=8;i-=8,v+=8,buf+=8) {
+      __m256 d=_mm256_loadu_ps(v);
+      __m256 w=_mm256_loadu_ps(buf);
+      _mm256_storeu_ps(v,_mm256_add_ps(_mm256_mul_ps(d,dry),_mm256_mul_ps(w,wet)));
+      _mm256_storeu_ps(buf,_mm256_add_ps(_mm256_mul_ps(d,sto),_mm256_mul_ps(w,fbk)));
+    }
+    for (;i-->0;v++,buf++) {
+      float d=*v,w=*buf;
+      *v=d*op->fv[0]+w*op->fv[1];
+      *buf=d*op->fv[2]+w*op->fv[3];
+    }
+    op->iv[1]+=runc;
+    if (op->iv[1]>=op->iv[0]) op->iv[1]=0;
+    c-=runc;
+  }
+}
+
+static SFG_AVX2 void sfg_simd_filter_avx2(float *v,int c,struct sfg_op *op) {
+  if (c<1) return;
+  float tmp[SFG_BUFFER_SIZE+2];
+  tmp[0]=op->fv[6];
+  tmp[1]=op->fv[5];
+  memcpy(tmp+2,v,sizeof(float)*c);
+  __m256 c0=_mm256_set1_ps(op->fv[0]);
+  __m256 c1=_mm256_set1_ps(op->fv[1]);
+  __m256 c2=_mm256_set1_ps(op->fv[2]);
+  float *dst=v;
+  const float *x=tmp+2;
+  int i=c;
+  for (;i>=8;i-=8,dst+=8,x+=8) {
+    __m256 sum=_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(x),c0),_mm256_mul_ps(_mm256_loadu_ps(x-1),c1));
+    _mm256_storeu_ps(dst,_mm256_add_ps(sum,_mm256_mul_ps(_mm256_loadu_ps(x-2),c2)));
+  }
+  for (;i-->0;dst++,x++) *dst=x[0]*op->fv[0]+x[-1]*op->fv[1]+x[-2]*op->fv[2];
+  sfg_filter_feedback(v,c,op);
+  sfg_filter_state(tmp,c,op);
+}
+
+static const struct sfg_simd sfg_simd_avx2={
+  .name="avx2",
+  .add=sfg_simd_add_avx2,
+  .mlt_s=sfg_simd_mlt_s_avx2,
+  .oscillate_flat=sfg_simd_oscillate_flat_avx2,
+  .level=sfg_simd_level_avx2,
+  .gain=sfg_simd_gain_avx2,
+  .clip=sfg_simd_clip_avx2,
+  .delay=sfg_simd_delay_avx2,
+  .filter=sfg_simd_filter_avx2,
+};
+
+#endif
+
+/* NEON, 4 samples at a time.
+ * vmlaq is not fused on every core, but it isn't guaranteed unfused either, so we multiply and add separately.
+ **********************************************************************/
+
+#if SFG_SIMD_NEON
+
+static void sfg_simd_add_neon(float *dst,const float *src,int c) {
+  for (;c>=4;c-=4,dst+=4,src+=4) {
+    vst1q_f32(dst,vaddq_f32(vld1q_f32(dst),vld1q_f32(src)));
+  }
+  if (c>0) sfg_simd_add_scalar(dst,src,c);
+}
+
+static void sfg_simd_mlt_s_neon(float *v,int c,float a) {
+  for (;c>=4;c-=4,v+=4) {
+    vst1q_f32(v,vmulq_n_f32(vld1q_f32(v),a));
+  }
+  if (c>0) sfg_simd_mlt_s_scalar(v,c,a);
+}
+
+static void sfg_simd_oscillate_flat_neon(float *v,int c,struct sfg_voice *voice) {
+  uint32_t p=voice->carpi,dp=voice->cardpi;
+  uint32_t pv[4]={p,p+dp,p+dp*2,p+dp*3};
+  uint32x4_t vp=vld1q_u32(pv);
+  uint32x4_t vstep=vdupq_n_u32(dp*4);
+  for (;c>=4;c-=4,v+=4) {
+    uint32x4_t ix=vshrq_n_u32(vp,SFG_WAVE_SHIFT);
+    float32x4_t sample=vdupq_n_f32(0.0f);
+    sample=vld1q_lane_f32(voice->wave+vgetq_lane_u32(ix,0),sample,0);
+    sample=vld1q_lane_f32(voice->wave+vgetq_lane_u32(ix,1),sample,1);
+    sample=vld1q_lane_f32(voice->wave+vgetq_lane_u32(ix,2),sample,2);
+    sample=vld1q_lane_f32(voice->wave+vgetq_lane_u32(ix,3),sample,3);
+    vst1q_f32(v,sample);
+    vp=vaddq_u32(vp,vstep);
+  }
+  voice->carpi=vgetq_lane_u32(vp,0);
+  if (c>0) sfg_oscillate_flat(v,c,voice);
+}
+
+static void sfg_simd_level_neon(float *v,int c,struct sfg_op *op) {
+  float levelv[SFG_BUFFER_SIZE];
+  sfg_env_fill(levelv,c,&op->env);
+  const float *level=levelv;
+  for (;c>=4;c-=4,v+=4,level+=4) {
+    vst1q_f32(v,vmulq_f32(vld1q_f32(v),vld1q_f32(level)));
+  }
+  for (;c-->0;v++,level++) (*v)*=(*level);
+}
+
+static void sfg_simd_gain_neon(float *v,int c,struct sfg_op *op) {
+  sfg_simd_mlt_s_neon(v,c,op->fv[0]);
+}
+
+static void sfg_simd_clip_neon(float *v,int c,struct sfg_op *op) {
+  float32x4_t hi=vdupq_n_f32(op->fv[0]);
+  float32x4_t lo=vdupq_n_f32(-op->fv[0]);
+  for (;c>=4;c-=4,v+=4) {
+    vst1q_f32(v,vmaxq_f32(vminq_f32(vld1q_f32(v),hi),lo));
+  }
+  if (c>0) sfg_op_clip_update(v,c,op);
+}
+
+static void sfg_simd_delay_neon(float *v,int c,struct sfg_op *op) {
+  while (c>0) {
+    int runc=op->iv[0]-op->iv[1];
+    if (runc>c) runc=c;
+    float *buf=op->buf+op->iv[1];
+    int i=runc;
+    for (;i>=4;i-=4,v+=4,buf+=4) {
+      float32x4_t d=vld1q_f32(v);
+      float32x4_t w=vld1q_f32(buf);
+      vst1q_f32(v,vaddq_f32(vmulq_n_f32(d,op->fv[0]),vmulq_n_f32(w,op->fv[1])));
+      vst1q_f32(buf,vaddq_f32(vmulq_n_f32(d,op->fv[2]),vmulq_n_f32(w,op->fv[3])));
+    }
+    for (;i-->0;v++,buf++) {
+      float d=*v,w=*buf;
+      *v=d*op->fv[0]+w*op->fv[1];
+      *buf=d*op->fv[2]+w*op->fv[3];
+    }
+    op->iv[1]+=runc;
+    if (op->iv[1]>=op->iv[0]) op->iv[1]=0;
+    c-=runc;
+  }
+}
+
+static void sfg_simd_filter_neon(float *v,int c,struct sfg_op *op) {
+  if (c<1) return;
+  float tmp[SFG_BUFFER_SIZE+2];
+  tmp[0]=op->fv[6];
+  tmp[1]=op->fv[5];
+  memcpy(tmp+2,v,sizeof(float)*c);
+  float *dst=v;
+  const float *x=tmp+2;
+  int i=c;
+  for (;i>=4;i-=4,dst+=4,x+=4) {
+    float32x4_t sum=vaddq_f32(vmulq_n_f32(vld1q_f32(x),op->fv[0]),vmulq_n_f32(vld1q_f32(x-1),op->fv[1]));
+    vst1q_f32(dst,vaddq_f32(sum,vmulq_n_f32(vld1q_f32(x-2),op->fv[2])));
+  }
+  for (;i-->0;dst++,x++) *dst=x[0]*op->fv[0]+x[-1]*op->fv[1]+x[-2]*op->fv[2];
+  sfg_filter_feedback(v,c,op);
+  sfg_filter_state(tmp,c,op);
+}
+
+static const struct sfg_simd sfg_simd_neon={
+  .name="neon",
+  .add=sfg_simd_add_neon,
+  .mlt_s=sfg_simd_mlt_s_neon,
+  .oscillate_flat=sfg_simd_oscillate_flat_neon,
+  .level=sfg_simd_level_neon,
+  .gain=sfg_simd_gain_neon,
+  .clip=sfg_simd_clip_neon,
+  .delay=sfg_simd_delay_neon,
+  .filter=sfg_simd_filter_neon,
+};
+
+#endif
+
+/* Runtime selection.
+ **********************************************************************/
+
+static const struct sfg_simd *sfg_simd_forced=0;
+
+static const struct sfg_simd *sfg_simd_best() {
+  #if SFG_SIMD_AVX2
+    if (__builtin_cpu_supports("avx2")) return &sfg_simd_avx2;
+  #endif
+  #if SFG_SIMD_SSE2
+    return &sfg_simd_sse2;
+  #endif
+  #if SFG_SIMD_NEON
+    return &sfg_simd_neon;
+  #endif
+  return &sfg_simd_scalar;
+}
+
+static const struct sfg_simd *sfg_simd_by_name(const char *name,int namec) {
+  if ((namec==6)&&!memcmp(name,"scalar",6)) return &sfg_simd_scalar;
+  #if SFG_SIMD_SSE2
+    if ((namec==4)&&!memcmp(name,"sse2",4)) return &sfg_simd_sse2;
+  #endif
+  #if SFG_SIMD_AVX2
+    if ((namec==4)&&!memcmp(name,"avx2",4)) {
+      if (!__builtin_cpu_supports("avx2")) return 0;
+      return &sfg_simd_avx2;
+    }
+  #endif
+  #if SFG_SIMD_NEON
+    if ((namec==4)&&!memcmp(name,"neon",4)) return &sfg_simd_neon;
+  #endif
+  return 0;
+}
+
+const struct sfg_simd *sfg_simd_get() {
+  if (sfg_simd_forced) return sfg_simd_forced;
+  return sfg_simd_best();
+}
+
+int sfg_set_simd(const char *name) {
+  if (!name||!name[0]) {
+    sfg_simd_forced=0;
+    return 0;
+  }
+  int namec=0;
+  while (name[namec]) namec++;
+  const struct sfg_simd *simd=sfg_simd_by_name(name,namec);
+  if (!simd) return -1;
+  sfg_simd_forced=simd;
+  return 0;
+}
@@ -1,15 +1,7 @@
 #include "sfg_internal.h"
 
-/* Signal arithmetic, good candidates for SIMD.
+/* Everything here is the scalar reference. Vector versions of some are in sfg_simd.c, and must match these exactly.
  */
- 
-static inline void sfg_signal_add(float *dst,const float *src,int c) {
-  for (;c-->0;dst++,src++) (*dst)+=(*src);
-}
-
-static inline void sfg_signal_mlt_s(float *v,int c,float a) {
-  for (;c-->0;v++) (*v)*=a;
-}
 
 /* Silence.
  */
@@ -21,8 +13,53 @@ void sfg_oscillate_silence(float *v,int c,struct sfg_voice *voice) {
 /* Noise.
  */
  
+void sfg_noise_seed_lanes(uint32_t *v,int c,uint32_t seed) {
+  for (;c-->0;v++) {
+    uint32_t z=(seed+=0x9e3779b9);
+    z=(z^(z>>16))*0x85ebca6b;
+    z=(z^(z>>13))*0xc2b2ae35;
+    z^=z>>16;
+    *v=z?z:0x6d2b79f5;
+  }
+}
+ 
+void sfg_noise_seed(struct sfg_voice *voice,uint32_t seed) {
+  sfg_noise_seed_lanes(voice->noise,SFG_NOISE_LANES,seed);
+  voice->noisep=SFG_NOISE_LANES;
+}
+ 
 void sfg_oscillate_noise(float *v,int c,struct sfg_voice *voice) {
-  for (;c-->0;v++) (*v)=((rand()&0xffff)-32768)/32768.0f;
+  uint32_t *s=voice->noise;
+  // Finish the previous step, so output doesn't depend on how we're sliced.
+  while ((voice->noisep<SFG_NOISE_LANES)&&(c>0)) {
+    *(v++)=(float)(int32_t)s[voice->noisep++]*(1.0f/2147483648.0f);
+    c--;
+  }
+  // Whole steps: Written to auto-vectorize, each lane is independent.
+  for (;c>=SFG_NOISE_LANES;c-=SFG_NOISE_LANES,v+=SFG_NOISE_LANES) {
+    int i=0;
+    for (;i<SFG_NOISE_LANES;i++) {
+      uint32_t x=s[i];
+      x^=x<<13;
+      x^=x>>17;
+      x^=x<<5;
+      s[i]=x;
+      v[i]=(float)(int32_t)x*(1.0f/2147483648.0f);
+    }
+  }
+  // Partial step: Advance every lane, emit what we need, and leave the rest for next time.
+  if (c>0) {
+    int i=0;
+    for (;i<SFG_NOISE_LANES;i++) {
+      uint32_t x=s[i];
+      x^=x<<13;
+      x^=x>>17;
+      x^=x<<5;
+      s[i]=x;
+    }
+    for (i=0;i<c;i++) v[i]=(float)(int32_t)s[i]*(1.0f/2147483648.0f);
+    voice->noisep=c;
+  }
 }
 
 /* Simplest tonal oscillator: No FM, rate envelope, or rate LFO.
@@ -39,16 +76,20 @@ void sfg_oscillate_flat(float *v,int c,struct sfg_voice *voice) {
  */
  
 void sfg_oscillate_lfno(float *v,int c,struct sfg_voice *voice) {
-  for (;c-->0;v++) {
+  float ratev[SFG_BUFFER_SIZE],rangev[SFG_BUFFER_SIZE];
+  sfg_env_fill(ratev,c,&voice->rate);
+  sfg_env_fill(rangev,c,&voice->range);
+  const float *rate=ratev,*range=rangev;
+  for (;c-->0;v++,rate++,range++) {
   
     // Acquire carrier rate.
-    float crate=sfg_env_update(&voice->rate);
+    float crate=*rate;
     
     // Acquire modulation.
-    float mod=sinf(voice->modp);
-    mod*=sfg_env_update(&voice->range);
+    float mod=sfg_sine_lookup(voice->modp);
+    mod*=*range;
     voice->modp+=crate*voice->fmrate;
-    if (voice->modp>=M_PI) voice->modp-=M_PI*2.0f;
+    if (voice->modp>=1.0f) voice->modp-=1.0f;
     
     // Acquire sample and advance carrier.
     int sp=voice->carp*SFG_WAVE_SIZE_SAMPLES;
@@ -64,19 +105,23 @@ void sfg_oscillate_lfno(float *v,int c,struct sfg_voice *voice) {
  */
  
 void sfg_oscillate_full(float *v,int c,struct sfg_voice *voice) {
-  for (;c-->0;v++) {
+  float ratev[SFG_BUFFER_SIZE],rangev[SFG_BUFFER_SIZE];
+  sfg_env_fill(ratev,c,&voice->rate);
+  sfg_env_fill(rangev,c,&voice->range);
+  const float *rate=ratev,*range=rangev;
+  for (;c-->0;v++,rate++,range++) {
   
     // Acquire carrier rate.
-    float crate=sfg_env_update(&voice->rate);
-    crate*=powf(2.0f,sinf(voice->ratelfop)*voice->ratelforange);
+    float crate=*rate;
+    crate*=sfg_exp2(sfg_sine_lookup(voice->ratelfop)*voice->ratelforange);
     voice->ratelfop+=voice->ratelfodp;
-    if (voice->ratelfop>=M_PI) voice->ratelfop-=M_PI*2.0f;
+    if (voice->ratelfop>=1.0f) voice->ratelfop-=1.0f;
     
     // Acquire modulation.
-    float mod=sinf(voice->modp);
-    mod*=sfg_env_update(&voice->range);
+    float mod=sfg_sine_lookup(voice->modp);
+    mod*=*range;
     voice->modp+=crate*voice->fmrate;
-    if (voice->modp>=M_PI) voice->modp-=M_PI*2.0f;
+    if (voice->modp>=1.0f) voice->modp-=1.0f;
     
     // Acquire sample and advance carrier.
     int sp=voice->carp*SFG_WAVE_SIZE_SAMPLES;
@@ -92,7 +137,10 @@ void sfg_oscillate_full(float *v,int c,struct sfg_voice *voice) {
  */
  
 void sfg_op_level_update(float *v,int c,struct sfg_op *op) {
-  for (;c-->0;v++) (*v)*=sfg_env_update(&op->env);
+  float levelv[SFG_BUFFER_SIZE];
+  sfg_env_fill(levelv,c,&op->env);
+  const float *level=levelv;
+  for (;c-->0;v++,level++) (*v)*=(*level);
 }
 
 /* Gain.
@@ -154,7 +202,7 @@ void sfg_op_filter_update(float *v,int c,struct sfg_op *op) {
  * Must overwrite (v).
  */
  
-static void sfg_voice_update(float *v,int c,struct sfg_voice *voice) {
+void sfg_voice_update(float *v,int c,struct sfg_voice *voice) {
   voice->oscillate(v,c,voice);
   struct sfg_op *op=voice->opv;
   int i=voice->opc;
@@ -168,8 +216,12 @@ int sfg_printer_update(struct sfg_printer *printer,int c) {
   if (!printer) return -1;
   if (printer->voicec<1) {
     printer->pcmp=printer->pcm->c;
+    atomic_store_explicit(&printer->pcm->ready,printer->pcmp,memory_order_release);
     return 1;
   }
+  if ((printer->threadc>1)&&(printer->voicec>1)&&(c>=SFG_PARALLEL_MIN)) {
+    return sfg_printer_update_parallel(printer,c);
+  }
   while (c>0) {
     int updc=printer->pcm->c-printer->pcmp;
     if (updc>c) updc=c;
@@ -182,12 +234,13 @@ int sfg_printer_update(struct sfg_printer *printer,int c) {
     int i=printer->voicec;
     for (;i-->0;voice++) {
       sfg_voice_update(tmp,updc,voice);
-      sfg_signal_add(dst,tmp,updc);
+      printer->simd->add(dst,tmp,updc);
     }
-    sfg_signal_mlt_s(dst,updc,printer->master);
+    printer->simd->mlt_s(dst,updc,printer->master);
     
     printer->pcmp+=updc;
     c-=updc;
+    atomic_store_explicit(&printer->pcm->ready,printer->pcmp,memory_order_release);
   }
   return (printer->pcmp<printer->pcm->c)?0:1;
 }
@@ -29,9 +29,15 @@ struct synth *synth_new(
 void synth_updatef(float *v,int c,struct synth *synth);
 void synth_updatei(int16_t *v,int c,struct synth *synth);
 
+/* For audio drivers that take float: synth_updatef, then scaled and clamped to match synth_updatei divided by 32768.
+ * So a game sounds the same, and clips the same, whichever format the device negotiates.
+ */
+void synth_updatef_clamped(float *v,int c,struct synth *synth);
+
 /* Begin a new song from songid (romr required) or raw serial data (Egg format).
  * (force) to play from the start even if already playing.
  * Playing from serial data, it's always "force".
+ * We decode the song completely up front and don't retain (src), so (safe_to_borrow) no longer matters.
  */
 void synth_play_song(struct synth *synth,int qual,int songid,int force,int repeat);
 void synth_play_song_serial(
@@ -41,6 +47,10 @@ void synth_play_song_serial(
   int repeat
 );
 
+/* synth_get_song, synth_get_playhead, and synth_get_duration are safe from any thread.
+ * They report the song as of the last update, or as of your last synth_post_play_song or synth_post_set_playhead if those haven't landed yet.
+ * Direct calls to synth_play_song and synth_set_playhead show up after the next update.
+ */
 void synth_get_song(int *qual,int *rid,int *repeat,const struct synth *synth);
 
 /* Play a fire-and-forget sound effect, from some resource.
@@ -59,7 +69,8 @@ void synth_play_sound_serial(
 );
 
 /* Current song time in beats, or -1 if no song.
- * This counter does return to zero when the song repeats.
+ * This counter returns to the loop point when the song repeats.
+ * It's consistent with synth_set_playhead: Setting the playhead you just read puts you back at the same spot.
  * Beware that this is not the whole picture, for reporting to the game: 
  * You should try to estimate how far into its last buffer the PCM driver is.
  * Give that to us as (adjust), in seconds: How much of the last buffer has not yet been delivered.
@@ -79,6 +90,17 @@ double synth_get_duration(struct synth *synth);
  */
 void synth_event(struct synth *synth,uint8_t chid,uint8_t opcode,uint8_t a,uint8_t b,int dur);
 
+/* Thread-safe alternatives to synth_play_song, synth_play_sound, synth_event, and synth_set_playhead.
+ * One thread may post, eg the game's main thread, while another runs synth_updatef. Nothing blocks.
+ * Commands land one update-length after the moment you post them, so their spacing in the output
+ * matches their spacing in real time, to the frame.
+ * Fails if the queue is full, and the command is dropped.
+ */
+int synth_post_play_song(struct synth *synth,int qual,int songid,int force,int repeat);
+int synth_post_play_sound(struct synth *synth,int qual,int soundid,float trim,float pan);
+int synth_post_event(struct synth *synth,uint8_t chid,uint8_t opcode,uint8_t a,uint8_t b);
+int synth_post_set_playhead(struct synth *synth,double beats);
+
 /* For live editor. Call this to replace the built-in config for pid 0.
  * Not available for any other pid.
  * struct synth_builtin is defined in synth_channel.h.
@@ -88,6 +110,116 @@ void synth_override_pid_0(struct synth *synth,const struct synth_builtin *builti
 
 void synth_clear_cache(struct synth *synth);
 
+/* Force a specific set of inner-loop kernels: "scalar", "sse2", "avx2", "neon".
+ * Null or empty to use the best one for this CPU, which is the default.
+ * Fails if unknown or unsupported here, and nothing changes.
+ * All kernels should produce the same output, give or take some float rounding.
+ */
+int synth_set_simd(struct synth *synth,const char *name);
+
+/* Spread the signal graph across (threadc) threads, including the caller.
+ * By default it's just one, everything runs on the thread that calls synth_updatef.
+ * Output is exactly the same regardless of thread count, so change whenever you like.
+ * Must not be called during an update.
+ */
+int synth_set_threads(struct synth *synth,int threadc);
+
+/* Add TPDF dither of +-1 LSB when synth_updatei converts to int16, and round to nearest instead of truncating.
+ * Trades a faint noise floor for no quantization distortion on quiet tails.
+ * Doesn't apply to synth_updatef.
+ * Off by default. Safe to toggle between updates.
+ */
+void synth_set_dither(struct synth *synth,int enable);
+
+/* Print sound effects on a background thread instead of during synth_updatef.
+ * Playbacks wait at the printer's edge if they catch up to it.
+ * The thread wakes as soon as a sound is requested, so that wait is one chunk of printing, not a polling interval.
+ * Off by default here, so tools get deterministic single-threaded output. The runner turns it on (--audio-bgprint=0 to not).
+ * Must not be called during an update.
+ */
+int synth_set_background_printing(struct synth *synth,int enable);
+
+/* Limit the time spent printing sound effects in each update, when not printing in the background.
+ * (fraction) of the update's real duration, eg 0.25 for a quarter of it. Zero for unlimited, the default.
+ * (samplec) caps the samples printed per update, all printers together. Zero for unlimited, the default.
+ * Either way, printers only run as far as their playbacks will read this update, sounds already underway first.
+ * What doesn't fit waits for the next update, and its playbacks hold position meanwhile: The sound is late instead of the callback.
+ * synth_get_stats reports how often that happens.
+ * Printers started during an update still catch up to it immediately, outside the budget.
+ * Only foreground printers are limited. With background printing on, that's just the sounds that overflow its queue.
+ * Safe to call any time outside an update.
+ */
+void synth_set_print_budget(struct synth *synth,double fraction,int samplec);
+
+/* Keep finished sounds in the cache as int16 instead of float, half the size. On by default.
+ * Each is scaled to its own peak, so there's no clipping, and the loss is below what an int16 output would lose anyway.
+ * Compacting never happens on the audio thread. The background printer does it for sounds it prints or reads from disk,
+ * and hands the copy over at the next update. Prewarm does it for the sounds it prints.
+ * So these stay float: Sounds printed in the foreground, and sounds prewarm maps from the disk cache (they're not on our heap).
+ * Disable if you need bit-exact output against earlier versions. Affects only sounds finished after.
+ */
+void synth_set_compact_cache(struct synth *synth,int enable);
+
+/* Limit the memory used by printed sounds we're holding on to, in bytes. Zero for unlimited, the default.
+ * Beyond it, we drop the least recently played ones, but never one that's still playing or printing.
+ * Must not be called during an update.
+ */
+void synth_set_cache_budget(struct synth *synth,int64_t bytes);
+
+/* Capacity for concurrent voices (tuned notes), procs (FX channels), and playbacks (sound effects and drums).
+ * Defaults are 32, 16, 16. Zero to leave one unchanged.
+ * When a list is full, a new object steals the slot of a released voice, or the quietest, or the oldest.
+ * Shrinking below the current count drops the excess immediately.
+ * Must not be called during an update.
+ */
+int synth_set_voice_limits(struct synth *synth,int voicec,int procc,int playbackc);
+
+/* Noisy voices draw from their own generators, seeded from a counter when the note begins.
+ * Given the same seed and the same events, output is exactly the same every time.
+ * Sound effects don't depend on this; they always print the same.
+ * Zero by default. Safe to call any time outside an update; it affects only notes started later.
+ */
+void synth_set_noise_seed(struct synth *synth,uint32_t seed);
+
+/* Counters for diagnostics.
+ * Not synchronized; read only when the audio thread is stopped, or accept some fuzz.
+ */
+struct synth_stats {
+  int cache_hitc; // synth_play_sound with the pcm already in memory.
+  int cache_missc; // ...not in memory (but maybe on disk).
+  int cache_evictc; // Sounds dropped to stay under budget.
+  int cache_soundc; // Sounds in memory now.
+  int64_t cache_bytes; // Their total size.
+  int voice_stealc; // Voices ended early to make room for a new one.
+  int proc_stealc; // ...procs.
+  int playback_stealc; // ...playbacks.
+  int print_missc; // Updates where a foreground printer fell behind its playback, per synth_set_print_budget.
+  int64_t print_lagc; // Total frames printers fell short, summed across updates.
+  int print_lag_max; // Most frames any one printer fell short in one update.
+};
+void synth_get_stats(struct synth_stats *stats,const struct synth *synth);
+
+/* Keep printed sounds in files under directory (path), and reuse them across runs.
+ * Files are keyed by a hash of the sound's encoded data, our rate, and the printer's version,
+ * so ROM changes and synth upgrades both invalidate them naturally.
+ * The audio thread never touches the disk. Reads happen at prewarm (mmapped, no copy) and on the background printer.
+ * So without background printing or prewarm, we only ever write to the cache, never read from it.
+ * Writes are from the background printer, prewarm, and synth_del (for sounds printed in the foreground).
+ * Opening prunes stale files and the least recently used, to keep the directory under 64 MB.
+ * Null or empty to disable, which is the default. Must not be called during an update.
+ */
+int synth_set_disk_cache(struct synth *synth,const char *path);
+
+/* Print every sound resource in the ROM right now, spread across (threadc) threads.
+ * (threadc<1) for one per CPU. Blocks until finished.
+ * Call before audio starts running; this is not safe against a concurrent synth_updatef.
+ * With fewer sounds than threads, the spares go to printing each sound's voices in parallel.
+ * Returns the count of sounds printed or loaded from the disk cache.
+ * If (bytes) not null, adds the size of the ones we printed to it.
+ * The cache budget still applies; with a budget smaller than the ROM's sounds, prewarming is mostly wasted.
+ */
+int synth_prewarm(struct synth *synth,int threadc,int64_t *bytes);
+
 int synth_channels_switcheroo(struct synth *synth,const void *src,int srcc);
 
 #endif
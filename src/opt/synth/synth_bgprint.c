@@ -0,0 +1,201 @@
+#include "synth_internal.h"
+
+/* Compact a finished sound and send it back to the audio thread.
+ * If the return ring is full, never mind. It stays float.
+ */
+ 
+static void synth_bgprint_return(struct synth_bgprint *bgprint,struct synth_bgprint_job *job,struct sfg_pcm *pcm) {
+  unsigned int tail=atomic_load_explicit(&bgprint->donetail,memory_order_relaxed);
+  unsigned int head=atomic_load_explicit(&bgprint->donehead,memory_order_acquire);
+  if (tail-head>=SYNTH_BGPRINT_RING_SIZE) return;
+  struct sfg_pcm *compact=sfg_pcm_compact(pcm);
+  if (!compact) return;
+  if (sfg_pcm_ref(pcm)<0) {
+    sfg_pcm_del(compact);
+    return;
+  }
+  struct synth_bgprint_done *done=bgprint->donev+(tail&(SYNTH_BGPRINT_RING_SIZE-1));
+  done->pcm=pcm;
+  done->compact=compact;
+  done->qual=job->qual;
+  done->soundid=job->soundid;
+  atomic_store_explicit(&bgprint->donetail,tail+1,memory_order_release);
+}
+
+/* Finish one job: Save it if warranted, compact it if requested, and delete the printer.
+ */
+ 
+static void synth_bgprint_finish(struct synth_bgprint *bgprint,struct synth_bgprint_job *job) {
+  struct sfg_pcm *pcm=sfg_printer_get_pcm(job->printer);
+  if (job->key&&bgprint->diskcache) {
+    synth_diskcache_save(bgprint->diskcache,job->key,pcm);
+  }
+  if (job->compact) synth_bgprint_return(bgprint,job,pcm);
+  sfg_printer_del(job->printer);
+}
+
+/* Check the disk cache for a new job.
+ * On a hit, the pcm is complete and we finish the job without saving. Returns nonzero if so.
+ * On a miss, record the key so we can save it when printed.
+ */
+ 
+static int synth_bgprint_lookup(struct synth_bgprint *bgprint,struct synth_bgprint_job *job) {
+  job->key=0;
+  if (!job->serial||!bgprint->diskcache) return 0;
+  uint64_t key=synth_diskcache_key(bgprint->diskcache,job->serial,job->serialc);
+  if (synth_diskcache_read(bgprint->diskcache,key,sfg_printer_get_pcm(job->printer))>0) {
+    synth_bgprint_finish(bgprint,job);
+    return 1;
+  }
+  job->key=key;
+  return 0;
+}
+
+/* Take new printers off the ring.
+ */
+ 
+static void synth_bgprint_receive(struct synth_bgprint *bgprint) {
+  unsigned int head=atomic_load_explicit(&bgprint->head,memory_order_relaxed);
+  unsigned int tail=atomic_load_explicit(&bgprint->tail,memory_order_acquire);
+  while (head!=tail) {
+    struct synth_bgprint_job *job=bgprint->ringv+(head&(SYNTH_BGPRINT_RING_SIZE-1));
+    if (synth_bgprint_lookup(bgprint,job)) {
+      head++;
+      continue;
+    }
+    if (bgprint->jobc>=bgprint->joba) {
+      int na=bgprint->joba+16;
+      void *nv=0;
+      if (na<=INT_MAX/sizeof(struct synth_bgprint_job)) nv=realloc(bgprint->jobv,sizeof(struct synth_bgprint_job)*na);
+      if (!nv) {
+        // Can't keep it. Print it all right now instead.
+        sfg_printer_update(job->printer,INT_MAX);
+        synth_bgprint_finish(bgprint,job);
+        head++;
+        continue;
+      }
+      bgprint->jobv=nv;
+      bgprint->joba=na;
+    }
+    bgprint->jobv[bgprint->jobc++]=*job;
+    head++;
+  }
+  atomic_store_explicit(&bgprint->head,head,memory_order_release);
+}
+
+/* Give each printer one turn.
+ */
+ 
+static void synth_bgprint_run(struct synth_bgprint *bgprint) {
+  int i=bgprint->jobc;
+  while (i-->0) {
+    struct synth_bgprint_job *job=bgprint->jobv+i;
+    if (sfg_printer_update(job->printer,SYNTH_BGPRINT_CHUNK)) {
+      synth_bgprint_finish(bgprint,job);
+      bgprint->jobc--;
+      memmove(job,job+1,sizeof(struct synth_bgprint_job)*(bgprint->jobc-i));
+    }
+  }
+}
+
+/* Thread main.
+ * Check the ring under the mutex before waiting, and the audio thread signals under it too, so no wakeup gets lost.
+ */
+ 
+static void *synth_bgprint_main(void *arg) {
+  struct synth_bgprint *bgprint=arg;
+  unsigned int fpstate=synth_denormals_disable();
+  while (!atomic_load(&bgprint->quit)) {
+    synth_bgprint_receive(bgprint);
+    if (bgprint->jobc>0) {
+      synth_bgprint_run(bgprint);
+      continue;
+    }
+    pthread_mutex_lock(&bgprint->mutex);
+    while (
+      !atomic_load(&bgprint->quit)&&
+      (atomic_load(&bgprint->head)==atomic_load(&bgprint->tail))
+    ) {
+      pthread_cond_wait(&bgprint->cond,&bgprint->mutex);
+    }
+    pthread_mutex_unlock(&bgprint->mutex);
+  }
+  synth_denormals_restore(fpstate);
+  return 0;
+}
+
+/* Delete.
+ */
+ 
+void synth_bgprint_del(struct synth_bgprint *bgprint) {
+  if (!bgprint) return;
+  pthread_mutex_lock(&bgprint->mutex);
+  atomic_store(&bgprint->quit,1);
+  pthread_cond_signal(&bgprint->cond);
+  pthread_mutex_unlock(&bgprint->mutex);
+  pthread_join(bgprint->thread,0);
+  synth_bgprint_receive(bgprint);
+  if (bgprint->jobv) {
+    while (bgprint->jobc-->0) {
+      struct synth_bgprint_job *job=bgprint->jobv+bgprint->jobc;
+      sfg_printer_update(job->printer,INT_MAX);
+      synth_bgprint_finish(bgprint,job);
+    }
+    free(bgprint->jobv);
+  }
+  struct synth_bgprint_done done;
+  while (synth_bgprint_collect(&done,bgprint)>0) {
+    sfg_pcm_del(done.pcm);
+    sfg_pcm_del(done.compact);
+  }
+  pthread_cond_destroy(&bgprint->cond);
+  pthread_mutex_destroy(&bgprint->mutex);
+  free(bgprint);
+}
+
+/* New.
+ */
+ 
+struct synth_bgprint *synth_bgprint_new(const struct synth_diskcache *diskcache) {
+  struct synth_bgprint *bgprint=calloc(1,sizeof(struct synth_bgprint));
+  if (!bgprint) return 0;
+  bgprint->diskcache=diskcache;
+  pthread_mutex_init(&bgprint->mutex,0);
+  pthread_cond_init(&bgprint->cond,0);
+  if (pthread_create(&bgprint->thread,0,synth_bgprint_main,bgprint)) {
+    pthread_cond_destroy(&bgprint->cond);
+    pthread_mutex_destroy(&bgprint->mutex);
+    free(bgprint);
+    return 0;
+  }
+  return bgprint;
+}
+
+/* Add printer.
+ */
+ 
+int synth_bgprint_add(struct synth_bgprint *bgprint,const struct synth_bgprint_job *job) {
+  unsigned int tail=atomic_load_explicit(&bgprint->tail,memory_order_relaxed);
+  unsigned int head=atomic_load_explicit(&bgprint->head,memory_order_acquire);
+  if (tail-head>=SYNTH_BGPRINT_RING_SIZE) return -1;
+  struct synth_bgprint_job *dst=bgprint->ringv+(tail&(SYNTH_BGPRINT_RING_SIZE-1));
+  *dst=*job;
+  dst->key=0;
+  atomic_store_explicit(&bgprint->tail,tail+1,memory_order_release);
+  pthread_mutex_lock(&bgprint->mutex);
+  pthread_cond_signal(&bgprint->cond);
+  pthread_mutex_unlock(&bgprint->mutex);
+  return 0;
+}
+
+/* Collect compacted sound.
+ */
+ 
+int synth_bgprint_collect(struct synth_bgprint_done *done,struct synth_bgprint *bgprint) {
+  unsigned int head=atomic_load_explicit(&bgprint->donehead,memory_order_relaxed);
+  unsigned int tail=atomic_load_explicit(&bgprint->donetail,memory_order_acquire);
+  if (head==tail) return 0;
+  *done=bgprint->donev[head&(SYNTH_BGPRINT_RING_SIZE-1)];
+  atomic_store_explicit(&bgprint->donehead,head+1,memory_order_release);
+  return 1;
+}
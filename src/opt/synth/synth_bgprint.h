@@ -0,0 +1,82 @@
+/* synth_bgprint.h
+ * Background thread for printing sound effects, so the audio thread doesn't have to.
+ * The audio thread hands off new printers thru a wait-free ring.
+ * It does take our mutex to signal, but we only ever hold that between checking the ring and waiting, never while printing.
+ * Printers advance their pcm's (ready) counter as they go, and playbacks hold position until it catches up.
+ * We print in small chunks round-robin, so a long sound doesn't hold up a short one.
+ * If there's a disk cache, we look each sound up there before printing it, and save it when finished.
+ * So the audio thread never touches the disk, or even hashes a sound.
+ * Finished sounds can be compacted here too, and handed back thru a second ring for the audio thread to swap into its cache.
+ */
+
+#ifndef SYNTH_BGPRINT_H
+#define SYNTH_BGPRINT_H
+
+#include <pthread.h>
+#include <stdatomic.h>
+
+struct sfg_printer;
+struct synth_diskcache;
+
+#define SYNTH_BGPRINT_RING_SIZE 64 /* Must be a power of two. */
+#define SYNTH_BGPRINT_CHUNK 1024 /* Frames per printer per turn. */
+
+struct synth_bgprint_job {
+  struct sfg_printer *printer;
+  const void *serial; // WEAK, from the ROM. Null if not for the disk cache.
+  int serialc;
+  int qual,soundid; // Cache entry, for (compact).
+  int compact; // Nonzero to return a compact copy when finished.
+  uint64_t key; // For (diskcache), or zero to not save. We compute it, off the audio thread.
+};
+
+/* A finished sound and its compact copy, on the way back to the audio thread.
+ * Both are STRONG. (pcm) is only for comparison, in case the cache entry was replaced meanwhile.
+ */
+struct synth_bgprint_done {
+  struct sfg_pcm *pcm;
+  struct sfg_pcm *compact;
+  int qual,soundid;
+};
+
+struct synth_bgprint {
+  const struct synth_diskcache *diskcache; // WEAK, optional.
+  pthread_t thread;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  atomic_int quit;
+  
+  // Handoff from the audio thread.
+  struct synth_bgprint_job ringv[SYNTH_BGPRINT_RING_SIZE];
+  atomic_uint head,tail;
+  
+  // Handoff back to the audio thread. We write (donetail), they write (donehead).
+  struct synth_bgprint_done donev[SYNTH_BGPRINT_RING_SIZE];
+  atomic_uint donehead,donetail;
+  
+  // Owned by the background thread.
+  struct synth_bgprint_job *jobv;
+  int jobc,joba;
+};
+
+/* Stops the thread, then finishes any printers in progress on the caller's thread.
+ * Their pcms might be referenced elsewhere, and nobody else is going to finish them.
+ */
+void synth_bgprint_del(struct synth_bgprint *bgprint);
+
+/* (diskcache) must outlive us.
+ */
+struct synth_bgprint *synth_bgprint_new(const struct synth_diskcache *diskcache);
+
+/* HANDOFF (job->printer) on success. We copy (job), and ignore (key).
+ * Fails only if the ring is full, then (printer) is still yours.
+ * (serial) to look up and save in the disk cache. It's what (printer) was made from, and must outlive us.
+ * Leave it null for sounds that don't come from the ROM.
+ */
+int synth_bgprint_add(struct synth_bgprint *bgprint,const struct synth_bgprint_job *job);
+
+/* Audio thread only: Take the next compacted sound, if there is one. Returns >0 if so, and (done) is yours.
+ */
+int synth_bgprint_collect(struct synth_bgprint_done *done,struct synth_bgprint *bgprint);
+
+#endif
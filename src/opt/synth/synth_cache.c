@@ -22,6 +22,7 @@ void synth_cache_del(struct synth_cache *cache) {
 struct synth_cache *synth_cache_new() {
   struct synth_cache *cache=calloc(1,sizeof(struct synth_cache));
   if (!cache) return 0;
+  cache->compact=1;
   return cache;
 }
 
@@ -80,9 +81,63 @@ int synth_cache_add(struct synth_cache *cache,int p,int qual,int soundid,struct
   entry->qual=qual;
   entry->soundid=soundid;
   entry->pcm=pcm;
+  entry->lastuse=++(cache->clock);
+  entry->size=sfg_pcm_size(pcm);
+  entry->unsaved=0;
+  cache->size+=entry->size;
   return 0;
 }
 
+/* Replace.
+ */
+ 
+int synth_cache_replace(struct synth_cache *cache,int p,struct sfg_pcm *pcm) {
+  if ((p<0)||(p>=cache->entryc)||!pcm) return -1;
+  if (sfg_pcm_ref(pcm)<0) return -1;
+  struct synth_cache_entry *entry=cache->entryv+p;
+  sfg_pcm_del(entry->pcm);
+  entry->pcm=pcm;
+  cache->size-=entry->size;
+  entry->size=sfg_pcm_size(pcm);
+  cache->size+=entry->size;
+  return 0;
+}
+
+/* Touch.
+ */
+ 
+void synth_cache_touch(struct synth_cache *cache,int p) {
+  if ((p<0)||(p>=cache->entryc)) return;
+  cache->entryv[p].lastuse=++(cache->clock);
+}
+
+/* Enforce budget.
+ * Linear search for the victim each time. We don't expect more than a few hundred entries, and evictions should be rare.
+ */
+ 
+int synth_cache_enforce_budget(struct synth_cache *cache) {
+  if (cache->budget<=0) return 0;
+  int evictc=0;
+  while (cache->size>cache->budget) {
+    struct synth_cache_entry *victim=0;
+    struct synth_cache_entry *entry=cache->entryv;
+    int i=cache->entryc;
+    for (;i-->0;entry++) {
+      if (atomic_load_explicit(&entry->pcm->refc,memory_order_acquire)>1) continue;
+      if (!victim||(entry->lastuse<victim->lastuse)) victim=entry;
+    }
+    if (!victim) break;
+    cache->size-=victim->size;
+    synth_cache_entry_cleanup(victim);
+    cache->entryc--;
+    int p=victim-cache->entryv;
+    memmove(victim,victim+1,sizeof(struct synth_cache_entry)*(cache->entryc-p));
+    cache->evictc++;
+    evictc++;
+  }
+  return evictc;
+}
+
 /* Clear.
  */
  
@@ -92,4 +147,5 @@ void synth_cache_clear(struct synth_cache *cache) {
     cache->entryc--;
     synth_cache_entry_cleanup(cache->entryv+cache->entryc);
   }
+  cache->size=0;
 }
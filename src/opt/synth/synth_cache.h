@@ -1,6 +1,8 @@
 /* synth_cache.h
  * Holds PCM objects we've printed.
  * Print may be in progress, one never really knows.
+ * With a nonzero (budget), we evict the least recently used entries to stay under it.
+ * Entries referenced by anyone else (a playback or a printer) are never evicted, so we might exceed the budget temporarily.
  */
 
 #ifndef SYNTH_CACHE_H
@@ -12,8 +14,16 @@ struct synth_cache {
   struct synth_cache_entry {
     int qual,soundid;
     struct sfg_pcm *pcm;
+    int64_t lastuse; // (clock) at last add or touch.
+    int size; // Bytes.
+    int unsaved; // Owner's business. synth uses it for sounds not yet in the disk cache.
   } *entryv;
   int entryc,entrya;
+  int64_t budget; // Bytes, or zero for unlimited.
+  int64_t size; // Sum of entry sizes.
+  int64_t clock;
+  int hitc,missc,evictc; // (hitc,missc) are for the owner to maintain; we don't know what a hit is.
+  int compact; // Nonzero (the default) if finished sounds should be replaced with int16 copies. Policy only; others do the work.
 };
 
 void synth_cache_del(struct synth_cache *cache);
@@ -26,6 +36,22 @@ struct sfg_pcm *synth_cache_get(const struct synth_cache *cache,int p);
 
 int synth_cache_add(struct synth_cache *cache,int p,int qual,int soundid,struct sfg_pcm *pcm);
 
+/* Replace entry (p)'s pcm with (pcm), which should have the same content, eg a compact copy from sfg_pcm_compact.
+ * We add a reference to (pcm). Anyone else holding the old one keeps it until they let go.
+ * Constant time, safe for the audio thread. Making the copy is not.
+ */
+int synth_cache_replace(struct synth_cache *cache,int p,struct sfg_pcm *pcm);
+
+/* Mark entry (p) as recently used.
+ */
+void synth_cache_touch(struct synth_cache *cache,int p);
+
+/* Drop least recently used entries until we're under budget, or there's nothing evictable.
+ * synth_cache_add does not do this implicitly, because it would invalidate your indices.
+ * Returns the count evicted.
+ */
+int synth_cache_enforce_budget(struct synth_cache *cache);
+
 void synth_cache_clear(struct synth_cache *cache);
 
 #endif
@@ -5,7 +5,7 @@
  
 void synth_channel_del(struct synth_channel *channel) {
   if (!channel) return;
-  if (channel->wave) free(channel->wave);
+  synth_wave_unref(channel->wave);
   free(channel);
 }
 
@@ -26,12 +26,12 @@ static int synth_channel_init_builtin(struct synth *synth,struct synth_channel *
     case SYNTH_CHANNEL_MODE_BLIP: break; // OK, done!
     
     case SYNTH_CHANNEL_MODE_WAVE: {
-        if (!(channel->wave=synth_wave_new_harmonics(synth,builtin->wave.wave,sizeof(builtin->wave.wave)))) return -1;
+        if (!(channel->wave=synth_wave_get_harmonics(synth,builtin->wave.wave,sizeof(builtin->wave.wave)))) return -1;
         synth_env_config_init_tiny(synth,&channel->level,builtin->wave.level);
       } break;
       
     case SYNTH_CHANNEL_MODE_ROCK: {
-        if (!(channel->wave=synth_wave_new_harmonics(synth,builtin->rock.wave,sizeof(builtin->rock.wave)))) return -1;
+        if (!(channel->wave=synth_wave_get_harmonics(synth,builtin->rock.wave,sizeof(builtin->rock.wave)))) return -1;
         synth_env_config_init_tiny(synth,&channel->level,builtin->rock.level);
         synth_env_config_init_parameter(&channel->param0,&channel->level,builtin->rock.mix);
       } break;
@@ -64,6 +64,7 @@ static int synth_channel_init_builtin(struct synth *synth,struct synth_channel *
         synth_proc_init(synth,proc);
         proc->chid=channel->chid;
         proc->origin=SYNTH_ORIGIN_SONG;//TODO
+        synth_pan_gains(&proc->panl,&proc->panr,channel->pan);
         if (synth_proc_fx_init(synth,proc,channel,builtin)<0) {
           proc->update=0;
           return -1;
@@ -208,6 +209,8 @@ void synth_channel_control(struct synth *synth,struct synth_channel *channel,uin
       } break;
     case MIDI_CONTROL_PAN_MSB: {
         channel->pan=v/64.0f-1.0f;
+        struct synth_proc *proc=synth_find_proc_by_chid(synth,channel->chid);
+        if (proc) synth_pan_gains(&proc->panl,&proc->panr,channel->pan);
       } break;
   }
   switch (channel->mode) {
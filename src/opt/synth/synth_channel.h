@@ -78,7 +78,7 @@ struct synth_channel {
   float pan; // -1..1
   int mode;
   int drumbase;
-  float *wave;
+  struct synth_wave *wave; // Shared; we hold a reference.
   struct synth_env_config level;
   struct synth_env_config param0;
   float fmrate;
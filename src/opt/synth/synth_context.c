@@ -1,18 +1,29 @@
 #include "synth_internal.h"
 
+static void synth_save_to_disk_cache(struct synth *synth);
+
 /* Cleanup.
  */
 
 void synth_del(struct synth *synth) {
   int i;
   if (!synth) return;
+  synth_bgprint_del(synth->bgprint);
+  synth_save_to_disk_cache(synth);
+  synth_diskcache_del(synth->diskcache);
+  synth_pool_del(synth->pool);
   synth_cache_del(synth->cache);
   synth_song_del(synth->song);
   synth_song_del(synth->song_next);
   for (i=SYNTH_CHANNEL_COUNT;i-->0;) synth_channel_del(synth->channelv[i]);
+  synth_wave_cache_clear(synth);
+  if (synth->wavev) free(synth->wavev);
   for (i=synth->voicec;i-->0;) synth_voice_cleanup(synth->voicev+i);
   for (i=synth->procc;i-->0;) synth_proc_cleanup(synth->procv+i);
   for (i=synth->playbackc;i-->0;) synth_playback_cleanup(synth->playbackv+i);
+  if (synth->voicev) free(synth->voicev);
+  if (synth->procv) free(synth->procv);
+  if (synth->playbackv) free(synth->playbackv);
   if (synth->printerv) {
     while (synth->printerc-->0) sfg_printer_del(synth->printerv[synth->printerc]);
     free(synth->printerv);
@@ -36,9 +47,8 @@ static void synth_precalculate_freq(struct synth *synth) {
 
 static void synth_precalculate_sine(struct synth *synth) {
   float *dst=synth->sine;
-  float p=0.0f,dp=(M_PI*2.0f)/(float)SYNTH_WAVE_SIZE_SAMPLES;
-  int i=SYNTH_WAVE_SIZE_SAMPLES;
-  for (;i-->0;p+=dp,dst++) *dst=sinf(p);
+  int i=0;
+  for (;i<SYNTH_WAVE_SIZE_SAMPLES;i++,dst++) *dst=(float)sin((i*M_PI*2.0)/SYNTH_WAVE_SIZE_SAMPLES);
 }
 
 /* New.
@@ -56,14 +66,23 @@ struct synth *synth_new(
     free(synth);
     return 0;
   }
+  if (!(synth->pool=synth_pool_new(synth,1))) {
+    synth_del(synth);
+    return 0;
+  }
   synth->rate=rate;
   synth->chanc=chanc;
   synth->rom=rom;
   synth->buffer_limit=(SYNTH_BUFFER_LIMIT/chanc)*chanc;
   synth->qlevel=32000.0f;
+  synth->simd=synth_simd_best();
   synth_precalculate_freq(synth);
   synth_precalculate_sine(synth);
-  synth->song_duration=-1.0;
+  synth_wave_prewarm(synth);
+  if (synth_set_voice_limits(synth,SYNTH_VOICE_LIMIT,SYNTH_PROC_LIMIT,SYNTH_PLAYBACK_LIMIT)<0) {
+    synth_del(synth);
+    return 0;
+  }
   return synth;
 }
 
@@ -75,7 +94,6 @@ void synth_end_song(struct synth *synth) {
   
   synth_song_del(synth->song);
   synth->song=0;
-  synth->song_duration=-1.0;
   
   int i;
   struct synth_voice *voice=synth->voicev;
@@ -135,7 +153,7 @@ void synth_play_song(struct synth *synth,int qual,int songid,int force,int repea
   int serialc=synth->rom?rom_get(&serial,synth->rom,EGG_RESTYPE_song,qual,songid):0;
   struct synth_song *nsong=0;
   if (serialc>0) {
-    if (!(nsong=synth_song_new(synth,serial,serialc,1,repeat,qual,songid))) return;
+    if (!(nsong=synth_song_new(synth,serial,serialc,repeat,qual,songid))) return;
   }
   
   // If we don't currently have a song running or pending, start the new one immediately.
@@ -166,7 +184,7 @@ void synth_play_song_serial(
     synth_end_song(synth);
     return;
   }
-  struct synth_song *nsong=synth_song_new(synth,src,srcc,safe_to_borrow,repeat,-1,-1);
+  struct synth_song *nsong=synth_song_new(synth,src,srcc,repeat,-1,-1);
   if (!nsong) return;
   if (!synth->song&&!synth->song_next&&!synth_has_song_voices(synth)) {
     synth->song=nsong;
@@ -179,17 +197,25 @@ void synth_play_song_serial(
 }
 
 /* Get song IDs.
+ * A posted song that hasn't landed yet wins over whatever the audio thread published.
  */
  
+static int synth_post_pending(unsigned int post_serial,const struct synth_song_state *state) {
+  if (!post_serial) return 0;
+  return ((int)(post_serial-state->serial)>0);
+}
+ 
 void synth_get_song(int *qual,int *rid,int *repeat,const struct synth *synth) {
-  if (synth->song_next) {
-    *qual=synth->song_next->qual;
-    *rid=synth->song_next->songid;
-    *repeat=synth->song_next->repeat;
-  } else if (synth->song) {
-    *qual=synth->song->qual;
-    *rid=synth->song->songid;
-    *repeat=synth->song->repeat;
+  struct synth_song_state state;
+  synth_song_read(&state,synth);
+  if (synth_post_pending(synth->post_song_serial,&state)) {
+    *qual=synth->post_qual;
+    *rid=synth->post_songid;
+    *repeat=synth->post_repeat;
+  } else if (state.present) {
+    *qual=state.qual;
+    *rid=state.songid;
+    *repeat=state.repeat;
   } else {
     *qual=0;
     *rid=0;
@@ -197,27 +223,63 @@ void synth_get_song(int *qual,int *rid,int *repeat,const struct synth *synth) {
   }
 }
 
-/* Create a pcm printer and register it.
- * On success, returns WEAK reference to the new PCM dump.
- * The printer stays resident until next update, even if it runs to completion immediately, to keep the pcm alive.
+/* Add a printer to our foreground list, and catch it up to the update in progress.
+ * HANDOFF on success.
  */
-
-static struct sfg_pcm *synth_begin_pcmprint(struct synth *synth,const void *src,int srcc) {
+ 
+static int synth_register_printer(struct synth *synth,struct sfg_printer *printer) {
   if (synth->printerc>=synth->printera) {
     int na=synth->printera+16;
-    if (na>INT_MAX/sizeof(void*)) return 0;
+    if (na>INT_MAX/sizeof(void*)) return -1;
     void *nv=realloc(synth->printerv,sizeof(void*)*na);
-    if (!nv) return 0;
+    if (!nv) return -1;
     synth->printerv=nv;
     synth->printera=na;
   }
-  struct sfg_printer *printer=sfg_printer_new(synth->rate,src,srcc);
-  if (!printer) return 0;
   synth->printerv[synth->printerc++]=printer;
   if (synth->update_in_progress>0) {
     sfg_printer_update(printer,synth->update_in_progress);
   }
-  return sfg_printer_get_pcm(printer);
+  return 0;
+}
+
+/* Create a pcm printer and register it.
+ * On success, returns a STRONG reference to the new PCM dump; caller must release it.
+ * If we have a background printer, it takes the printer, and sets (*background) nonzero.
+ * Otherwise we print in the audio callback.
+ * (fromrom) if (src) is ROM sound (qual,soundid), going into our cache.
+ * The background printer checks the disk cache for those, and compacts them when finished if the cache wants that.
+ */
+
+static struct sfg_pcm *synth_begin_pcmprint(struct synth *synth,const void *src,int srcc,int fromrom,int qual,int soundid,int *background) {
+  *background=0;
+  struct sfg_printer *printer=sfg_printer_new(synth->rate,src,srcc);
+  if (!printer) return 0;
+  struct sfg_pcm *pcm=sfg_printer_get_pcm(printer);
+  if (sfg_pcm_ref(pcm)<0) {
+    sfg_printer_del(printer);
+    return 0;
+  }
+  if (synth->bgprint) {
+    struct synth_bgprint_job job={
+      .printer=printer,
+      .serial=fromrom?src:0,
+      .serialc=srcc,
+      .qual=qual,
+      .soundid=soundid,
+      .compact=fromrom&&synth->cache->compact,
+    };
+    if (synth_bgprint_add(synth->bgprint,&job)>=0) {
+      *background=1;
+      return pcm;
+    }
+  }
+  if (synth_register_printer(synth,printer)<0) {
+    sfg_printer_del(printer);
+    sfg_pcm_del(pcm);
+    return 0;
+  }
+  return pcm;
 }
 
 /* Begin playing PCM.
@@ -239,8 +301,11 @@ void synth_play_sound(struct synth *synth,int qual,int soundid,float trim,float
   if (cachep>=0) {
     struct sfg_pcm *pcm=synth_cache_get(synth->cache,cachep);
     if (pcm) synth_play_pcm(synth,pcm,trim,pan);
+    synth_cache_touch(synth->cache,cachep);
+    synth->cache->hitc++;
     return;
   }
+  synth->cache->missc++;
   if (!synth->rom) return;
   cachep=-cachep-1;
   
@@ -249,13 +314,20 @@ void synth_play_sound(struct synth *synth,int qual,int soundid,float trim,float
   int serialc=rom_get(&serial,synth->rom,EGG_RESTYPE_sound,qual,soundid);
   if (serialc<1) return;
   
-  // Add a pcm printer.
-  struct sfg_pcm *pcm=synth_begin_pcmprint(synth,serial,serialc);
+  // Add a pcm printer. The background printer checks the disk cache first, but we don't touch it here.
+  // Printing in the foreground, mark it to save at the next chance off the audio thread.
+  int background=0;
+  struct sfg_pcm *pcm=synth_begin_pcmprint(synth,serial,serialc,1,qual,soundid,&background);
   if (!pcm) return;
   
   // Add to cache and start playing.
-  synth_cache_add(synth->cache,cachep,qual,soundid,pcm);
+  // Enforce the cache's budget only after the playback holds its reference, so we don't evict the new one.
+  if ((synth_cache_add(synth->cache,cachep,qual,soundid,pcm)>=0)&&!background&&synth->diskcache) {
+    synth->cache->entryv[cachep].unsaved=1;
+  }
   synth_play_pcm(synth,pcm,trim,pan);
+  sfg_pcm_del(pcm);
+  synth_cache_enforce_budget(synth->cache);
 }
 
 /* Play sound from serial data.
@@ -268,20 +340,34 @@ void synth_play_sound_serial(
 ) {
   if (trim<=0.0) return;
   if (!src||(srcc<1)) return;
-  struct sfg_pcm *pcm=synth_begin_pcmprint(synth,src,srcc);
+  int background=0;
+  struct sfg_pcm *pcm=synth_begin_pcmprint(synth,src,srcc,0,0,0,&background);
   if (!pcm) return;
   synth_play_pcm(synth,pcm,trim,pan);
+  sfg_pcm_del(pcm);
 }
 
 /* Get playhead.
  */
  
 double synth_get_playhead(struct synth *synth,double adjust) {
-  // Use "next" if present, so we're discussing the new song as soon as the user asks for it.
-  // Its playhead will linger at zero for a little while, until it starts playing for real.
-  if (synth->song_next) return synth_song_get_playhead(synth,synth->song_next,adjust);
-  if (synth->song) return synth_song_get_playhead(synth,synth->song,adjust);
-  return -1.0;
+  // Use posted commands if they haven't landed yet, so we're discussing the new song as soon as the user asks for it.
+  // A new song's playhead will linger at zero for a little while, until it starts playing for real.
+  struct synth_song_state state;
+  synth_song_read(&state,synth);
+  int song_pending=synth_post_pending(synth->post_song_serial,&state);
+  int beats_pending=synth_post_pending(synth->post_beats_serial,&state);
+  // The newest post that hasn't landed wins: A new song starts at zero, and a new playhead is exactly what was asked for.
+  if (song_pending&&(!beats_pending||((int)(synth->post_song_serial-synth->post_beats_serial)>0))) {
+    return synth->post_songid?0.0:-1.0;
+  }
+  int present=song_pending?synth->post_songid:state.present;
+  if (!present) return -1.0;
+  if (beats_pending) return synth->post_beats;
+  if (state.tempo<1) return 0.0;
+  double frames_per_ms=(float)synth->rate/1000.0f; // Same as synth_song_new.
+  double ms=(state.framep>0)?((double)state.framep/frames_per_ms):0.0;
+  return (ms-(adjust*1000.0))/(double)state.tempo;
 }
 
 /* Set playhead.
@@ -302,11 +388,11 @@ void synth_set_playhead(struct synth *synth,double beats) {
  */
  
 double synth_get_duration(struct synth *synth) {
-  if (synth->song_duration<0.0) {
-    if (synth->song_next) synth->song_duration=synth_song_get_duration(synth->song_next);
-    else if (synth->song) synth->song_duration=synth_song_get_duration(synth->song);
-  }
-  return synth->song_duration;
+  struct synth_song_state state;
+  synth_song_read(&state,synth);
+  if (!state.present) return -1.0;
+  if (state.tempo<1) return 0.0;
+  return (double)state.durms/(double)state.tempo;
 }
 
 /* Drop any voice or proc that might refer to the given channel.
@@ -329,18 +415,19 @@ void synth_drop_voices_for_channel(struct synth *synth,uint8_t chid) {
 }
 
 /* Get signal object, evicting an old one if needed.
+ * A defunct one is free for the taking. Otherwise we take whichever *_compare likes least, and count it as a steal.
  */
  
-#define GETOBJ(t,T) \
+#define GETOBJ(t) \
   struct synth_##t *synth_##t##_new(struct synth *synth) { \
-    if (synth->t##c<SYNTH_##T##_LIMIT) { \
+    if (synth->t##c<synth->t##a) { \
       struct synth_##t *obj=synth->t##v+synth->t##c++; \
       memset(obj,0,sizeof(struct synth_##t)); \
       return obj; \
     } \
     struct synth_##t *obj=synth->t##v; \
     struct synth_##t *q=synth->t##v; \
-    int i=SYNTH_##T##_LIMIT; \
+    int i=synth->t##c; \
     for (;i-->0;q++) { \
       if (synth_##t##_is_defunct(q)) { \
         obj=q; \
@@ -348,21 +435,66 @@ void synth_drop_voices_for_channel(struct synth *synth,uint8_t chid) {
       } \
       if (synth_##t##_compare(obj,q)>0) obj=q; \
     } \
+    if (!synth_##t##_is_defunct(obj)) synth->t##_stealc++; \
     synth_##t##_cleanup(obj); \
     memset(obj,0,sizeof(struct synth_##t)); \
     return obj; \
   }
   
-GETOBJ(voice,VOICE)
-GETOBJ(proc,PROC)
-GETOBJ(playback,PLAYBACK)
+GETOBJ(voice)
+GETOBJ(proc)
+GETOBJ(playback)
 
 #undef GETOBJ
 
+/* Change list capacities.
+ * Shrinking drops objects off the end, without ceremony.
+ */
+ 
+#define RESIZE(t) { \
+  if (t##a<1) t##a=synth->t##a; \
+  while (synth->t##c>t##a) { \
+    synth->t##c--; \
+    synth_##t##_cleanup(synth->t##v+synth->t##c); \
+  } \
+  if (t##a!=synth->t##a) { \
+    void *nv=realloc(synth->t##v,sizeof(struct synth_##t)*t##a); \
+    if (nv) synth->t##v=nv; \
+    else if (t##a>synth->t##a) return -1; \
+    synth->t##a=t##a; \
+  } \
+}
+ 
+int synth_set_voice_limits(struct synth *synth,int voicea,int proca,int playbacka) {
+  if ((voicea>SYNTH_OBJECT_LIMIT)||(proca>SYNTH_OBJECT_LIMIT)||(playbacka>SYNTH_OBJECT_LIMIT)) return -1;
+  if (synth_pool_require(synth->pool,voicea,proca,playbacka)<0) return -1;
+  RESIZE(voice)
+  RESIZE(proc)
+  RESIZE(playback)
+  return 0;
+}
+
+#undef RESIZE
+
 /* Search signal objects.
+ * Voices by note go thru (notev) first, which is right nearly always.
+ * When it isn't, maybe there's an older voice on the same note, or the note is already gone. Scan to be sure.
  */
  
+void synth_index_voice(struct synth *synth,struct synth_voice *voice) {
+  if (voice->noteid>=0x80) return;
+  if (voice->chid>=SYNTH_CHANNEL_COUNT) return;
+  synth->notev[(voice->chid<<7)|voice->noteid]=voice-synth->voicev+1;
+}
+ 
 struct synth_voice *synth_find_voice_by_chid_noteid(struct synth *synth,uint8_t chid,uint8_t noteid) {
+  if ((chid<SYNTH_CHANNEL_COUNT)&&(noteid<0x80)) {
+    int p=synth->notev[(chid<<7)|noteid]-1;
+    if ((p>=0)&&(p<synth->voicec)) {
+      struct synth_voice *voice=synth->voicev+p;
+      if (!synth_voice_is_defunct(voice)&&(voice->chid==chid)&&(voice->noteid==noteid)) return voice;
+    }
+  }
   struct synth_voice *voice=synth->voicev;
   int i=synth->voicec;
   for (;i-->0;voice++) {
@@ -394,6 +526,246 @@ int synth_frames_per_beat(const struct synth *synth) {
   return (synth->song->tempo*synth->rate)/1000;
 }
 
+/* Select SIMD kernels.
+ */
+
+int synth_set_simd(struct synth *synth,const char *name) {
+  if (!name||!name[0]) {
+    synth->simd=synth_simd_best();
+    return 0;
+  }
+  const struct synth_simd *simd=synth_simd_by_name(name,-1);
+  if (!simd) return -1;
+  synth->simd=simd;
+  return 0;
+}
+
+/* Replace the worker pool.
+ */
+ 
+int synth_set_threads(struct synth *synth,int threadc) {
+  if (threadc<1) threadc=1;
+  else if (threadc>SYNTH_THREAD_LIMIT) threadc=SYNTH_THREAD_LIMIT;
+  if (synth->pool->threadc==threadc) return 0;
+  struct synth_pool *pool=synth_pool_new(synth,threadc);
+  if (!pool) return -1;
+  synth_pool_del(synth->pool);
+  synth->pool=pool;
+  return 0;
+}
+
+/* Enable or disable dither.
+ * Reseed on every enable, so a given run always dithers the same.
+ */
+ 
+void synth_set_dither(struct synth *synth,int enable) {
+  if (enable) {
+    if (synth->dither) return;
+    synth_noise_seed(&synth->dithernoise,0x44495448);
+    synth->dither=1;
+  } else {
+    synth->dither=0;
+  }
+}
+
+/* Enable or disable background printing.
+ */
+ 
+int synth_set_background_printing(struct synth *synth,int enable) {
+  if (enable) {
+    if (synth->bgprint) return 0;
+    if (!(synth->bgprint=synth_bgprint_new(synth->diskcache))) return -1;
+  } else {
+    synth_bgprint_del(synth->bgprint);
+    synth->bgprint=0;
+  }
+  return 0;
+}
+
+/* Cache budget.
+ */
+ 
+void synth_set_compact_cache(struct synth *synth,int enable) {
+  synth->cache->compact=enable?1:0;
+}
+
+void synth_set_cache_budget(struct synth *synth,int64_t bytes) {
+  if (bytes<0) bytes=0;
+  synth->cache->budget=bytes;
+  synth_cache_enforce_budget(synth->cache);
+}
+
+/* Noise seed.
+ */
+ 
+void synth_set_noise_seed(struct synth *synth,uint32_t seed) {
+  synth->noiseseed=seed;
+}
+
+/* Stats.
+ */
+ 
+void synth_get_stats(struct synth_stats *stats,const struct synth *synth) {
+  memset(stats,0,sizeof(struct synth_stats));
+  stats->cache_hitc=synth->cache->hitc;
+  stats->cache_missc=synth->cache->missc;
+  stats->cache_evictc=synth->cache->evictc;
+  stats->cache_soundc=synth->cache->entryc;
+  stats->cache_bytes=synth->cache->size;
+  stats->voice_stealc=synth->voice_stealc;
+  stats->proc_stealc=synth->proc_stealc;
+  stats->playback_stealc=synth->playback_stealc;
+  stats->print_missc=synth->print_missc;
+  stats->print_lagc=synth->print_lagc;
+  stats->print_lag_max=synth->print_lag_max;
+}
+
+/* Save sounds printed in the foreground to the disk cache.
+ * The audio thread can't, so they wait in the memory cache marked "unsaved" until one of:
+ * synth_del, synth_prewarm, or synth_set_disk_cache. Ones still printing then, or evicted before, are lost; no harm.
+ */
+ 
+static void synth_save_to_disk_cache(struct synth *synth) {
+  if (!synth->diskcache||!synth->rom) return;
+  struct synth_cache_entry *entry=synth->cache->entryv;
+  int i=synth->cache->entryc;
+  for (;i-->0;entry++) {
+    if (!entry->unsaved) continue;
+    if (atomic_load_explicit(&entry->pcm->ready,memory_order_acquire)<entry->pcm->c) continue;
+    entry->unsaved=0;
+    const void *serial=0;
+    int serialc=rom_get(&serial,synth->rom,EGG_RESTYPE_sound,entry->qual,entry->soundid);
+    if (serialc<1) continue;
+    uint64_t key=synth_diskcache_key(synth->diskcache,serial,serialc);
+    synth_diskcache_save(synth->diskcache,key,entry->pcm);
+  }
+}
+
+/* Set disk cache.
+ */
+ 
+int synth_set_disk_cache(struct synth *synth,const char *path) {
+  struct synth_diskcache *diskcache=0;
+  if (path&&path[0]) {
+    if (!(diskcache=synth_diskcache_new(path,-1,synth->rate,SYNTH_DISKCACHE_BUDGET_DEFAULT))) return -1;
+  }
+  synth_save_to_disk_cache(synth);
+  // The background printer holds the old one weakly. Restarting it finishes its work under the old one.
+  int bgprint=synth->bgprint?1:0;
+  synth_set_background_printing(synth,0);
+  synth_diskcache_del(synth->diskcache);
+  synth->diskcache=diskcache;
+  if (bgprint) return synth_set_background_printing(synth,1);
+  return 0;
+}
+
+/* Prewarm.
+ */
+ 
+struct synth_prewarm_job {
+  int qual,rid;
+  uint64_t key;
+  struct sfg_printer *printer;
+};
+
+struct synth_prewarm_context {
+  struct synth_prewarm_job *jobv;
+  int jobc;
+  atomic_int jobp;
+};
+
+static void *synth_prewarm_thread(void *arg) {
+  struct synth_prewarm_context *ctx=arg;
+  unsigned int fpstate=synth_denormals_disable();
+  for (;;) {
+    int p=atomic_fetch_add(&ctx->jobp,1);
+    if (p>=ctx->jobc) break;
+    sfg_printer_update(ctx->jobv[p].printer,INT_MAX);
+  }
+  synth_denormals_restore(fpstate);
+  return 0;
+}
+ 
+int synth_prewarm(struct synth *synth,int threadc,int64_t *bytes) {
+  if (!synth->rom) return 0;
+  synth_save_to_disk_cache(synth);
+  struct synth_prewarm_context ctx={0};
+  if (!(ctx.jobv=calloc(synth->rom->resc?synth->rom->resc:1,sizeof(struct synth_prewarm_job)))) return -1;
+  
+  // Gather sounds not already in the cache, and make a printer for each.
+  // Those found in the disk cache go straight in, and don't count toward (bytes); they're not in our heap.
+  int soundc=0;
+  const struct rom_res *res=synth->rom->resv;
+  int i=synth->rom->resc;
+  for (;i-->0;res++) {
+    int tid=0,qual=0,rid=0;
+    rom_unpack_fqrid(&tid,&qual,&rid,res->fqrid);
+    if (tid!=EGG_RESTYPE_sound) continue;
+    int cachep=synth_cache_search(synth->cache,qual,rid);
+    if (cachep>=0) continue;
+    uint64_t key=0;
+    if (synth->diskcache) {
+      key=synth_diskcache_key(synth->diskcache,res->v,res->c);
+      struct sfg_pcm *pcm=synth_diskcache_load(synth->diskcache,key);
+      if (pcm) {
+        if (synth_cache_add(synth->cache,-cachep-1,qual,rid,pcm)>=0) soundc++;
+        sfg_pcm_del(pcm);
+        continue;
+      }
+    }
+    struct sfg_printer *printer=sfg_printer_new(synth->rate,res->v,res->c);
+    if (!printer) continue;
+    struct synth_prewarm_job *job=ctx.jobv+ctx.jobc++;
+    job->qual=qual;
+    job->rid=rid;
+    job->key=key;
+    job->printer=printer;
+  }
+  
+  // Print them all, in parallel.
+  if (threadc<1) threadc=(int)sysconf(_SC_NPROCESSORS_ONLN);
+  if (threadc>SYNTH_THREAD_LIMIT) threadc=SYNTH_THREAD_LIMIT;
+  if ((ctx.jobc>0)&&(threadc>ctx.jobc)) {
+    // Fewer sounds than threads: Spread the spare threads across their voices.
+    int per=threadc/ctx.jobc;
+    for (i=0;i<ctx.jobc;i++) sfg_printer_set_threads(ctx.jobv[i].printer,per);
+    threadc=ctx.jobc;
+  }
+  pthread_t threadv[SYNTH_THREAD_LIMIT];
+  int threadc_running=0;
+  while (threadc_running<threadc-1) {
+    if (pthread_create(threadv+threadc_running,0,synth_prewarm_thread,&ctx)) break;
+    threadc_running++;
+  }
+  synth_prewarm_thread(&ctx);
+  while (threadc_running-->0) pthread_join(threadv[threadc_running],0);
+  
+  // Move the pcms into our cache, and save them to disk.
+  struct synth_prewarm_job *job=ctx.jobv;
+  for (i=ctx.jobc;i-->0;job++) {
+    struct sfg_pcm *pcm=sfg_printer_get_pcm(job->printer);
+    if (job->key) synth_diskcache_save(synth->diskcache,job->key,pcm);
+    int cachep=synth_cache_search(synth->cache,job->qual,job->rid);
+    if (cachep>=0) cachep=-1;
+    else if (synth_cache_add(synth->cache,cachep=-cachep-1,job->qual,job->rid,pcm)<0) cachep=-1;
+    if (cachep>=0) {
+      soundc++;
+      if (synth->cache->compact) {
+        struct sfg_pcm *compact=sfg_pcm_compact(pcm);
+        if (compact) {
+          synth_cache_replace(synth->cache,cachep,compact);
+          sfg_pcm_del(compact);
+        }
+      }
+      if (bytes) (*bytes)+=sfg_pcm_size(synth_cache_get(synth->cache,cachep));
+    }
+    sfg_printer_del(job->printer);
+  }
+  free(ctx.jobv);
+  synth_cache_enforce_budget(synth->cache);
+  return soundc;
+}
+
 /* Clear cache.
  */
  
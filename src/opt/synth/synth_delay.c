@@ -40,6 +40,18 @@ int synth_delay_init(struct synth_delay *delay,int framec,float mix,float feedba
   return 0;
 }
 
+/* Ring-out time.
+ */
+ 
+int synth_delay_ringout(const struct synth_delay *delay) {
+  if (delay->c<1) return 0;
+  if (delay->fbk>=1.0f) return INT_MAX;
+  int repeatc=1;
+  if (delay->fbk>0.0f) repeatc+=(int)(logf(SYNTH_ENV_SILENCE)/logf(delay->fbk));
+  if (repeatc>INT_MAX/delay->c) return INT_MAX;
+  return delay->c*repeatc;
+}
+
 /* Detune.
  */
  
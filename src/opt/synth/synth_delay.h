@@ -16,6 +16,11 @@ void synth_delay_cleanup(struct synth_delay *delay);
 
 int synth_delay_init(struct synth_delay *delay,int framec,float mix,float feedback);
 
+/* Frames until an input would repeat below audibility, counting its first pass.
+ * INT_MAX if feedback is full, those repeat forever.
+ */
+int synth_delay_ringout(const struct synth_delay *delay);
+
 static inline float synth_delay_update(struct synth_delay *delay,float src) {
   float prv=delay->v[delay->p];
   delay->v[delay->p]=src*delay->sto+prv*delay->fbk;
@@ -0,0 +1,339 @@
+#include "synth_internal.h"
+#include "opt/fs/fs.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+
+static const char synth_diskcache_signature[8]={0,'S','F','G','P','C','M','\n'};
+
+/* Delete.
+ */
+
+void synth_diskcache_del(struct synth_diskcache *diskcache) {
+  if (!diskcache) return;
+  if (diskcache->path) free(diskcache->path);
+  free(diskcache);
+}
+
+/* New.
+ */
+
+static void synth_diskcache_prune(struct synth_diskcache *diskcache);
+
+struct synth_diskcache *synth_diskcache_new(const char *path,int pathc,int rate,int64_t budget) {
+  if (!path) return 0;
+  if (pathc<0) { pathc=0; while (path[pathc]) pathc++; }
+  if (!pathc||(pathc>1024)) return 0;
+  struct synth_diskcache *diskcache=calloc(1,sizeof(struct synth_diskcache));
+  if (!diskcache) return 0;
+  if (!(diskcache->path=malloc(pathc+1))) {
+    free(diskcache);
+    return 0;
+  }
+  memcpy(diskcache->path,path,pathc);
+  diskcache->path[pathc]=0;
+  diskcache->pathc=pathc;
+  diskcache->rate=rate;
+  diskcache->budget=(budget>0)?budget:0;
+  if (dir_mkdirp(diskcache->path)<0) {
+    synth_diskcache_del(diskcache);
+    return 0;
+  }
+  synth_diskcache_prune(diskcache);
+  return diskcache;
+}
+
+/* Key: FNV-1a over the serial data, then the rate, file format, and version.
+ */
+
+static uint64_t synth_fnv1a(uint64_t h,const void *src,int srcc) {
+  const uint8_t *p=src;
+  for (;srcc-->0;p++) {
+    h^=*p;
+    h*=0x100000001b3ull;
+  }
+  return h;
+}
+
+uint64_t synth_diskcache_key(const struct synth_diskcache *diskcache,const void *serial,int serialc) {
+  uint64_t h=0xcbf29ce484222325ull;
+  h=synth_fnv1a(h,serial,serialc);
+  h=synth_fnv1a(h,&diskcache->rate,sizeof(diskcache->rate));
+  h=synth_fnv1a(h,synth_diskcache_signature,sizeof(synth_diskcache_signature));
+  uint32_t version=SYNTH_DISKCACHE_VERSION;
+  h=synth_fnv1a(h,&version,sizeof(version));
+  if (!h) h=1;
+  return h;
+}
+
+/* Compose path.
+ */
+
+static int synth_diskcache_path(char *dst,int dsta,const struct synth_diskcache *diskcache,uint64_t key,const char *sfx) {
+  return snprintf(dst,dsta,"%.*s/%016llx.pcm%s",diskcache->pathc,diskcache->path,(unsigned long long)key,sfx);
+}
+
+/* Validate a header against the file's length.
+ * Returns the sample count, or zero if anything's off. Any mismatch, we just call it a miss; it will get overwritten.
+ * (rate,key) zero to accept any.
+ */
+
+static int synth_diskcache_check_header(const uint8_t *hdr,size_t filec,int rate,uint64_t key) {
+  uint32_t order,frate,c,version;
+  uint64_t fkey;
+  memcpy(&order,hdr+0x08,4);
+  memcpy(&frate,hdr+0x0c,4);
+  memcpy(&fkey,hdr+0x10,8);
+  memcpy(&c,hdr+0x18,4);
+  memcpy(&version,hdr+0x1c,4);
+  if (memcmp(hdr,synth_diskcache_signature,8)) return 0;
+  if (order!=0x01020304) return 0;
+  if (version!=SYNTH_DISKCACHE_VERSION) return 0;
+  if (rate&&(frate!=rate)) return 0;
+  if (key&&(fkey!=key)) return 0;
+  if ((c<1)||(c>INT_MAX)) return 0;
+  if (c!=(filec-SYNTH_DISKCACHE_HEADER_SIZE)/sizeof(float)) return 0;
+  return c;
+}
+
+/* Open a cache file for reading, and mark it recently used.
+ * Returns fd, and its length in (*filec).
+ */
+
+static int synth_diskcache_open(size_t *filec,const struct synth_diskcache *diskcache,uint64_t key) {
+  char path[1100];
+  int pathc=synth_diskcache_path(path,sizeof(path),diskcache,key,"");
+  if ((pathc<1)||(pathc>=sizeof(path))) return -1;
+  int fd=open(path,O_RDONLY);
+  if (fd<0) return -1;
+  struct stat st={0};
+  if ((fstat(fd,&st)<0)||(st.st_size<SYNTH_DISKCACHE_HEADER_SIZE+sizeof(float))||(st.st_size>INT_MAX)) {
+    close(fd);
+    return -1;
+  }
+  futimens(fd,0);
+  *filec=st.st_size;
+  return fd;
+}
+
+/* Load.
+ */
+
+struct sfg_pcm *synth_diskcache_load(const struct synth_diskcache *diskcache,uint64_t key) {
+  size_t mapc=0;
+  int fd=synth_diskcache_open(&mapc,diskcache,key);
+  if (fd<0) return 0;
+  void *map=mmap(0,mapc,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if (map==MAP_FAILED) return 0;
+  const uint8_t *hdr=map;
+  int c=synth_diskcache_check_header(hdr,mapc,diskcache->rate,key);
+  if (!c) {
+    munmap(map,mapc);
+    return 0;
+  }
+  struct sfg_pcm *pcm=sfg_pcm_new_mapped(map,mapc,(const float*)(hdr+SYNTH_DISKCACHE_HEADER_SIZE),c);
+  if (!pcm) {
+    munmap(map,mapc);
+    return 0;
+  }
+  return pcm;
+}
+
+/* Read into existing pcm.
+ */
+
+static int synth_diskcache_read_all(int fd,void *dst,size_t dstc) {
+  uint8_t *p=dst;
+  while (dstc>0) {
+    ssize_t err=read(fd,p,dstc);
+    if (err<=0) return -1;
+    p+=err;
+    dstc-=err;
+  }
+  return 0;
+}
+
+int synth_diskcache_read(const struct synth_diskcache *diskcache,uint64_t key,struct sfg_pcm *pcm) {
+  if (!pcm||!pcm->v||(pcm->c<1)) return 0;
+  if (atomic_load_explicit(&pcm->ready,memory_order_acquire)) return 0;
+  size_t filec=0;
+  int fd=synth_diskcache_open(&filec,diskcache,key);
+  if (fd<0) return 0;
+  uint8_t hdr[SYNTH_DISKCACHE_HEADER_SIZE];
+  if (
+    (synth_diskcache_read_all(fd,hdr,sizeof(hdr))<0)||
+    (synth_diskcache_check_header(hdr,filec,diskcache->rate,key)!=pcm->c)
+  ) {
+    close(fd);
+    return 0;
+  }
+  // Nobody reads past (ready), which is still zero, so we're free to scribble. But clean up if it fails.
+  if (synth_diskcache_read_all(fd,pcm->v,sizeof(float)*pcm->c)<0) {
+    close(fd);
+    memset(pcm->v,0,sizeof(float)*pcm->c);
+    return 0;
+  }
+  close(fd);
+  atomic_store_explicit(&pcm->ready,pcm->c,memory_order_release);
+  return 1;
+}
+
+/* Save.
+ */
+
+static int synth_diskcache_write_all(int fd,const void *src,size_t srcc) {
+  const uint8_t *p=src;
+  while (srcc>0) {
+    ssize_t err=write(fd,p,srcc);
+    if (err<=0) return -1;
+    p+=err;
+    srcc-=err;
+  }
+  return 0;
+}
+
+// Float or compact, write it as float.
+static int synth_diskcache_write_samples(int fd,const struct sfg_pcm *pcm) {
+  if (pcm->v) return synth_diskcache_write_all(fd,pcm->v,sizeof(float)*pcm->c);
+  float tmp[1024];
+  int p=0;
+  while (p<pcm->c) {
+    int c=pcm->c-p;
+    if (c>1024) c=1024;
+    int i=0;
+    for (;i<c;i++) tmp[i]=pcm->iv[p+i]*pcm->iscale;
+    if (synth_diskcache_write_all(fd,tmp,sizeof(float)*c)<0) return -1;
+    p+=c;
+  }
+  return 0;
+}
+
+int synth_diskcache_save(const struct synth_diskcache *diskcache,uint64_t key,const struct sfg_pcm *pcm) {
+  if (!key||!pcm||(!pcm->v&&!pcm->iv)||(pcm->c<1)) return -1;
+  if (atomic_load_explicit(&pcm->ready,memory_order_acquire)<pcm->c) return -1;
+  static atomic_int seq=0;
+  char sfx[32];
+  snprintf(sfx,sizeof(sfx),".%d.%d.tmp",(int)getpid(),atomic_fetch_add(&seq,1));
+  char tmppath[1100],path[1100];
+  int tmppathc=synth_diskcache_path(tmppath,sizeof(tmppath),diskcache,key,sfx);
+  int pathc=synth_diskcache_path(path,sizeof(path),diskcache,key,"");
+  if ((tmppathc<1)||(tmppathc>=sizeof(tmppath))) return -1;
+  if ((pathc<1)||(pathc>=sizeof(path))) return -1;
+
+  uint8_t hdr[SYNTH_DISKCACHE_HEADER_SIZE]={0};
+  uint32_t order=0x01020304,rate=diskcache->rate,c=pcm->c,version=SYNTH_DISKCACHE_VERSION;
+  memcpy(hdr,synth_diskcache_signature,8);
+  memcpy(hdr+0x08,&order,4);
+  memcpy(hdr+0x0c,&rate,4);
+  memcpy(hdr+0x10,&key,8);
+  memcpy(hdr+0x18,&c,4);
+  memcpy(hdr+0x1c,&version,4);
+
+  int fd=open(tmppath,O_WRONLY|O_CREAT|O_TRUNC,0666);
+  if (fd<0) return -1;
+  if (
+    (synth_diskcache_write_all(fd,hdr,sizeof(hdr))<0)||
+    (synth_diskcache_write_samples(fd,pcm)<0)
+  ) {
+    close(fd);
+    unlink(tmppath);
+    return -1;
+  }
+  close(fd);
+  if (rename(tmppath,path)<0) {
+    unlink(tmppath);
+    return -1;
+  }
+  return 0;
+}
+
+/* Prune.
+ * Temp files are normally renamed within milliseconds, so one an hour old belongs to a process that died mid-write.
+ * A file with a bad header is never going to be served, so it goes too. Other rates are fine, they're someone else's.
+ * Then if we're still over budget, least recently used first. Loads touch the file, so mtime is last use.
+ */
+
+#define SYNTH_DISKCACHE_TMP_AGE 3600
+
+struct synth_diskcache_prune_context {
+  struct synth_diskcache_file {
+    char *path;
+    int64_t size;
+    time_t mtime;
+  } *filev;
+  int filec,filea;
+  int64_t total;
+  time_t now;
+};
+
+static int synth_diskcache_suffix(const char *base,const char *sfx) {
+  int basec=0,sfxc=0;
+  while (base[basec]) basec++;
+  while (sfx[sfxc]) sfxc++;
+  return (basec>=sfxc)&&!memcmp(base+basec-sfxc,sfx,sfxc);
+}
+
+static int synth_diskcache_prune_cb(const char *path,const char *base,char type,void *userdata) {
+  struct synth_diskcache_prune_context *ctx=userdata;
+  struct stat st={0};
+  if (stat(path,&st)<0) return 0;
+  if (!S_ISREG(st.st_mode)) return 0;
+  if (synth_diskcache_suffix(base,".tmp")) {
+    if (st.st_mtime<ctx->now-SYNTH_DISKCACHE_TMP_AGE) unlink(path);
+    return 0;
+  }
+  if (!synth_diskcache_suffix(base,".pcm")) return 0;
+  uint8_t hdr[SYNTH_DISKCACHE_HEADER_SIZE];
+  int fd=open(path,O_RDONLY);
+  if (fd<0) return 0;
+  int ok=(
+    (st.st_size>=SYNTH_DISKCACHE_HEADER_SIZE)&&
+    (synth_diskcache_read_all(fd,hdr,sizeof(hdr))>=0)&&
+    synth_diskcache_check_header(hdr,st.st_size,0,0)
+  );
+  close(fd);
+  if (!ok) {
+    unlink(path);
+    return 0;
+  }
+  if (ctx->filec>=ctx->filea) {
+    int na=ctx->filea+64;
+    if (na>INT_MAX/sizeof(struct synth_diskcache_file)) return 0;
+    void *nv=realloc(ctx->filev,sizeof(struct synth_diskcache_file)*na);
+    if (!nv) return 0;
+    ctx->filev=nv;
+    ctx->filea=na;
+  }
+  struct synth_diskcache_file *file=ctx->filev+ctx->filec;
+  if (!(file->path=strdup(path))) return 0;
+  ctx->filec++;
+  file->size=st.st_size;
+  file->mtime=st.st_mtime;
+  ctx->total+=st.st_size;
+  return 0;
+}
+
+static int synth_diskcache_file_cmp(const void *a,const void *b) {
+  const struct synth_diskcache_file *A=a,*B=b;
+  if (A->mtime<B->mtime) return -1;
+  if (A->mtime>B->mtime) return 1;
+  return 0;
+}
+
+static void synth_diskcache_prune(struct synth_diskcache *diskcache) {
+  struct synth_diskcache_prune_context ctx={.now=time(0)};
+  dir_read(diskcache->path,synth_diskcache_prune_cb,&ctx);
+  if (diskcache->budget&&(ctx.total>diskcache->budget)) {
+    qsort(ctx.filev,ctx.filec,sizeof(struct synth_diskcache_file),synth_diskcache_file_cmp);
+    int i=0;
+    for (;(i<ctx.filec)&&(ctx.total>diskcache->budget);i++) {
+      if (unlink(ctx.filev[i].path)>=0) ctx.total-=ctx.filev[i].size;
+    }
+  }
+  if (ctx.filev) {
+    while (ctx.filec-->0) free(ctx.filev[ctx.filec].path);
+    free(ctx.filev);
+  }
+}
@@ -0,0 +1,70 @@
+/* synth_diskcache.h
+ * Persists printed sound effects across runs, one file per sound.
+ * Files are named by a hash of the sound's serial data, our output rate, and SYNTH_DISKCACHE_VERSION, so they're content-addressed:
+ * When the ROM changes, changed sounds get new keys, and their old files simply stop being used.
+ * Prewarm loads by mmap, so a cached sound costs no copy, and concurrent runs share it via the page cache.
+ * The background printer reads into the pcm it already handed out instead.
+ * Nothing here ever runs on the audio thread: Lookups and saves are from the background printer, prewarm, or synth_del.
+ * Files unused the longest get deleted at open, to stay under (budget).
+ */
+
+#ifndef SYNTH_DISKCACHE_H
+#define SYNTH_DISKCACHE_H
+
+struct sfg_pcm;
+
+/* File layout, all integers in native byte order:
+ *   0000   8 Signature: "\0SFGPCM\n"
+ *   0008   4 Byte order check: 0x01020304
+ *   000c   4 Rate, hz
+ *   0010   8 Key
+ *   0018   4 Sample count
+ *   001c   4 Version: SYNTH_DISKCACHE_VERSION
+ *   0020 ... float samples
+ */
+#define SYNTH_DISKCACHE_HEADER_SIZE 32
+
+/* Bump whenever printed output changes for the same serial data: sfg's printer, its optimizer, the file format...
+ * Files from other versions are never served, and get deleted at the next open.
+ * Zero was the first format, when this field was reserved.
+ */
+#define SYNTH_DISKCACHE_VERSION 1
+
+#define SYNTH_DISKCACHE_BUDGET_DEFAULT (64<<20)
+
+struct synth_diskcache {
+  char *path; // Directory.
+  int pathc;
+  int rate;
+  int64_t budget; // Bytes, for the whole directory. Zero for unlimited.
+};
+
+void synth_diskcache_del(struct synth_diskcache *diskcache);
+
+/* Creates the directory if needed, and prunes it: Partial files from dead processes,
+ * files from other versions, and then the least recently used until under (budget).
+ * (budget) in bytes, zero for unlimited.
+ */
+struct synth_diskcache *synth_diskcache_new(const char *path,int pathc,int rate,int64_t budget);
+
+/* Never zero; we use zero to mean "don't save".
+ */
+uint64_t synth_diskcache_key(const struct synth_diskcache *diskcache,const void *serial,int serialc);
+
+/* STRONG reference to a fully ready pcm, or null if we don't have it.
+ * Either way, a hit marks the file as recently used.
+ */
+struct sfg_pcm *synth_diskcache_load(const struct synth_diskcache *diskcache,uint64_t key);
+
+/* Copy the file's samples into an existing float (pcm) of the same length, then mark it fully ready.
+ * For pcms somebody is already reading, eg the background printer's.
+ * Returns >0 if read, or 0 if we don't have it, and then (pcm) is unchanged.
+ */
+int synth_diskcache_read(const struct synth_diskcache *diskcache,uint64_t key,struct sfg_pcm *pcm);
+
+/* (pcm) must be fully printed. Compact ones get expanded back to float.
+ * We write to a temporary file and rename it into place, so readers never see a partial file.
+ */
+int synth_diskcache_save(const struct synth_diskcache *diskcache,uint64_t key,const struct sfg_pcm *pcm);
+
+#endif
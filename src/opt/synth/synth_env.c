@@ -221,3 +221,30 @@ void synth_env_advance(struct synth_env *env) {
       }
   }
 }
+
+/* Run one segment into a buffer.
+ */
+ 
+void synth_env_ramp(float *dst,int c,struct synth_env *env) {
+  env->ttl-=c;
+  float v=env->v;
+  if (env->dv==0.0f) {
+    for (;c-->0;dst++) *dst=v;
+  } else {
+    float dv=env->dv;
+    for (;c-->0;dst++) *dst=(v+=dv);
+  }
+  env->v=v;
+}
+
+/* Fill buffer, any length.
+ */
+ 
+void synth_env_fill(float *dst,int c,struct synth_env *env) {
+  while (c>0) {
+    int segc=synth_env_segment(env,c);
+    synth_env_ramp(dst,segc,env);
+    dst+=segc;
+    c-=segc;
+  }
+}
@@ -65,15 +65,43 @@ void synth_env_gain(struct synth_env *env,float gain);
  */
 void synth_env_release(struct synth_env *env);
 
-// Should only be called by synth_env_update, below.
+// Should only be called by synth_env_update and synth_env_segment, below.
 void synth_env_advance(struct synth_env *env);
 
+/* Block-rate alternative to synth_env_update.
+ * synth_env_segment returns the length of the linear run starting at the next frame, no longer than (c).
+ * Caller must then consume exactly that many frames with synth_env_ramp, which yields (v+dv*1),(v+dv*2)...
+ * synth_env_fill does both, for any length, and produces exactly what synth_env_update would have.
+ */
+static inline int synth_env_segment(struct synth_env *env,int c) {
+  while (env->ttl<=0) synth_env_advance(env);
+  return (env->ttl<c)?env->ttl:c;
+}
+void synth_env_ramp(float *dst,int c,struct synth_env *env);
+void synth_env_fill(float *dst,int c,struct synth_env *env);
+
 static inline int synth_env_is_finished(const struct synth_env *env) {
   return (env->stage>=4);
 }
 
+/* Below SYNTH_ENV_SILENCE is less than half an LSB at 16 bits. Nobody will miss it.
+ * "Spent" if finished, or past attack with the level and everything it still has to visit below that.
+ * An impulse held at zero, or the last stretch of a release, is as good as finished.
+ */
+#define SYNTH_ENV_SILENCE (1.0f/65536.0f)
+static inline int synth_env_is_spent(const struct synth_env *env) {
+  if (env->stage>=4) return 1;
+  if (env->stage<1) return 0;
+  if ((env->v>SYNTH_ENV_SILENCE)||(env->v<-SYNTH_ENV_SILENCE)) return 0;
+  if ((env->rlsv>SYNTH_ENV_SILENCE)||(env->rlsv<-SYNTH_ENV_SILENCE)) return 0;
+  if (env->stage<3) {
+    if ((env->decv>SYNTH_ENV_SILENCE)||(env->decv<-SYNTH_ENV_SILENCE)) return 0;
+  }
+  return 1;
+}
+
 static inline float synth_env_update(struct synth_env *env) {
-  if (!env->ttl) synth_env_advance(env);
+  if (env->ttl<=0) synth_env_advance(env);
   env->ttl--;
   env->v+=env->dv;
   return env->v;
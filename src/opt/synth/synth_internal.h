@@ -10,11 +10,14 @@
 #include "synth_filter.h"
 #include "synth_delay.h"
 #include "synth_cache.h"
-#include "synth_song.h"
 #include "synth_channel.h"
+#include "synth_simd.h"
 #include "synth_voice.h"
 #include "synth_proc.h"
 #include "synth_playback.h"
+#include "synth_queue.h"
+#include "synth_bgprint.h"
+#include "synth_diskcache.h"
 #include "opt/midi/midi.h"
 #include "opt/rom/rom.h"
 #include "egg/egg_store.h"
@@ -23,6 +26,8 @@
 #include <limits.h>
 #include <stdio.h>
 #include <math.h>
+#include <time.h>
+#include <unistd.h>
 
 #define MIDI_OPCODE_NOTE_ONCE 0x98
 
@@ -38,7 +43,6 @@
 #define SYNTH_WAVE_SIZE_BITS 10
 #define SYNTH_WAVE_SIZE_SAMPLES (1<<SYNTH_WAVE_SIZE_BITS)
 #define SYNTH_WAVE_SHIFT (32-SYNTH_WAVE_SIZE_BITS)
-#define SYNTH_HARMONICS_LIMIT ((SYNTH_WAVE_SIZE_SAMPLES>>1)-1) /* way more than one would actually provide in a sane universe */
 
 /* MIDI allows 16 channels, and our songs are limited to 8.
  * So channels 8..15 are only reachable thru our API, songs can't touch them.
@@ -47,13 +51,19 @@
 #define SYNTH_CHANNEL_COUNT 16
 #define SYNTH_SONG_CHANNEL_COUNT 8
 
-/* Signal-generating objects live in fixed-size lists.
- * When a new one gets created, it might evict some older one.
- * Safe to raise or lower these limits arbitrarily.
+/* Signal-generating objects live in lists whose capacity is fixed between calls to synth_set_voice_limits.
+ * When a new one gets created and its list is full, it evicts the least valuable one (see *_compare).
+ * These are the default capacities.
+ * SYNTH_OBJECT_LIMIT is a sanity limit for all three.
  */
 #define SYNTH_VOICE_LIMIT 32
 #define SYNTH_PROC_LIMIT 16
 #define SYNTH_PLAYBACK_LIMIT 16
+#define SYNTH_OBJECT_LIMIT 4096
+
+#include "synth_pool.h"
+#include "synth_wave.h"
+#include "synth_song.h"
 
 struct synth {
   int rate;
@@ -64,13 +74,36 @@ struct synth {
   uint32_t ifreqv[0x80]; // Note frequencies in 0..0xffffffff, for wave runners.
   int update_in_progress; // Duration of running update in frames, for new pcm printers.
   int64_t framec; // Total count generated since construction.
+  int64_t framep; // Same idea, but advances as we go thru an update, not all at once at the start.
   struct rom *rom; // WEAK, OPTIONAL
   struct synth_cache *cache;
+  const struct synth_simd *simd; // Never null.
+  struct synth_pool *pool; // Never null.
+  
+  // Commands from another thread, and the clock they use to schedule themselves.
+  struct synth_queue queue;
+  atomic_uint clock_seq;
+  atomic_llong clock_frame;
+  atomic_llong clock_ns;
+  atomic_int clock_framec;
+  
+  // Song state for other threads, published under (clock_seq) at the end of each update and after each posted song command.
+  // Touch (song) and (song_next) only from the audio thread; getters read these instead.
+  atomic_int pub_song_present;
+  atomic_int pub_song_qual,pub_song_songid,pub_song_repeat;
+  atomic_int pub_song_framep,pub_song_tempo,pub_song_durms;
+  atomic_uint pub_song_serial;
+  unsigned int song_serial; // Audio thread: Last serial applied.
+  
+  // Posting thread only: Song commands not yet applied, so getters can report them right away.
+  unsigned int post_serial; // Last serial assigned.
+  unsigned int post_song_serial,post_beats_serial; // Serial of the last play_song and set_playhead posted, zero if none.
+  int post_qual,post_songid,post_repeat;
+  double post_beats;
   
   // Event graph.
   struct synth_song *song;
   struct synth_song *song_next;
-  double song_duration;
   struct synth_channel *channelv[SYNTH_CHANNEL_COUNT];
   int pidv[SYNTH_CHANNEL_COUNT];
   struct synth_builtin override_pid_0; // Hack for live instrument editor.
@@ -78,14 +111,29 @@ struct synth {
   // Signal graph.
   float qbuf[SYNTH_BUFFER_LIMIT];
   float qlevel;
-  struct synth_voice voicev[SYNTH_VOICE_LIMIT];
-  int voicec;
-  struct synth_proc procv[SYNTH_PROC_LIMIT];
-  int procc;
-  struct synth_playback playbackv[SYNTH_PLAYBACK_LIMIT];
-  int playbackc;
+  int dither; // Add TPDF dither when quantizing floats.
+  struct synth_noise dithernoise;
+  float dbuf[SYNTH_BUFFER_LIMIT*2]; // Two uniform samples per quantized sample. See synth_simd.h.
+  struct synth_voice *voicev;
+  int voicec,voicea;
+  struct synth_proc *procv;
+  int procc,proca;
+  struct synth_playback *playbackv;
+  int playbackc,playbacka;
+  int voice_stealc,proc_stealc,playback_stealc; // Live objects evicted to make room.
+  int notev[SYNTH_CHANNEL_COUNT<<7]; // Index in (voicev) +1 of the latest voice started for (chid<<7)|noteid. Zero, stale, or wrong are all possible.
   struct sfg_printer **printerv;
   int printerc,printera;
+  struct synth_bgprint *bgprint; // OPTIONAL. If present, new printers go here instead of (printerv).
+  double print_budget; // Fraction of each update's duration that foreground printers may use, or zero for unlimited.
+  int print_budget_samples; // Limit per update for all foreground printers together, or zero for unlimited.
+  int print_missc; // Updates where a printer couldn't keep up with its playback.
+  int64_t print_lagc; // Total frames of shortfall.
+  int print_lag_max; // Largest single shortfall.
+  struct synth_diskcache *diskcache; // OPTIONAL.
+  uint32_t noiseseed; // Advances with each noise voice.
+  struct synth_wave **wavev; // Sorted by key. See synth_wave.h.
+  int wavec,wavea;
 };
 
 void synth_end_song(struct synth *synth);
@@ -98,10 +146,40 @@ struct synth_voice *synth_voice_new(struct synth *synth);
 struct synth_proc *synth_proc_new(struct synth *synth);
 struct synth_playback *synth_playback_new(struct synth *synth);
 struct synth_voice *synth_find_voice_by_chid_noteid(struct synth *synth,uint8_t chid,uint8_t noteid);
+void synth_index_voice(struct synth *synth,struct synth_voice *voice);
 struct synth_proc *synth_find_proc_by_chid(struct synth *synth,uint8_t chid);
 
-float *synth_wave_new_harmonics(const struct synth *synth,const uint8_t *coefv,int coefc);
-
 int synth_frames_per_beat(const struct synth *synth);
 
+/* Call at the start of each top-level update, with its length in frames.
+ * Drain applies every command due by (synth->framep),
+ * and returns the count of frames we can render before the next one, up to (framec).
+ */
+void synth_clock_publish(struct synth *synth,int framec);
+int synth_drain_commands(struct synth *synth,int framec);
+
+/* Audio thread publishes (song_next) if present, otherwise (song), at the end of each update.
+ * Anyone may read, and we retry until we get a clean copy.
+ */
+void synth_song_publish(struct synth *synth);
+void synth_song_read(struct synth_song_state *state,const struct synth *synth);
+
+// Monotonic clock in nanoseconds.
+int64_t synth_now_ns();
+
+/* Advance foreground printers as far as this update's playbacks will read, within the budget. See synth_printsched.c.
+ * Call at the start of each update, with its length in frames.
+ */
+void synth_schedule_printers(struct synth *synth,int framec);
+
+/* Linear balance: Center is (1,1), and one side fades out as you move toward the other.
+ * (pan) in -1..1.
+ */
+static inline void synth_pan_gains(float *l,float *r,float pan) {
+  if (pan<=-1.0f) { *l=1.0f; *r=0.0f; }
+  else if (pan>=1.0f) { *l=0.0f; *r=1.0f; }
+  else if (pan<0.0f) { *l=1.0f; *r=1.0f+pan; }
+  else { *l=1.0f-pan; *r=1.0f; }
+}
+
 #endif
@@ -16,17 +16,51 @@ void synth_playback_init(struct synth *synth,struct synth_playback *playback,str
   playback->pcm=pcm;
   playback->p=0;
   playback->gain=trim;
+  synth_pan_gains(&playback->gainl,&playback->gainr,pan);
+  playback->gainl*=trim;
+  playback->gainr*=trim;
 }
 
 /* Update.
+ * If the printer is running behind us, we stop at its edge and hold position until it catches up.
  */
 
 void synth_playback_update(float *v,int c,struct synth *synth,struct synth_playback *playback) {
   if (!playback->pcm) return;
-  const float *src=playback->pcm->v+playback->p;
-  int i=playback->pcm->c-playback->p;
+  int i=atomic_load_explicit(&playback->pcm->ready,memory_order_acquire)-playback->p;
   if (i>c) i=c;
   else c=i;
-  for (;i-->0;v++,src++) (*v)+=(*src)*playback->gain;
+  if (playback->pcm->iv) {
+    const int16_t *src=playback->pcm->iv+playback->p;
+    float gain=playback->gain*playback->pcm->iscale;
+    for (;i-->0;v++,src++) (*v)+=(float)(*src)*gain;
+  } else {
+    const float *src=playback->pcm->v+playback->p;
+    for (;i-->0;v++,src++) (*v)+=(*src)*playback->gain;
+  }
+  playback->p+=c;
+}
+
+void synth_playback_update_stereo(float *v,int c,struct synth *synth,struct synth_playback *playback) {
+  if (!playback->pcm) return;
+  int i=atomic_load_explicit(&playback->pcm->ready,memory_order_acquire)-playback->p;
+  if (i>c) i=c;
+  else c=i;
+  if (playback->pcm->iv) {
+    const int16_t *src=playback->pcm->iv+playback->p;
+    float l=playback->gainl*playback->pcm->iscale,r=playback->gainr*playback->pcm->iscale;
+    for (;i-->0;v+=2,src++) {
+      float sample=(float)(*src);
+      v[0]+=sample*l;
+      v[1]+=sample*r;
+    }
+  } else {
+    const float *src=playback->pcm->v+playback->p;
+    float l=playback->gainl,r=playback->gainr;
+    for (;i-->0;v+=2,src++) {
+      v[0]+=(*src)*l;
+      v[1]+=(*src)*r;
+    }
+  }
   playback->p+=c;
 }
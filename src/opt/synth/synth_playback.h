@@ -8,14 +8,19 @@
 struct synth_playback {
   struct sfg_pcm *pcm;
   int p;
-  float gain; //TODO If we go stereo, make two gains and bake pan into them.
+  float gain; // For mono output.
+  float gainl,gainr; // For stereo, with pan baked in.
 };
 
 void synth_playback_cleanup(struct synth_playback *playback);
 
 void synth_playback_init(struct synth *synth,struct synth_playback *playback,struct sfg_pcm *pcm,double trim,double pan);
 
+/* Mono adds (c) samples to (v).
+ * Stereo adds (c) frames to (v), interleaved, so (v) is (c*2) samples long.
+ */
 void synth_playback_update(float *v,int c,struct synth *synth,struct synth_playback *playback);
+void synth_playback_update_stereo(float *v,int c,struct synth *synth,struct synth_playback *playback);
 
 static inline int synth_playback_is_defunct(const struct synth_playback *playback) {
   if (!playback->pcm) return 1;
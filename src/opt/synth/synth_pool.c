@@ -0,0 +1,221 @@
+#include "synth_internal.h"
+
+/* Run one lane.
+ */
+ 
+static void synth_lane_run(struct synth *synth,struct synth_lane *lane,int framec) {
+  int i;
+  if (synth->chanc==1) {
+    memset(lane->buf,0,sizeof(float)*framec);
+    for (i=0;i<lane->voicec;i++) synth_voice_update(lane->buf,framec,synth,lane->voicev[i]);
+    for (i=0;i<lane->procc;i++) synth_proc_update(lane->buf,framec,synth,lane->procv[i]);
+    for (i=0;i<lane->playbackc;i++) synth_playback_update(lane->buf,framec,synth,lane->playbackv[i]);
+  } else {
+    memset(lane->buf,0,sizeof(float)*(framec<<1));
+    for (i=0;i<lane->voicec;i++) synth_voice_update(lane->buf,framec,synth,lane->voicev[i]);
+    for (i=0;i<lane->procc;i++) synth_proc_update(lane->buf,framec,synth,lane->procv[i]);
+    for (i=0;i<lane->playbackc;i++) synth_playback_update_stereo(lane->buf,framec,synth,lane->playbackv[i]);
+  }
+}
+
+static inline int synth_lane_is_empty(const struct synth_lane *lane) {
+  return !lane->voicec&&!lane->procc&&!lane->playbackc;
+}
+
+/* Run all the lanes belonging to one thread.
+ */
+ 
+static void synth_pool_run(struct synth_pool *pool,int threadp,int framec) {
+  int lanep=threadp;
+  for (;lanep<SYNTH_LANE_COUNT;lanep+=pool->threadc) {
+    struct synth_lane *lane=pool->lanev+lanep;
+    if (synth_lane_is_empty(lane)) continue;
+    synth_lane_run(pool->synth,lane,framec);
+  }
+}
+
+/* Worker thread.
+ */
+ 
+static void *synth_worker_main(void *arg) {
+  struct synth_worker *worker=arg;
+  struct synth_pool *pool=worker->pool;
+  int generation=0;
+  unsigned int fpstate=synth_denormals_disable();
+  pthread_mutex_lock(&pool->mutex);
+  for (;;) {
+    while (!pool->quit&&(pool->generation==generation)) pthread_cond_wait(&pool->cond_start,&pool->mutex);
+    if (pool->quit) break;
+    generation=pool->generation;
+    int framec=pool->framec;
+    pthread_mutex_unlock(&pool->mutex);
+    synth_pool_run(pool,worker->index,framec);
+    pthread_mutex_lock(&pool->mutex);
+    if (!--(pool->pending)) pthread_cond_signal(&pool->cond_done);
+  }
+  pthread_mutex_unlock(&pool->mutex);
+  synth_denormals_restore(fpstate);
+  return 0;
+}
+
+/* Delete.
+ */
+ 
+void synth_pool_del(struct synth_pool *pool) {
+  if (!pool) return;
+  if (pool->workerc>0) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->quit=1;
+    pthread_cond_broadcast(&pool->cond_start);
+    pthread_mutex_unlock(&pool->mutex);
+    while (pool->workerc>0) {
+      pool->workerc--;
+      pthread_join(pool->workerv[pool->workerc].thread,0);
+    }
+  }
+  pthread_cond_destroy(&pool->cond_start);
+  pthread_cond_destroy(&pool->cond_done);
+  pthread_mutex_destroy(&pool->mutex);
+  struct synth_lane *lane=pool->lanev;
+  int i=SYNTH_LANE_COUNT;
+  for (;i-->0;lane++) {
+    if (lane->voicev) free(lane->voicev);
+    if (lane->procv) free(lane->procv);
+    if (lane->playbackv) free(lane->playbackv);
+  }
+  free(pool);
+}
+
+/* New.
+ */
+ 
+struct synth_pool *synth_pool_new(struct synth *synth,int threadc) {
+  if ((threadc<1)||(threadc>SYNTH_THREAD_LIMIT)) return 0;
+  struct synth_pool *pool=calloc(1,sizeof(struct synth_pool));
+  if (!pool) return 0;
+  pool->synth=synth;
+  pool->threadc=threadc;
+  pthread_mutex_init(&pool->mutex,0);
+  pthread_cond_init(&pool->cond_start,0);
+  pthread_cond_init(&pool->cond_done,0);
+  if (synth_pool_require(pool,synth->voicea,synth->proca,synth->playbacka)<0) {
+    synth_pool_del(pool);
+    return 0;
+  }
+  while (pool->workerc<threadc-1) {
+    struct synth_worker *worker=pool->workerv+pool->workerc;
+    worker->pool=pool;
+    worker->index=pool->workerc+1;
+    if (pthread_create(&worker->thread,0,synth_worker_main,worker)) {
+      synth_pool_del(pool);
+      return 0;
+    }
+    pool->workerc++;
+  }
+  return pool;
+}
+
+/* Grow lanes.
+ * Dealing is round-robin, so no lane ever gets more than its share rounded up.
+ */
+ 
+#define REQUIRE(t) { \
+  int na=(t##a+SYNTH_LANE_COUNT-1)/SYNTH_LANE_COUNT; \
+  if (na>pool->t##a) { \
+    struct synth_lane *lane=pool->lanev; \
+    int i=SYNTH_LANE_COUNT; \
+    for (;i-->0;lane++) { \
+      void *nv=realloc(lane->t##v,sizeof(void*)*na); \
+      if (!nv) return -1; \
+      lane->t##v=nv; \
+    } \
+    pool->t##a=na; \
+  } \
+}
+ 
+int synth_pool_require(struct synth_pool *pool,int voicea,int proca,int playbacka) {
+  if ((voicea>SYNTH_OBJECT_LIMIT)||(proca>SYNTH_OBJECT_LIMIT)||(playbacka>SYNTH_OBJECT_LIMIT)) return -1;
+  REQUIRE(voice)
+  REQUIRE(proc)
+  REQUIRE(playback)
+  return 0;
+}
+
+#undef REQUIRE
+
+/* Deal objects into lanes.
+ * Round-robin in list order. Every voice carries its own state, so lane assignment doesn't affect the output.
+ * Returns nonzero if anything is live. The first one always lands in lane zero.
+ */
+ 
+static int synth_pool_deal(struct synth_pool *pool) {
+  struct synth *synth=pool->synth;
+  struct synth_lane *lane=pool->lanev;
+  int i=SYNTH_LANE_COUNT;
+  for (;i-->0;lane++) {
+    lane->voicec=0;
+    lane->procc=0;
+    lane->playbackc=0;
+  }
+  int lanep=0;
+  struct synth_voice *voice=synth->voicev;
+  for (i=synth->voicec;i-->0;voice++) {
+    if (synth_voice_is_defunct(voice)) continue;
+    lane=pool->lanev+lanep;
+    if (++lanep>=SYNTH_LANE_COUNT) lanep=0;
+    lane->voicev[lane->voicec++]=voice;
+  }
+  struct synth_proc *proc=synth->procv;
+  for (i=synth->procc;i-->0;proc++) {
+    if (synth_proc_is_defunct(proc)) continue;
+    lane=pool->lanev+lanep;
+    if (++lanep>=SYNTH_LANE_COUNT) lanep=0;
+    lane->procv[lane->procc++]=proc;
+  }
+  struct synth_playback *playback=synth->playbackv;
+  for (i=synth->playbackc;i-->0;playback++) {
+    if (synth_playback_is_defunct(playback)) continue;
+    lane=pool->lanev+lanep;
+    if (++lanep>=SYNTH_LANE_COUNT) lanep=0;
+    lane->playbackv[lane->playbackc++]=playback;
+  }
+  return !synth_lane_is_empty(pool->lanev);
+}
+
+/* Update.
+ */
+ 
+void synth_pool_update(float *v,int framec,struct synth_pool *pool) {
+  if (framec<1) return;
+  
+  // Silence is the most common case, when a game is idle. Don't wake the workers for it.
+  struct synth *synth=pool->synth;
+  if (!synth->voicec&&!synth->procc&&!synth->playbackc) return;
+  if (!synth_pool_deal(pool)) return;
+  
+  if (pool->workerc>0) {
+    pthread_mutex_lock(&pool->mutex);
+    pool->framec=framec;
+    pool->pending=pool->workerc;
+    pool->generation++;
+    pthread_cond_broadcast(&pool->cond_start);
+    pthread_mutex_unlock(&pool->mutex);
+    synth_pool_run(pool,0,framec);
+    pthread_mutex_lock(&pool->mutex);
+    while (pool->pending>0) pthread_cond_wait(&pool->cond_done,&pool->mutex);
+    pthread_mutex_unlock(&pool->mutex);
+  } else {
+    synth_pool_run(pool,0,framec);
+  }
+  
+  int samplec=(pool->synth->chanc==1)?framec:(framec<<1);
+  const struct synth_lane *lane=pool->lanev;
+  int i=SYNTH_LANE_COUNT;
+  for (;i-->0;lane++) {
+    if (synth_lane_is_empty(lane)) continue;
+    const float *src=lane->buf;
+    float *dst=v;
+    int ii=samplec;
+    for (;ii-->0;dst++,src++) (*dst)+=(*src);
+  }
+}
@@ -0,0 +1,66 @@
+/* synth_pool.h
+ * Spreads the signal graph across worker threads.
+ * Each slice, voices, procs and playbacks are dealt into SYNTH_LANE_COUNT lanes by a fixed rule.
+ * Each lane sums its objects in order into a private buffer, then we sum the lanes in order.
+ * Which thread runs which lane doesn't matter, so output is bit-identical for any thread count.
+ * With one thread, there are no workers and the caller runs every lane itself.
+ */
+
+#ifndef SYNTH_POOL_H
+#define SYNTH_POOL_H
+
+#include <pthread.h>
+
+#define SYNTH_LANE_COUNT 8
+#define SYNTH_THREAD_LIMIT 16
+
+struct synth_lane {
+  float buf[SYNTH_BUFFER_LIMIT]; // Same layout as the main output: Mono, or interleaved stereo.
+  struct synth_voice **voicev;
+  int voicec;
+  struct synth_proc **procv;
+  int procc;
+  struct synth_playback **playbackv;
+  int playbackc;
+};
+
+struct synth_worker {
+  struct synth_pool *pool;
+  pthread_t thread;
+  int index; // 1..threadc-1. Caller is zero.
+};
+
+struct synth_pool {
+  struct synth *synth; // WEAK
+  int threadc; // Including the caller.
+  struct synth_worker workerv[SYNTH_THREAD_LIMIT];
+  int workerc; // Count of (workerv) actually running.
+  pthread_mutex_t mutex;
+  pthread_cond_t cond_start;
+  pthread_cond_t cond_done;
+  int generation;
+  int pending;
+  int quit;
+  int framec; // Current job.
+  int voicea,proca,playbacka; // Capacity of each lane's lists.
+  struct synth_lane lanev[SYNTH_LANE_COUNT];
+};
+
+void synth_pool_del(struct synth_pool *pool);
+
+/* (threadc) in 1..SYNTH_THREAD_LIMIT, the total including the audio thread.
+ */
+struct synth_pool *synth_pool_new(struct synth *synth,int threadc);
+
+/* Make room in the lanes for the given count of each object, in total.
+ * Never shrinks. Call before raising the limits on (synth).
+ */
+int synth_pool_require(struct synth_pool *pool,int voicea,int proca,int playbacka);
+
+/* Add (framec) frames of output to (v), from every voice, proc, and playback.
+ * (v) is mono if (synth->chanc==1), otherwise interleaved stereo.
+ * Caller must hold off on event processing until we return.
+ */
+void synth_pool_update(float *v,int framec,struct synth_pool *pool);
+
+#endif
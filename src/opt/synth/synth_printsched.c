@@ -0,0 +1,124 @@
+#include "synth_internal.h"
+
+/* Printer scheduling, at the start of each update, when printing in the foreground.
+ * Each printer only needs to stay ahead of its furthest playback by the length of this update.
+ * We serve them in order of urgency, in slices, and stop when the budget runs out:
+ *   1. Printers whose sound is already underway. Falling behind here stalls it mid-sound.
+ *   2. Printers whose sound hasn't started yet. Falling behind here only delays its start.
+ *   3. Printers with no playback at all, finishing up for the cache. These trickle along at realtime, if there's room.
+ * Whatever doesn't fit waits for the next update. Playbacks hold position at the printer's edge,
+ * so the sound comes out late, rather than the whole callback coming out late.
+ */
+
+#define SYNTH_PRINT_SLICE 1024
+
+/* Furthest position of any playback reading this pcm, or -1 if none.
+ */
+
+static int synth_printer_head(const struct synth *synth,const struct sfg_pcm *pcm) {
+  int head=-1;
+  const struct synth_playback *playback=synth->playbackv;
+  int i=synth->playbackc;
+  for (;i-->0;playback++) {
+    if (playback->pcm!=pcm) continue;
+    if (playback->p>head) head=playback->p;
+  }
+  return head;
+}
+
+/* Print up to (c) from one printer, in slices, checking the budget between.
+ * Returns the count printed.
+ */
+
+static int synth_print_within_budget(struct sfg_printer *printer,int c,int64_t deadline,int *samplec) {
+  int printed=0;
+  while (c>0) {
+    if (*samplec<1) break;
+    if (deadline&&(synth_now_ns()>=deadline)) break;
+    int updc=SYNTH_PRINT_SLICE;
+    if (updc>c) updc=c;
+    if (updc>*samplec) updc=*samplec;
+    struct sfg_pcm *pcm=sfg_printer_get_pcm(printer);
+    int ready0=atomic_load_explicit(&pcm->ready,memory_order_relaxed);
+    int done=sfg_printer_update(printer,updc);
+    int d=atomic_load_explicit(&pcm->ready,memory_order_relaxed)-ready0;
+    printed+=d;
+    (*samplec)-=d;
+    c-=d;
+    if (done||(d<1)) break;
+  }
+  return printed;
+}
+
+/* Swap in sounds the background printer compacted for us.
+ * One binary search each. The old float copy usually lives on in a playback, so this rarely frees anything.
+ */
+
+static void synth_collect_compacted(struct synth *synth) {
+  struct synth_bgprint_done done;
+  while (synth_bgprint_collect(&done,synth->bgprint)>0) {
+    int p=synth_cache_search(synth->cache,done.qual,done.soundid);
+    if ((p>=0)&&(synth_cache_get(synth->cache,p)==done.pcm)) {
+      synth_cache_replace(synth->cache,p,done.compact);
+    }
+    sfg_pcm_del(done.pcm);
+    sfg_pcm_del(done.compact);
+  }
+}
+
+/* Schedule, main entry point.
+ */
+
+void synth_schedule_printers(struct synth *synth,int framec) {
+  if (synth->bgprint) synth_collect_compacted(synth);
+  if (synth->printerc<1) return;
+  int64_t deadline=0;
+  if (synth->print_budget>0.0) {
+    int64_t ns=(int64_t)(((double)framec*1000000000.0*synth->print_budget)/(double)synth->rate);
+    deadline=synth_now_ns()+ns;
+  }
+  int samplec=(synth->print_budget_samples>0)?synth->print_budget_samples:INT_MAX;
+  int missed=0,tier=0;
+  for (;tier<3;tier++) {
+    int i=0;
+    for (;i<synth->printerc;i++) {
+      struct sfg_printer *printer=synth->printerv[i];
+      struct sfg_pcm *pcm=sfg_printer_get_pcm(printer);
+      int ready=atomic_load_explicit(&pcm->ready,memory_order_relaxed);
+      if (ready>=pcm->c) continue;
+      int head=synth_printer_head(synth,pcm);
+      if (tier==0) { if (head<1) continue; }
+      else if (tier==1) { if (head) continue; }
+      else if (head>=0) continue;
+      int need=(head<0)?framec:(head+framec-ready);
+      if (need>pcm->c-ready) need=pcm->c-ready;
+      if (need<1) continue;
+      int printed=synth_print_within_budget(printer,need,deadline,&samplec);
+      if ((tier<2)&&(printed<need)) {
+        int lag=need-printed;
+        missed=1;
+        synth->print_lagc+=lag;
+        if (lag>synth->print_lag_max) synth->print_lag_max=lag;
+      }
+    }
+  }
+  if (missed) synth->print_missc++;
+
+  // Drop the finished ones. They stay float; compacting is too much work for the audio thread.
+  int i=synth->printerc;
+  struct sfg_printer **p=synth->printerv+i-1;
+  for (;i-->0;p--) {
+    if (!sfg_printer_update(*p,0)) continue;
+    sfg_printer_del(*p);
+    synth->printerc--;
+    memmove(p,p+1,sizeof(void*)*(synth->printerc-i));
+  }
+}
+
+/* Set budget.
+ */
+
+void synth_set_print_budget(struct synth *synth,double fraction,int samplec) {
+  synth->print_budget=(fraction>0.0)?fraction:0.0;
+  synth->print_budget_samples=(samplec>0)?samplec:0;
+}
@@ -7,4 +7,6 @@ void synth_proc_init(struct synth *synth,struct synth_proc *proc) {
   proc->chid=0xff;
   proc->origin=0;
   proc->birthday=synth->framec;
+  proc->panl=1.0f;
+  proc->panr=1.0f;
 }
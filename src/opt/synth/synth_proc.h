@@ -10,9 +10,10 @@ struct synth_proc {
   uint8_t chid;
   uint8_t origin;
   int64_t birthday;
+  float panl,panr; // Follows the channel's pan.
   void *userdata;
   void (*del)(struct synth_proc *proc);
-  void (*update)(float *v,int c,struct synth *synth,struct synth_proc *proc);
+  void (*update)(float *v,int c,struct synth *synth,struct synth_proc *proc); // (v) is interleaved if stereo; apply (panl,panr) yourself.
   void (*release)(struct synth *synth,struct synth_proc *proc);
   void (*control)(struct synth *synth,struct synth_proc *proc,uint8_t k,uint8_t v);
   void (*wheel)(struct synth *synth,struct synth_proc *proc,uint16_t v);
@@ -3,11 +3,11 @@
 #define SYNTH_FX_VOICE_LIMIT 8
 
 struct synth_fx_voice {
-  float carp; // radians
-  float modp; // radians
-  float cardp0;
-  float cardp;
-  float moddp;
+  uint32_t carp;
+  uint32_t modp;
+  uint32_t cardp0; // before wheel
+  uint32_t cardp;
+  uint32_t moddp;
   struct synth_env level;
   struct synth_env range;
   int64_t birthday;
@@ -33,6 +33,8 @@ struct synth_fx_context {
   uint32_t detunep;
   uint32_t detunedp;
   int ttl;
+  int idle; // Frames since the last voice went quiet.
+  int ringout; // How long the effects keep sounding after that. Beyond it, we skip the whole update.
   float buf[SYNTH_BUFFER_LIMIT];
   float lfobuf[SYNTH_BUFFER_LIMIT];
 };
@@ -51,28 +53,50 @@ static void _fx_del(struct synth_proc *proc) {
 }
 
 /* Update voice.
+ * It's the same oscillator as FMREL, plus the range LFO, so use the same kernel.
  */
  
 static inline void _fx_voice_update(float *v,int c,struct synth *synth,struct synth_proc *proc,struct synth_fx_voice *voice) {
-  if (synth_env_is_finished(&voice->level)) return;
-  const float *lfo=CTX->lfobuf;
-  for (;c-->0;v++,lfo++) {
-  
-    (*v)+=sinf(voice->carp)*synth_env_update(&voice->level);
-    
-    float mod=sinf(voice->modp);
-    mod*=synth_env_update(&voice->range)+*lfo;
-    voice->modp+=voice->moddp;
-    if (voice->modp>M_PI) voice->modp-=M_PI*2.0f;
-    voice->carp+=voice->cardp+voice->cardp*mod;
-    if (voice->carp>M_PI) voice->carp-=M_PI*2.0f;
+  if (synth_env_is_spent(&voice->level)) return;
+  float levelv[SYNTH_BUFFER_LIMIT];
+  float rangev[SYNTH_BUFFER_LIMIT];
+  synth_env_fill(levelv,c,&voice->level);
+  synth_env_fill(rangev,c,&voice->range);
+  if (CTX->lforange>0.0f) {
+    const float *lfo=CTX->lfobuf;
+    float *range=rangev;
+    int i=c;
+    for (;i-->0;range++,lfo++) (*range)+=(*lfo);
   }
+  synth->simd->fm(v,c,synth->sine,&voice->carp,voice->cardp,&voice->modp,voice->moddp,rangev,levelv,0);
 }
 
 /* Update.
  */
 
+/* Nothing playing and the effects have rung out.
+ * Advance the free-running phases as if we'd run, so whatever comes next sounds the same.
+ */
+ 
+static void _fx_skip(int c,struct synth *synth,struct synth_proc *proc) {
+  CTX->lfop+=CTX->lfodp*(uint32_t)c;
+  CTX->detunep+=CTX->detunedp*(uint32_t)c;
+  if (CTX->delay.c>0) CTX->delay.p=(CTX->delay.p+c)%CTX->delay.c;
+  if (CTX->detune.c>0) CTX->detune.p=(CTX->detune.p+c)%CTX->detune.c;
+  if (CTX->ttl>0) {
+    if ((CTX->ttl-=c)<=0) proc->update=0;
+  }
+}
+
 static void _fx_update(float *v,int c,struct synth *synth,struct synth_proc *proc) {
+  if (CTX->voicec) {
+    CTX->idle=0;
+  } else if (CTX->idle>=CTX->ringout) {
+    _fx_skip(c,synth,proc);
+    return;
+  } else if (CTX->ringout<INT_MAX) {
+    CTX->idle+=c;
+  }
   memset(CTX->buf,0,sizeof(float)*c);
   
   // Calculate FM range LFO.
@@ -91,7 +115,7 @@ static void _fx_update(float *v,int c,struct synth *synth,struct synth_proc *pro
   for (;i-->0;voice++) {
     _fx_voice_update(CTX->buf,c,synth,proc,voice);
   }
-  while (CTX->voicec&&synth_env_is_finished(&CTX->voicev[CTX->voicec-1].level)) CTX->voicec--;
+  while (CTX->voicec&&synth_env_is_spent(&CTX->voicev[CTX->voicec-1].level)) CTX->voicec--;
   
   // Overdrive.
   if (CTX->drive>0.0f) {
@@ -143,8 +167,12 @@ static void _fx_update(float *v,int c,struct synth *synth,struct synth_proc *pro
     }
   }
   
-  const float *src=CTX->buf;
-  for (i=c;i-->0;v++,src++) (*v)+=(*src);
+  if (synth->chanc==2) {
+    synth->simd->pan_add(v,c,CTX->buf,proc->panl,proc->panr);
+  } else {
+    const float *src=CTX->buf;
+    for (i=c;i-->0;v++,src++) (*v)+=(*src);
+  }
 }
 
 /* Release all notes.
@@ -179,8 +207,8 @@ static void _fx_wheel(struct synth *synth,struct synth_proc *proc,uint16_t v) {
   struct synth_fx_voice *voice=CTX->voicev;
   int i=CTX->voicec;
   for (;i-->0;voice++) {
-    voice->cardp=voice->cardp0*CTX->bend;
-    voice->moddp=voice->cardp*CTX->modrate;
+    voice->cardp=(uint32_t)((float)voice->cardp0*CTX->bend);
+    voice->moddp=(uint32_t)(int64_t)((float)voice->cardp*CTX->modrate);
   }
 }
 
@@ -197,7 +225,7 @@ static void _fx_note_once(struct synth *synth,struct synth_proc *proc,uint8_t no
     struct synth_fx_voice *q=CTX->voicev;
     int i=CTX->voicec;
     for (;i-->0;q++) {
-      if (synth_env_is_finished(&q->level)) {
+      if (synth_env_is_spent(&q->level)) {
         voice=q;
         break;
       }
@@ -207,11 +235,11 @@ static void _fx_note_once(struct synth *synth,struct synth_proc *proc,uint8_t no
     }
   }
   
-  voice->carp=0.0f;
-  voice->modp=0.0f;
-  voice->cardp0=synth->ffreqv[noteid&0x7f]*M_PI*2.0f;
-  voice->cardp=voice->cardp0*CTX->bend;
-  voice->moddp=voice->cardp*CTX->modrate;
+  voice->carp=0;
+  voice->modp=0;
+  voice->cardp0=synth->ifreqv[noteid&0x7f];
+  voice->cardp=(uint32_t)((float)voice->cardp0*CTX->bend);
+  voice->moddp=(uint32_t)(int64_t)((float)voice->cardp*CTX->modrate); // May exceed one cycle per frame; let it wrap.
   synth_env_init(&voice->level,&CTX->level,velocity,dur);
   synth_env_init(&voice->range,&CTX->range,velocity,dur);
   voice->birthday=synth->framec;
@@ -296,5 +324,11 @@ int synth_proc_fx_init(struct synth *synth,struct synth_proc *proc,struct synth_
     if (synth_detune_init(&CTX->detune,framec)<0) return -1;
   }
   
+  // Delay repeats until the feedback takes it below audibility. Detune just needs to flush its buffer.
+  // Full feedback holds forever, so then we never skip.
+  CTX->ringout=synth_delay_ringout(&CTX->delay);
+  if (CTX->ringout>INT_MAX-CTX->detune.c) CTX->ringout=INT_MAX;
+  else CTX->ringout+=CTX->detune.c;
+  
   return 0;
 }
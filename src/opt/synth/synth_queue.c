@@ -0,0 +1,197 @@
+#include "synth_internal.h"
+
+/* Push.
+ */
+ 
+int synth_queue_push(struct synth_queue *queue,const struct synth_command *command) {
+  unsigned int tail=atomic_load_explicit(&queue->tail,memory_order_relaxed);
+  unsigned int head=atomic_load_explicit(&queue->head,memory_order_acquire);
+  if (tail-head>=SYNTH_QUEUE_SIZE) return -1;
+  memcpy(queue->v+(tail&(SYNTH_QUEUE_SIZE-1)),command,sizeof(struct synth_command));
+  atomic_store_explicit(&queue->tail,tail+1,memory_order_release);
+  return 0;
+}
+
+/* Monotonic clock in nanoseconds.
+ */
+ 
+int64_t synth_now_ns() {
+  struct timespec ts={0};
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+  return (int64_t)ts.tv_sec*1000000000ll+ts.tv_nsec;
+}
+
+/* Publish clock, at the start of each top-level update.
+ * A seqlock: Odd (clock_seq) means we're mid-write.
+ */
+ 
+void synth_clock_publish(struct synth *synth,int framec) {
+  unsigned int seq=atomic_load_explicit(&synth->clock_seq,memory_order_relaxed);
+  atomic_store_explicit(&synth->clock_seq,seq+1,memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  atomic_store_explicit(&synth->clock_frame,synth->framep,memory_order_relaxed);
+  atomic_store_explicit(&synth->clock_ns,synth_now_ns(),memory_order_relaxed);
+  atomic_store_explicit(&synth->clock_framec,framec,memory_order_relaxed);
+  atomic_store_explicit(&synth->clock_seq,seq+2,memory_order_release);
+}
+
+/* Publish song state, same seqlock as the clock.
+ * Report "next" if present, so we're discussing the new song as soon as it's installed.
+ * Its playhead lingers at zero until it starts playing for real.
+ */
+ 
+void synth_song_publish(struct synth *synth) {
+  const struct synth_song *song=synth->song_next?synth->song_next:synth->song;
+  unsigned int seq=atomic_load_explicit(&synth->clock_seq,memory_order_relaxed);
+  atomic_store_explicit(&synth->clock_seq,seq+1,memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  if (song) {
+    atomic_store_explicit(&synth->pub_song_present,1,memory_order_relaxed);
+    atomic_store_explicit(&synth->pub_song_qual,song->qual,memory_order_relaxed);
+    atomic_store_explicit(&synth->pub_song_songid,song->songid,memory_order_relaxed);
+    atomic_store_explicit(&synth->pub_song_repeat,song->repeat,memory_order_relaxed);
+    atomic_store_explicit(&synth->pub_song_framep,song->framep,memory_order_relaxed);
+    atomic_store_explicit(&synth->pub_song_tempo,song->tempo,memory_order_relaxed);
+    atomic_store_explicit(&synth->pub_song_durms,song->durms,memory_order_relaxed);
+  } else {
+    atomic_store_explicit(&synth->pub_song_present,0,memory_order_relaxed);
+  }
+  atomic_store_explicit(&synth->pub_song_serial,synth->song_serial,memory_order_relaxed);
+  atomic_store_explicit(&synth->clock_seq,seq+2,memory_order_release);
+}
+
+/* Read published song state.
+ * The writer never holds the lock for more than a few stores, so just spin until it's clean.
+ */
+ 
+void synth_song_read(struct synth_song_state *state,const struct synth *synth) {
+  for (;;) {
+    unsigned int seq=atomic_load_explicit(&synth->clock_seq,memory_order_acquire);
+    if (seq&1) continue;
+    state->present=atomic_load_explicit(&synth->pub_song_present,memory_order_relaxed);
+    state->qual=atomic_load_explicit(&synth->pub_song_qual,memory_order_relaxed);
+    state->songid=atomic_load_explicit(&synth->pub_song_songid,memory_order_relaxed);
+    state->repeat=atomic_load_explicit(&synth->pub_song_repeat,memory_order_relaxed);
+    state->framep=atomic_load_explicit(&synth->pub_song_framep,memory_order_relaxed);
+    state->tempo=atomic_load_explicit(&synth->pub_song_tempo,memory_order_relaxed);
+    state->durms=atomic_load_explicit(&synth->pub_song_durms,memory_order_relaxed);
+    state->serial=atomic_load_explicit(&synth->pub_song_serial,memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&synth->clock_seq,memory_order_relaxed)==seq) return;
+  }
+}
+
+/* Estimate the frame a command posted right now should land on.
+ * That's where the audio thread was at its last update, plus one update's length,
+ * plus however much real time has elapsed since then (clamped to one update).
+ * If we don't have a clock yet, or can't get a clean read of it, return -1 for "asap".
+ */
+ 
+static int64_t synth_post_time(struct synth *synth) {
+  int i=4; while (i-->0) {
+    unsigned int seq=atomic_load_explicit(&synth->clock_seq,memory_order_acquire);
+    if (seq&1) continue;
+    int64_t frame=atomic_load_explicit(&synth->clock_frame,memory_order_relaxed);
+    int64_t ns=atomic_load_explicit(&synth->clock_ns,memory_order_relaxed);
+    int framec=atomic_load_explicit(&synth->clock_framec,memory_order_relaxed);
+    atomic_thread_fence(memory_order_acquire);
+    if (atomic_load_explicit(&synth->clock_seq,memory_order_relaxed)!=seq) continue;
+    if (!ns) return -1;
+    int64_t dns=synth_now_ns()-ns;
+    if (dns<0) dns=0;
+    else if (dns>1000000000ll) dns=1000000000ll;
+    int64_t dframe=(dns*synth->rate)/1000000000ll;
+    if (dframe>framec) dframe=framec;
+    return frame+framec+dframe;
+  }
+  return -1;
+}
+
+/* Post commands.
+ */
+ 
+int synth_post_play_song(struct synth *synth,int qual,int songid,int force,int repeat) {
+  struct synth_command command={
+    .time=synth_post_time(synth),
+    .type=SYNTH_COMMAND_PLAY_SONG,
+    .iv={qual,songid,force,repeat},
+  };
+  // Without (force), the audio thread ignores a request for the song it already has. Don't report a restart then.
+  int pvqual,pvsongid,pvrepeat;
+  synth_get_song(&pvqual,&pvsongid,&pvrepeat,synth);
+  if (!force&&(pvqual==qual)&&(pvsongid==songid)) return synth_queue_push(&synth->queue,&command);
+  if (!++(synth->post_serial)) synth->post_serial=1;
+  command.serial=synth->post_serial;
+  if (synth_queue_push(&synth->queue,&command)<0) return -1;
+  synth->post_song_serial=command.serial;
+  synth->post_qual=qual;
+  synth->post_songid=songid;
+  synth->post_repeat=repeat;
+  return 0;
+}
+
+int synth_post_play_sound(struct synth *synth,int qual,int soundid,float trim,float pan) {
+  struct synth_command command={
+    .time=synth_post_time(synth),
+    .type=SYNTH_COMMAND_PLAY_SOUND,
+    .iv={qual,soundid},
+    .fv={trim,pan},
+  };
+  return synth_queue_push(&synth->queue,&command);
+}
+
+int synth_post_event(struct synth *synth,uint8_t chid,uint8_t opcode,uint8_t a,uint8_t b) {
+  struct synth_command command={
+    .time=synth_post_time(synth),
+    .type=SYNTH_COMMAND_EVENT,
+    .iv={chid,opcode,a,b},
+  };
+  return synth_queue_push(&synth->queue,&command);
+}
+
+int synth_post_set_playhead(struct synth *synth,double beats) {
+  if (!++(synth->post_serial)) synth->post_serial=1;
+  struct synth_command command={
+    .time=synth_post_time(synth),
+    .type=SYNTH_COMMAND_SET_PLAYHEAD,
+    .serial=synth->post_serial,
+    .beats=beats,
+  };
+  if (synth_queue_push(&synth->queue,&command)<0) return -1;
+  synth->post_beats_serial=command.serial;
+  synth->post_beats=beats;
+  return 0;
+}
+
+/* Apply one command.
+ */
+ 
+static void synth_command_apply(struct synth *synth,const struct synth_command *command) {
+  switch (command->type) {
+    case SYNTH_COMMAND_PLAY_SONG: synth_play_song(synth,command->iv[0],command->iv[1],command->iv[2],command->iv[3]); break;
+    case SYNTH_COMMAND_PLAY_SOUND: synth_play_sound(synth,command->iv[0],command->iv[1],command->fv[0],command->fv[1]); break;
+    case SYNTH_COMMAND_EVENT: synth_event(synth,command->iv[0],command->iv[1],command->iv[2],command->iv[3],0); break;
+    case SYNTH_COMMAND_SET_PLAYHEAD: synth_set_playhead(synth,command->beats); break;
+  }
+  if (command->serial) {
+    synth->song_serial=command->serial;
+    synth_song_publish(synth);
+  }
+}
+
+/* Drain queue.
+ */
+ 
+int synth_drain_commands(struct synth *synth,int framec) {
+  const struct synth_command *command;
+  while (command=synth_queue_peek(&synth->queue)) {
+    if (command->time>synth->framep) {
+      int64_t limit=command->time-synth->framep;
+      if (limit<framec) framec=(int)limit;
+      break;
+    }
+    synth_command_apply(synth,command);
+    synth_queue_pop(&synth->queue);
+  }
+  return framec;
+}
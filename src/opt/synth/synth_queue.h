@@ -0,0 +1,64 @@
+/* synth_queue.h
+ * Wait-free single-producer single-consumer ring of timestamped commands.
+ * The game thread posts, and synth_updatef drains at the start of each update.
+ * Commands carry a target time in frames, and we split the update to land them exactly there.
+ */
+
+#ifndef SYNTH_QUEUE_H
+#define SYNTH_QUEUE_H
+
+#include <stdatomic.h>
+
+#define SYNTH_QUEUE_SIZE 1024 /* Must be a power of two. */
+
+#define SYNTH_COMMAND_PLAY_SONG    1 /* (qual,rid,force,repeat) */
+#define SYNTH_COMMAND_PLAY_SOUND   2 /* (qual,rid),(trim,pan) */
+#define SYNTH_COMMAND_EVENT        3 /* (chid,opcode,a,b) */
+#define SYNTH_COMMAND_SET_PLAYHEAD 4 /* (beats) */
+
+struct synth_command {
+  int64_t time; // Absolute frame, in (synth->framep) terms. Anything in the past means "now".
+  int type;
+  unsigned int serial; // Nonzero for PLAY_SONG and SET_PLAYHEAD that the poster is waiting to see land.
+  int iv[4];
+  float fv[2];
+  double beats;
+};
+
+struct synth_queue {
+  struct synth_command v[SYNTH_QUEUE_SIZE];
+  atomic_uint head; // Next to read. Written only by the consumer.
+  atomic_uint tail; // Next to write. Written only by the producer.
+};
+
+/* Song state as the audio thread last published it, under (synth->clock_seq).
+ * (serial) is the last command that the poster was waiting for, see synth_post_play_song.
+ */
+struct synth_song_state {
+  int present;
+  int qual,songid,repeat;
+  int framep,tempo,durms;
+  unsigned int serial;
+};
+
+/* Producer side. Fails if full, and the command is dropped.
+ */
+int synth_queue_push(struct synth_queue *queue,const struct synth_command *command);
+
+/* Consumer side.
+ * Peek returns the next command without removing it, or null if empty.
+ * Pop only after you've finished with the peeked command.
+ */
+static inline const struct synth_command *synth_queue_peek(struct synth_queue *queue) {
+  unsigned int head=atomic_load_explicit(&queue->head,memory_order_relaxed);
+  unsigned int tail=atomic_load_explicit(&queue->tail,memory_order_acquire);
+  if (head==tail) return 0;
+  return queue->v+(head&(SYNTH_QUEUE_SIZE-1));
+}
+
+static inline void synth_queue_pop(struct synth_queue *queue) {
+  unsigned int head=atomic_load_explicit(&queue->head,memory_order_relaxed);
+  atomic_store_explicit(&queue->head,head+1,memory_order_release);
+}
+
+#endif
@@ -0,0 +1,781 @@
+#include "synth_internal.h"
+
+/* Which implementations are we compiling?
+ * On x86, SSE2 is baseline for x86_64 and AVX2 gets selected at runtime.
+ * On ARM, NEON is decided at compile time (it's always there on aarch64).
+ */
+#if defined(__SSE2__)
+  #define SYNTH_SIMD_SSE2 1
+  #include <emmintrin.h>
+#else
+  #define SYNTH_SIMD_SSE2 0
+#endif
+#if (defined(__x86_64__)||defined(__i386__))&&defined(__GNUC__)
+  #define SYNTH_SIMD_AVX2 1
+  #include <immintrin.h>
+  #define SYNTH_AVX2 __attribute__((target("avx2")))
+#else
+  #define SYNTH_SIMD_AVX2 0
+#endif
+#if defined(__ARM_NEON)
+  #define SYNTH_SIMD_NEON 1
+  #include <arm_neon.h>
+#else
+  #define SYNTH_SIMD_NEON 0
+#endif
+
+/* Scalar reference implementation.
+ * These must produce exactly what synth_voice_update used to do inline.
+ *********************************************************************/
+
+// Largest float below 2**31. FM increments clamp to this before converting to int32.
+#define SYNTH_FM_INC_LIMIT 2147483520.0f
+
+/* Tone kernels all emit thru this, so mono and stereo share one loop.
+ * The branch is the same every time, so it costs nothing next to the table lookups.
+ */
+static inline float *synth_simd_out_scalar(float *v,float sample,const float *pan) {
+  if (!pan) {
+    (*v)+=sample;
+    return v+1;
+  }
+  v[0]+=sample*pan[0];
+  v[1]+=sample*pan[1];
+  return v+2;
+}
+
+static void synth_simd_wave_scalar(float *v,int c,const float *wave,uint32_t *p,uint32_t dp,const float *level,const float *pan) {
+  uint32_t pp=*p;
+  for (;c-->0;level++) {
+    v=synth_simd_out_scalar(v,wave[pp>>SYNTH_WAVE_SHIFT]*(*level),pan);
+    pp+=dp;
+  }
+  *p=pp;
+}
+
+static void synth_simd_rock_scalar(float *v,int c,const float *wave,const float *sine,uint32_t *p,uint32_t dp,const float *mix,const float *level,const float *pan) {
+  uint32_t pp=*p;
+  for (;c-->0;mix++,level++) {
+    float a=wave[pp>>SYNTH_WAVE_SHIFT];
+    float b=sine[pp>>SYNTH_WAVE_SHIFT];
+    float sample=a*(*mix)+b*(1.0f-(*mix));
+    v=synth_simd_out_scalar(v,sample*(*level),pan);
+    pp+=dp;
+  }
+  *p=pp;
+}
+
+static void synth_simd_fm_scalar(float *v,int c,const float *sine,uint32_t *p,uint32_t dp,uint32_t *modp,uint32_t moddp,const float *range,const float *level,const float *pan) {
+  uint32_t pp=*p,mp=*modp;
+  float fdp=(float)dp;
+  for (;c-->0;range++,level++) {
+    v=synth_simd_out_scalar(v,sine[pp>>SYNTH_WAVE_SHIFT]*(*level),pan);
+    float inc=fdp*(sine[mp>>SYNTH_WAVE_SHIFT]*(*range));
+    if (inc>SYNTH_FM_INC_LIMIT) inc=SYNTH_FM_INC_LIMIT;
+    else if (inc<-SYNTH_FM_INC_LIMIT) inc=-SYNTH_FM_INC_LIMIT;
+    mp+=moddp;
+    pp+=dp+(int32_t)inc;
+  }
+  *p=pp;
+  *modp=mp;
+}
+
+static void synth_simd_mlt_clamp_add_scalar(float *v,int c,const float *src,const float *level,float lim,const float *pan) {
+  float nlim=-lim;
+  for (;c-->0;src++,level++) {
+    float sample=(*src)*(*level);
+    if (sample<nlim) sample=nlim;
+    else if (sample>lim) sample=lim;
+    v=synth_simd_out_scalar(v,sample,pan);
+  }
+}
+
+static void synth_simd_pan_add_scalar(float *v,int c,const float *src,float l,float r) {
+  const float pan[2]={l,r};
+  for (;c-->0;src++) v=synth_simd_out_scalar(v,*src,pan);
+}
+
+static inline uint32_t synth_xorshift32(uint32_t x) {
+  x^=x<<13;
+  x^=x>>17;
+  x^=x<<5;
+  return x;
+}
+
+#define SYNTH_NOISE_SCALE (1.0f/2147483648.0f)
+
+/* Every noise kernel starts by emitting what's left of the previous step,
+ * and finishes a partial step the same way, so only whole steps need vectorizing.
+ * Output is the same no matter how the caller slices it.
+ */
+ 
+static inline void synth_noise_head(float **v,int *c,struct synth_noise *noise) {
+  while ((noise->p<SYNTH_NOISE_LANES)&&(*c>0)) {
+    *((*v)++)=(float)(int32_t)noise->s[noise->p++]*SYNTH_NOISE_SCALE;
+    (*c)--;
+  }
+}
+
+static inline void synth_noise_tail(float *v,int c,struct synth_noise *noise) {
+  if (c<1) return;
+  int i=0;
+  for (;i<SYNTH_NOISE_LANES;i++) noise->s[i]=synth_xorshift32(noise->s[i]);
+  for (i=0;i<c;i++) v[i]=(float)(int32_t)noise->s[i]*SYNTH_NOISE_SCALE;
+  noise->p=c;
+}
+
+static void synth_simd_noise_scalar(float *v,int c,struct synth_noise *noise) {
+  synth_noise_head(&v,&c,noise);
+  for (;c>=SYNTH_NOISE_LANES;c-=SYNTH_NOISE_LANES,v+=SYNTH_NOISE_LANES) {
+    int i=0;
+    for (;i<SYNTH_NOISE_LANES;i++) {
+      noise->s[i]=synth_xorshift32(noise->s[i]);
+      v[i]=(float)(int32_t)noise->s[i]*SYNTH_NOISE_SCALE;
+    }
+  }
+  synth_noise_tail(v,c,noise);
+}
+
+/* Quantize with the two halves of (dither) separately, so vector kernels can finish their tails here.
+ */
+static void synth_quantize_split(int16_t *dst,int c,const float *src,float level,const float *dither,const float *dither2) {
+  if (dither) {
+    for (;c-->0;dst++,src++,dither++,dither2++) {
+      float sample=(*src)*level+((*dither)+(*dither2))*0.5f;
+      if (sample<-32768.0f) sample=-32768.0f;
+      else if (sample>32767.0f) sample=32767.0f;
+      *dst=(int16_t)lrintf(sample);
+    }
+  } else {
+    for (;c-->0;dst++,src++) {
+      float sample=(*src)*level;
+      if (sample<-32768.0f) sample=-32768.0f;
+      else if (sample>32767.0f) sample=32767.0f;
+      *dst=(int16_t)sample;
+    }
+  }
+}
+
+static void synth_simd_quantize_scalar(int16_t *dst,int c,const float *src,float level,const float *dither) {
+  synth_quantize_split(dst,c,src,level,dither,dither?(dither+c):0);
+}
+
+static const struct synth_simd synth_simd_scalar={
+  .name="scalar",
+  .wave=synth_simd_wave_scalar,
+  .rock=synth_simd_rock_scalar,
+  .fm=synth_simd_fm_scalar,
+  .mlt_clamp_add=synth_simd_mlt_clamp_add_scalar,
+  .pan_add=synth_simd_pan_add_scalar,
+  .noise=synth_simd_noise_scalar,
+  .quantize=synth_simd_quantize_scalar,
+};
+
+/* Seed noise. Same lanes as sfg would make from the same seed.
+ */
+ 
+void synth_noise_seed(struct synth_noise *noise,uint32_t seed) {
+  sfg_noise_seed_lanes(noise->s,SYNTH_NOISE_LANES,seed);
+  noise->p=SYNTH_NOISE_LANES;
+}
+
+/* SSE2, 4 frames at a time.
+ * There's no gather instruction, so table lookups go thru memory one lane at a time.
+ * The multiplies and adds are where we win.
+ *********************************************************************/
+
+#if SYNTH_SIMD_SSE2
+
+static inline __m128 synth_simd_gather_sse2(const float *table,__m128i p) {
+  uint32_t ix[4];
+  _mm_storeu_si128((__m128i*)ix,_mm_srli_epi32(p,SYNTH_WAVE_SHIFT));
+  return _mm_set_ps(table[ix[3]],table[ix[2]],table[ix[1]],table[ix[0]]);
+}
+
+/* Emit 4 frames, to mono or interleaved stereo. See synth_simd_out_scalar.
+ * (gain) is (l,r,l,r), from synth_simd_gain_sse2.
+ */
+static inline __m128 synth_simd_gain_sse2(const float *pan) {
+  if (!pan) return _mm_setzero_ps();
+  return _mm_set_ps(pan[1],pan[0],pan[1],pan[0]);
+}
+
+static inline float *synth_simd_out_sse2(float *v,__m128 sample,const float *pan,__m128 gain) {
+  if (!pan) {
+    _mm_storeu_ps(v,_mm_add_ps(_mm_loadu_ps(v),sample));
+    return v+4;
+  }
+  _mm_storeu_ps(v,_mm_add_ps(_mm_loadu_ps(v),_mm_mul_ps(_mm_unpacklo_ps(sample,sample),gain)));
+  _mm_storeu_ps(v+4,_mm_add_ps(_mm_loadu_ps(v+4),_mm_mul_ps(_mm_unpackhi_ps(sample,sample),gain)));
+  return v+8;
+}
+
+static void synth_simd_wave_sse2(float *v,int c,const float *wave,uint32_t *p,uint32_t dp,const float *level,const float *pan) {
+  uint32_t pp=*p;
+  __m128i vp=_mm_set_epi32(pp+dp*3,pp+dp*2,pp+dp,pp);
+  __m128i vstep=_mm_set1_epi32(dp*4);
+  __m128 gain=synth_simd_gain_sse2(pan);
+  for (;c>=4;c-=4,level+=4) {
+    __m128 sample=synth_simd_gather_sse2(wave,vp);
+    v=synth_simd_out_sse2(v,_mm_mul_ps(sample,_mm_loadu_ps(level)),pan,gain);
+    vp=_mm_add_epi32(vp,vstep);
+  }
+  *p=(uint32_t)_mm_cvtsi128_si32(vp);
+  if (c>0) synth_simd_wave_scalar(v,c,wave,p,dp,level,pan);
+}
+
+static void synth_simd_rock_sse2(float *v,int c,const float *wave,const float *sine,uint32_t *p,uint32_t dp,const float *mix,const float *level,const float *pan) {
+  uint32_t pp=*p;
+  __m128i vp=_mm_set_epi32(pp+dp*3,pp+dp*2,pp+dp,pp);
+  __m128i vstep=_mm_set1_epi32(dp*4);
+  __m128 one=_mm_set1_ps(1.0f);
+  __m128 gain=synth_simd_gain_sse2(pan);
+  for (;c>=4;c-=4,mix+=4,level+=4) {
+    __m128 a=synth_simd_gather_sse2(wave,vp);
+    __m128 b=synth_simd_gather_sse2(sine,vp);
+    __m128 m=_mm_loadu_ps(mix);
+    __m128 sample=_mm_add_ps(_mm_mul_ps(a,m),_mm_mul_ps(b,_mm_sub_ps(one,m)));
+    v=synth_simd_out_sse2(v,_mm_mul_ps(sample,_mm_loadu_ps(level)),pan,gain);
+    vp=_mm_add_epi32(vp,vstep);
+  }
+  *p=(uint32_t)_mm_cvtsi128_si32(vp);
+  if (c>0) synth_simd_rock_scalar(v,c,wave,sine,p,dp,mix,level,pan);
+}
+
+/* FM carrier phase depends on the previous frame's modulation, so it's a prefix sum.
+ * We compute four increments in parallel, then sum them across the register.
+ */
+static void synth_simd_fm_sse2(float *v,int c,const float *sine,uint32_t *p,uint32_t dp,uint32_t *modp,uint32_t moddp,const float *range,const float *level,const float *pan) {
+  uint32_t pp=*p,mp=*modp;
+  __m128i vmp=_mm_set_epi32(mp+moddp*3,mp+moddp*2,mp+moddp,mp);
+  __m128i vmstep=_mm_set1_epi32(moddp*4);
+  __m128i vdp=_mm_set1_epi32(dp);
+  __m128 vfdp=_mm_set1_ps((float)dp);
+  __m128 hi=_mm_set1_ps(SYNTH_FM_INC_LIMIT),lo=_mm_set1_ps(-SYNTH_FM_INC_LIMIT);
+  __m128 gain=synth_simd_gain_sse2(pan);
+  for (;c>=4;c-=4,range+=4,level+=4) {
+    __m128 mod=_mm_mul_ps(synth_simd_gather_sse2(sine,vmp),_mm_loadu_ps(range));
+    vmp=_mm_add_epi32(vmp,vmstep);
+    __m128 finc=_mm_min_ps(_mm_max_ps(_mm_mul_ps(vfdp,mod),lo),hi);
+    __m128i inc=_mm_add_epi32(vdp,_mm_cvttps_epi32(finc));
+    inc=_mm_add_epi32(inc,_mm_slli_si128(inc,4));
+    inc=_mm_add_epi32(inc,_mm_slli_si128(inc,8));
+    __m128i vp=_mm_add_epi32(_mm_set1_epi32(pp),_mm_slli_si128(inc,4));
+    __m128 sample=synth_simd_gather_sse2(sine,vp);
+    v=synth_simd_out_sse2(v,_mm_mul_ps(sample,_mm_loadu_ps(level)),pan,gain);
+    pp+=(uint32_t)_mm_cvtsi128_si32(_mm_srli_si128(inc,12));
+  }
+  *p=pp;
+  *modp=(uint32_t)_mm_cvtsi128_si32(vmp);
+  if (c>0) synth_simd_fm_scalar(v,c,sine,p,dp,modp,moddp,range,level,pan);
+}
+
+static void synth_simd_mlt_clamp_add_sse2(float *v,int c,const float *src,const float *level,float lim,const float *pan) {
+  __m128 hi=_mm_set1_ps(lim);
+  __m128 lo=_mm_set1_ps(-lim);
+  __m128 gain=synth_simd_gain_sse2(pan);
+  for (;c>=4;c-=4,src+=4,level+=4) {
+    __m128 sample=_mm_mul_ps(_mm_loadu_ps(src),_mm_loadu_ps(level));
+    sample=_mm_min_ps(_mm_max_ps(sample,lo),hi);
+    v=synth_simd_out_sse2(v,sample,pan,gain);
+  }
+  if (c>0) synth_simd_mlt_clamp_add_scalar(v,c,src,level,lim,pan);
+}
+
+static void synth_simd_pan_add_sse2(float *v,int c,const float *src,float l,float r) {
+  const float pan[2]={l,r};
+  __m128 gain=synth_simd_gain_sse2(pan);
+  for (;c>=4;c-=4,src+=4) v=synth_simd_out_sse2(v,_mm_loadu_ps(src),pan,gain);
+  if (c>0) synth_simd_pan_add_scalar(v,c,src,l,r);
+}
+
+static inline __m128i synth_simd_xorshift_sse2(__m128i x) {
+  x=_mm_xor_si128(x,_mm_slli_epi32(x,13));
+  x=_mm_xor_si128(x,_mm_srli_epi32(x,17));
+  x=_mm_xor_si128(x,_mm_slli_epi32(x,5));
+  return x;
+}
+
+static void synth_simd_noise_sse2(float *v,int c,struct synth_noise *noise) {
+  synth_noise_head(&v,&c,noise);
+  if (c>=SYNTH_NOISE_LANES) {
+    __m128i a=_mm_loadu_si128((__m128i*)noise->s);
+    __m128i b=_mm_loadu_si128((__m128i*)(noise->s+4));
+    __m128 scale=_mm_set1_ps(SYNTH_NOISE_SCALE);
+    for (;c>=SYNTH_NOISE_LANES;c-=SYNTH_NOISE_LANES,v+=SYNTH_NOISE_LANES) {
+      a=synth_simd_xorshift_sse2(a);
+      b=synth_simd_xorshift_sse2(b);
+      _mm_storeu_ps(v,_mm_mul_ps(_mm_cvtepi32_ps(a),scale));
+      _mm_storeu_ps(v+4,_mm_mul_ps(_mm_cvtepi32_ps(b),scale));
+    }
+    _mm_storeu_si128((__m128i*)noise->s,a);
+    _mm_storeu_si128((__m128i*)(noise->s+4),b);
+  }
+  synth_noise_tail(v,c,noise);
+}
+
+/* cvtps rounds per MXCSR, nearest by default, same as lrintf. cvttps truncates, same as a C cast.
+ * packs saturates, but it would see 0x80000000 for anything out of int32 range, so clamp as floats first.
+ */
+static void synth_simd_quantize_sse2(int16_t *dst,int c,const float *src,float level,const float *dither) {
+  __m128 vlevel=_mm_set1_ps(level);
+  __m128 lo=_mm_set1_ps(-32768.0f);
+  __m128 hi=_mm_set1_ps(32767.0f);
+  if (dither) {
+    const float *dither2=dither+c;
+    __m128 half=_mm_set1_ps(0.5f);
+    for (;c>=8;c-=8,dst+=8,src+=8,dither+=8,dither2+=8) {
+      __m128 a=_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src),vlevel),_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(dither),_mm_loadu_ps(dither2)),half));
+      __m128 b=_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(src+4),vlevel),_mm_mul_ps(_mm_add_ps(_mm_loadu_ps(dither+4),_mm_loadu_ps(dither2+4)),half));
+      a=_mm_min_ps(_mm_max_ps(a,lo),hi);
+      b=_mm_min_ps(_mm_max_ps(b,lo),hi);
+      _mm_storeu_si128((__m128i*)dst,_mm_packs_epi32(_mm_cvtps_epi32(a),_mm_cvtps_epi32(b)));
+    }
+    if (c>0) synth_quantize_split(dst,c,src,level,dither,dither2);
+  } else {
+    for (;c>=8;c-=8,dst+=8,src+=8) {
+      __m128 a=_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src),vlevel),lo),hi);
+      __m128 b=_mm_min_ps(_mm_max_ps(_mm_mul_ps(_mm_loadu_ps(src+4),vlevel),lo),hi);
+      _mm_storeu_si128((__m128i*)dst,_mm_packs_epi32(_mm_cvttps_epi32(a),_mm_cvttps_epi32(b)));
+    }
+    if (c>0) synth_quantize_split(dst,c,src,level,0,0);
+  }
+}
+
+static const struct synth_simd synth_simd_sse2={
+  .name="sse2",
+  .wave=synth_simd_wave_sse2,
+  .rock=synth_simd_rock_sse2,
+  .fm=synth_simd_fm_sse2,
+  .mlt_clamp_add=synth_simd_mlt_clamp_add_sse2,
+  .pan_add=synth_simd_pan_add_sse2,
+  .noise=synth_simd_noise_sse2,
+  .quantize=synth_simd_quantize_sse2,
+};
+
+#endif
+
+/* AVX2, 8 frames at a time, with real gathers.
+ *********************************************************************/
+
+#if SYNTH_SIMD_AVX2
+
+static SYNTH_AVX2 inline __m256 synth_simd_gather_avx2(const float *table,__m256i p) {
+  return _mm256_i32gather_ps(table,_mm256_srli_epi32(p,SYNTH_WAVE_SHIFT),4);
+}
+
+/* Emit 8 frames, to mono or interleaved stereo. See synth_simd_out_scalar.
+ * (gain) is (l,r,l,r,...), from synth_simd_gain_avx2.
+ */
+static SYNTH_AVX2 inline __m256 synth_simd_gain_avx2(const float *pan) {
+  if (!pan) return _mm256_setzero_ps();
+  return _mm256_setr_ps(pan[0],pan[1],pan[0],pan[1],pan[0],pan[1],pan[0],pan[1]);
+}
+
+static SYNTH_AVX2 inline float *synth_simd_out_avx2(float *v,__m256 sample,const float *pan,__m256 gain) {
+  if (!pan) {
+    _mm256_storeu_ps(v,_mm256_add_ps(_mm256_loadu_ps(v),sample));
+    return v+8;
+  }
+  __m256 lo=_mm256_permutevar8x32_ps(sample,_mm256_setr_epi32(0,0,1,1,2,2,3,3));
+  __m256 hi=_mm256_permutevar8x32_ps(sample,_mm256_setr_epi32(4,4,5,5,6,6,7,7));
+  _mm256_storeu_ps(v,_mm256_add_ps(_mm256_loadu_ps(v),_mm256_mul_ps(lo,gain)));
+  _mm256_storeu_ps(v+8,_mm256_add_ps(_mm256_loadu_ps(v+8),_mm256_mul_ps(hi,gain)));
+  return v+16;
+}
+
+static SYNTH_AVX2 inline __m256i synth_simd_phase_avx2(uint32_t p,uint32_t dp) {
+  return _mm256_add_epi32(
+    _mm256_set1_epi32(p),
+    _mm256_mullo_epi32(_mm256_set1_epi32(dp),_mm256_setr_epi32(0,1,2,3,4,5,6,7))
+  );
+}
+
+static SYNTH_AVX2 void synth_simd_wave_avx2(float *v,int c,const float *wave,uint32_t *p,uint32_t dp,const float *level,const float *pan) {
+  __m256i vp=synth_simd_phase_avx2(*p,dp);
+  __m256i vstep=_mm256_set1_epi32(dp*8);
+  __m256 gain=synth_simd_gain_avx2(pan);
+  for (;c>=8;c-=8,level+=8) {
+    __m256 sample=synth_simd_gather_avx2(wave,vp);
+    v=synth_simd_out_avx2(v,_mm256_mul_ps(sample,_mm256_loadu_ps(level)),pan,gain);
+    vp=_mm256_add_epi32(vp,vstep);
+  }
+  *p=(uint32_t)_mm256_extract_epi32(vp,0);
+  if (c>0) synth_simd_wave_scalar(v,c,wave,p,dp,level,pan);
+}
+
+static SYNTH_AVX2 void synth_simd_rock_avx2(float *v,int c,const float *wave,const float *sine,uint32_t *p,uint32_t dp,const float *mix,const float *level,const float *pan) {
+  __m256i vp=synth_simd_phase_avx2(*p,dp);
+  __m256i vstep=_mm256_set1_epi32(dp*8);
+  __m256 one=_mm256_set1_ps(1.0f);
+  __m256 gain=synth_simd_gain_avx2(pan);
+  for (;c>=8;c-=8,mix+=8,level+=8) {
+    __m256 a=synth_simd_gather_avx2(wave,vp);
+    __m256 b=synth_simd_gather_avx2(sine,vp);
+    __m256 m=_mm256_loadu_ps(mix);
+    __m256 sample=_mm256_add_ps(_mm256_mul_ps(a,m),_mm256_mul_ps(b,_mm256_sub_ps(one,m)));
+    v=synth_simd_out_avx2(v,_mm256_mul_ps(sample,_mm256_loadu_ps(level)),pan,gain);
+    vp=_mm256_add_epi32(vp,vstep);
+  }
+  *p=(uint32_t)_mm256_extract_epi32(vp,0);
+  if (c>0) synth_simd_rock_scalar(v,c,wave,sine,p,dp,mix,level,pan);
+}
+
+/* Increments are computed in parallel, then the prefix sum is done in scalar registers.
+ * Cross-lane shifts in AVX2 are awkward, and eight integer adds cost next to nothing.
+ */
+static SYNTH_AVX2 void synth_simd_fm_avx2(float *v,int c,const float *sine,uint32_t *p,uint32_t dp,uint32_t *modp,uint32_t moddp,const float *range,const float *level,const float *pan) {
+  uint32_t pp=*p;
+  __m256i vmp=synth_simd_phase_avx2(*modp,moddp);
+  __m256i vmstep=_mm256_set1_epi32(moddp*8);
+  __m256i vdp=_mm256_set1_epi32(dp);
+  __m256 vfdp=_mm256_set1_ps((float)dp);
+  __m256 hi=_mm256_set1_ps(SYNTH_FM_INC_LIMIT),lo=_mm256_set1_ps(-SYNTH_FM_INC_LIMIT);
+  __m256 gain=synth_simd_gain_avx2(pan);
+  uint32_t inc[8],phase[8];
+  for (;c>=8;c-=8,range+=8,level+=8) {
+    __m256 mod=_mm256_mul_ps(synth_simd_gather_avx2(sine,vmp),_mm256_loadu_ps(range));
+    vmp=_mm256_add_epi32(vmp,vmstep);
+    __m256 finc=_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(vfdp,mod),lo),hi);
+    _mm256_storeu_si256((__m256i*)inc,_mm256_add_epi32(vdp,_mm256_cvttps_epi32(finc)));
+    int i=0; for (;i<8;i++) {
+      phase[i]=pp;
+      pp+=inc[i];
+    }
+    __m256 sample=synth_simd_gather_avx2(sine,_mm256_loadu_si256((__m256i*)phase));
+    v=synth_simd_out_avx2(v,_mm256_mul_ps(sample,_mm256_loadu_ps(level)),pan,gain);
+  }
+  *p=pp;
+  *modp=(uint32_t)_mm256_extract_epi32(vmp,0);
+  if (c>0) synth_simd_fm_scalar(v,c,sine,p,dp,modp,moddp,range,level,pan);
+}
+
+static SYNTH_AVX2 void synth_simd_mlt_clamp_add_avx2(float *v,int c,const float *src,const float *level,float lim,const float *pan) {
+  __m256 hi=_mm256_set1_ps(lim);
+  __m256 lo=_mm256_set1_ps(-lim);
+  __m256 gain=synth_simd_gain_avx2(pan);
+  for (;c>=8;c-=8,src+=8,level+=8) {
+    __m256 sample=_mm256_mul_ps(_mm256_loadu_ps(src),_mm256_loadu_ps(level));
+    sample=_mm256_min_ps(_mm256_max_ps(sample,lo),hi);
+    v=synth_simd_out_avx2(v,sample,pan,gain);
+  }
+  if (c>0) synth_simd_mlt_clamp_add_scalar(v,c,src,level,lim,pan);
+}
+
+static SYNTH_AVX2 void synth_simd_pan_add_avx2(float *v,int c,const float *src,float l,float r) {
+  const float pan[2]={l,r};
+  __m256 gain=synth_simd_gain_avx2(pan);
+  for (;c>=8;c-=8,src+=8) v=synth_simd_out_avx2(v,_mm256_loadu_ps(src),pan,gain);
+  if (c>0) synth_simd_pan_add_scalar(v,c,src,l,r);
+}
+
+static SYNTH_AVX2 void synth_simd_noise_avx2(float *v,int c,struct synth_noise *noise) {
+  synth_noise_head(&v,&c,noise);
+  if (c>=SYNTH_NOISE_LANES) {
+    __m256i x=_mm256_loadu_si256((__m256i*)noise->s);
+    __m256 scale=_mm256_set1_ps(SYNTH_NOISE_SCALE);
+    for (;c>=SYNTH_NOISE_LANES;c-=SYNTH_NOISE_LANES,v+=SYNTH_NOISE_LANES) {
+      x=_mm256_xor_si256(x,_mm256_slli_epi32(x,13));
+      x=_mm256_xor_si256(x,_mm256_srli_epi32(x,17));
+      x=_mm256_xor_si256(x,_mm256_slli_epi32(x,5));
+      _mm256_storeu_ps(v,_mm256_mul_ps(_mm256_cvtepi32_ps(x),scale));
+    }
+    _mm256_storeu_si256((__m256i*)noise->s,x);
+  }
+  synth_noise_tail(v,c,noise);
+}
+
+/* packs works within 128-bit halves, so 16 at a time and then put the quarters back in order.
+ */
+static SYNTH_AVX2 inline void synth_simd_pack_avx2(int16_t *dst,__m256i a,__m256i b) {
+  _mm256_storeu_si256((__m256i*)dst,_mm256_permute4x64_epi64(_mm256_packs_epi32(a,b),0xd8));
+}
+
+static SYNTH_AVX2 void synth_simd_quantize_avx2(int16_t *dst,int c,const float *src,float level,const float *dither) {
+  __m256 vlevel=_mm256_set1_ps(level);
+  __m256 lo=_mm256_set1_ps(-32768.0f);
+  __m256 hi=_mm256_set1_ps(32767.0f);
+  if (dither) {
+    const float *dither2=dither+c;
+    __m256 half=_mm256_set1_ps(0.5f);
+    for (;c>=16;c-=16,dst+=16,src+=16,dither+=16,dither2+=16) {
+      __m256 a=_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src),vlevel),_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(dither),_mm256_loadu_ps(dither2)),half));
+      __m256 b=_mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(src+8),vlevel),_mm256_mul_ps(_mm256_add_ps(_mm256_loadu_ps(dither+8),_mm256_loadu_ps(dither2+8)),half));
+      a=_mm256_min_ps(_mm256_max_ps(a,lo),hi);
+      b=_mm256_min_ps(_mm256_max_ps(b,lo),hi);
+      synth_simd_pack_avx2(dst,_mm256_cvtps_epi32(a),_mm256_cvtps_epi32(b));
+    }
+    if (c>0) synth_quantize_split(dst,c,src,level,dither,dither2);
+  } else {
+    for (;c>=16;c-=16,dst+=16,src+=16) {
+      __m256 a=_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src),vlevel),lo),hi);
+      __m256 b=_mm256_min_ps(_mm256_max_ps(_mm256_mul_ps(_mm256_loadu_ps(src+8),vlevel),lo),hi);
+      synth_simd_pack_avx2(dst,_mm256_cvttps_epi32(a),_mm256_cvttps_epi32(b));
+    }
+    if (c>0) synth_quantize_split(dst,c,src,level,0,0);
+  }
+}
+
+static const struct synth_simd synth_simd_avx2={
+  .name="avx2",
+  .wave=synth_simd_wave_avx2,
+  .rock=synth_simd_rock_avx2,
+  .fm=synth_simd_fm_avx2,
+  .mlt_clamp_add=synth_simd_mlt_clamp_add_avx2,
+  .pan_add=synth_simd_pan_add_avx2,
+  .noise=synth_simd_noise_avx2,
+  .quantize=synth_simd_quantize_avx2,
+};
+
+#endif
+
+/* NEON, 4 frames at a time.
+ * Same story as SSE2: Lookups are one lane at a time.
+ *********************************************************************/
+
+#if SYNTH_SIMD_NEON
+
+static inline float32x4_t synth_simd_gather_neon(const float *table,uint32x4_t p) {
+  uint32x4_t ix=vshrq_n_u32(p,SYNTH_WAVE_SHIFT);
+  float32x4_t dst=vdupq_n_f32(0.0f);
+  dst=vld1q_lane_f32(table+vgetq_lane_u32(ix,0),dst,0);
+  dst=vld1q_lane_f32(table+vgetq_lane_u32(ix,1),dst,1);
+  dst=vld1q_lane_f32(table+vgetq_lane_u32(ix,2),dst,2);
+  dst=vld1q_lane_f32(table+vgetq_lane_u32(ix,3),dst,3);
+  return dst;
+}
+
+/* Emit 4 frames, to mono or interleaved stereo. See synth_simd_out_scalar.
+ * (gain) is (l,r,l,r), from synth_simd_gain_neon.
+ */
+static inline float32x4_t synth_simd_gain_neon(const float *pan) {
+  if (!pan) return vdupq_n_f32(0.0f);
+  float gainv[4]={pan[0],pan[1],pan[0],pan[1]};
+  return vld1q_f32(gainv);
+}
+
+static inline float *synth_simd_out_neon(float *v,float32x4_t sample,const float *pan,float32x4_t gain) {
+  if (!pan) {
+    vst1q_f32(v,vaddq_f32(vld1q_f32(v),sample));
+    return v+4;
+  }
+  float32x4x2_t d=vzipq_f32(sample,sample);
+  vst1q_f32(v,vaddq_f32(vld1q_f32(v),vmulq_f32(d.val[0],gain)));
+  vst1q_f32(v+4,vaddq_f32(vld1q_f32(v+4),vmulq_f32(d.val[1],gain)));
+  return v+8;
+}
+
+static inline uint32x4_t synth_simd_phase_neon(uint32_t p,uint32_t dp) {
+  uint32_t tmp[4]={p,p+dp,p+dp*2,p+dp*3};
+  return vld1q_u32(tmp);
+}
+
+static void synth_simd_wave_neon(float *v,int c,const float *wave,uint32_t *p,uint32_t dp,const float *level,const float *pan) {
+  uint32x4_t vp=synth_simd_phase_neon(*p,dp);
+  uint32x4_t vstep=vdupq_n_u32(dp*4);
+  float32x4_t gain=synth_simd_gain_neon(pan);
+  for (;c>=4;c-=4,level+=4) {
+    float32x4_t sample=synth_simd_gather_neon(wave,vp);
+    v=synth_simd_out_neon(v,vmulq_f32(sample,vld1q_f32(level)),pan,gain);
+    vp=vaddq_u32(vp,vstep);
+  }
+  *p=vgetq_lane_u32(vp,0);
+  if (c>0) synth_simd_wave_scalar(v,c,wave,p,dp,level,pan);
+}
+
+static void synth_simd_rock_neon(float *v,int c,const float *wave,const float *sine,uint32_t *p,uint32_t dp,const float *mix,const float *level,const float *pan) {
+  uint32x4_t vp=synth_simd_phase_neon(*p,dp);
+  uint32x4_t vstep=vdupq_n_u32(dp*4);
+  float32x4_t one=vdupq_n_f32(1.0f);
+  float32x4_t gain=synth_simd_gain_neon(pan);
+  for (;c>=4;c-=4,mix+=4,level+=4) {
+    float32x4_t a=synth_simd_gather_neon(wave,vp);
+    float32x4_t b=synth_simd_gather_neon(sine,vp);
+    float32x4_t m=vld1q_f32(mix);
+    float32x4_t sample=vaddq_f32(vmulq_f32(a,m),vmulq_f32(b,vsubq_f32(one,m)));
+    v=synth_simd_out_neon(v,vmulq_f32(sample,vld1q_f32(level)),pan,gain);
+    vp=vaddq_u32(vp,vstep);
+  }
+  *p=vgetq_lane_u32(vp,0);
+  if (c>0) synth_simd_rock_scalar(v,c,wave,sine,p,dp,mix,level,pan);
+}
+
+static void synth_simd_fm_neon(float *v,int c,const float *sine,uint32_t *p,uint32_t dp,uint32_t *modp,uint32_t moddp,const float *range,const float *level,const float *pan) {
+  uint32_t pp=*p;
+  uint32x4_t vmp=synth_simd_phase_neon(*modp,moddp);
+  uint32x4_t vmstep=vdupq_n_u32(moddp*4);
+  int32x4_t vdp=vdupq_n_s32(dp);
+  float32x4_t vfdp=vdupq_n_f32((float)dp);
+  float32x4_t hi=vdupq_n_f32(SYNTH_FM_INC_LIMIT),lo=vdupq_n_f32(-SYNTH_FM_INC_LIMIT);
+  float32x4_t gain=synth_simd_gain_neon(pan);
+  uint32_t inc[4],phase[4];
+  for (;c>=4;c-=4,range+=4,level+=4) {
+    float32x4_t mod=vmulq_f32(synth_simd_gather_neon(sine,vmp),vld1q_f32(range));
+    vmp=vaddq_u32(vmp,vmstep);
+    float32x4_t finc=vminq_f32(vmaxq_f32(vmulq_f32(vfdp,mod),lo),hi);
+    vst1q_u32(inc,vreinterpretq_u32_s32(vaddq_s32(vdp,vcvtq_s32_f32(finc))));
+    phase[0]=pp; pp+=inc[0];
+    phase[1]=pp; pp+=inc[1];
+    phase[2]=pp; pp+=inc[2];
+    phase[3]=pp; pp+=inc[3];
+    float32x4_t sample=synth_simd_gather_neon(sine,vld1q_u32(phase));
+    v=synth_simd_out_neon(v,vmulq_f32(sample,vld1q_f32(level)),pan,gain);
+  }
+  *p=pp;
+  *modp=vgetq_lane_u32(vmp,0);
+  if (c>0) synth_simd_fm_scalar(v,c,sine,p,dp,modp,moddp,range,level,pan);
+}
+
+static void synth_simd_mlt_clamp_add_neon(float *v,int c,const float *src,const float *level,float lim,const float *pan) {
+  float32x4_t hi=vdupq_n_f32(lim);
+  float32x4_t lo=vdupq_n_f32(-lim);
+  float32x4_t gain=synth_simd_gain_neon(pan);
+  for (;c>=4;c-=4,src+=4,level+=4) {
+    float32x4_t sample=vmulq_f32(vld1q_f32(src),vld1q_f32(level));
+    sample=vminq_f32(vmaxq_f32(sample,lo),hi);
+    v=synth_simd_out_neon(v,sample,pan,gain);
+  }
+  if (c>0) synth_simd_mlt_clamp_add_scalar(v,c,src,level,lim,pan);
+}
+
+static void synth_simd_pan_add_neon(float *v,int c,const float *src,float l,float r) {
+  const float pan[2]={l,r};
+  float32x4_t gain=synth_simd_gain_neon(pan);
+  for (;c>=4;c-=4,src+=4) v=synth_simd_out_neon(v,vld1q_f32(src),pan,gain);
+  if (c>0) synth_simd_pan_add_scalar(v,c,src,l,r);
+}
+
+static inline uint32x4_t synth_simd_xorshift_neon(uint32x4_t x) {
+  x=veorq_u32(x,vshlq_n_u32(x,13));
+  x=veorq_u32(x,vshrq_n_u32(x,17));
+  x=veorq_u32(x,vshlq_n_u32(x,5));
+  return x;
+}
+
+static void synth_simd_noise_neon(float *v,int c,struct synth_noise *noise) {
+  synth_noise_head(&v,&c,noise);
+  if (c>=SYNTH_NOISE_LANES) {
+    uint32x4_t a=vld1q_u32(noise->s);
+    uint32x4_t b=vld1q_u32(noise->s+4);
+    float32x4_t scale=vdupq_n_f32(SYNTH_NOISE_SCALE);
+    for (;c>=SYNTH_NOISE_LANES;c-=SYNTH_NOISE_LANES,v+=SYNTH_NOISE_LANES) {
+      a=synth_simd_xorshift_neon(a);
+      b=synth_simd_xorshift_neon(b);
+      vst1q_f32(v,vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(a)),scale));
+      vst1q_f32(v+4,vmulq_f32(vcvtq_f32_s32(vreinterpretq_s32_u32(b)),scale));
+    }
+    vst1q_u32(noise->s,a);
+    vst1q_u32(noise->s+4,b);
+  }
+  synth_noise_tail(v,c,noise);
+}
+
+/* vcvtq truncates. armv7 has no round-to-nearest conversion, so the dithered path adds a half away from zero first.
+ * That only differs from lrintf at exact ties, which dither makes vanishingly rare.
+ * vqmovn saturates, but clamp as floats anyway to keep the int32 conversion in range.
+ */
+static void synth_simd_quantize_neon(int16_t *dst,int c,const float *src,float level,const float *dither) {
+  float32x4_t vlevel=vdupq_n_f32(level);
+  float32x4_t lo=vdupq_n_f32(-32768.0f);
+  float32x4_t hi=vdupq_n_f32(32767.0f);
+  if (dither) {
+    const float *dither2=dither+c;
+    float32x4_t half=vdupq_n_f32(0.5f);
+    uint32x4_t sign=vdupq_n_u32(0x80000000);
+    for (;c>=8;c-=8,dst+=8,src+=8,dither+=8,dither2+=8) {
+      float32x4_t a=vaddq_f32(vmulq_f32(vld1q_f32(src),vlevel),vmulq_f32(vaddq_f32(vld1q_f32(dither),vld1q_f32(dither2)),half));
+      float32x4_t b=vaddq_f32(vmulq_f32(vld1q_f32(src+4),vlevel),vmulq_f32(vaddq_f32(vld1q_f32(dither+4),vld1q_f32(dither2+4)),half));
+      a=vminq_f32(vmaxq_f32(a,lo),hi);
+      b=vminq_f32(vmaxq_f32(b,lo),hi);
+      a=vaddq_f32(a,vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(half),vandq_u32(vreinterpretq_u32_f32(a),sign))));
+      b=vaddq_f32(b,vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(half),vandq_u32(vreinterpretq_u32_f32(b),sign))));
+      vst1q_s16(dst,vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)),vqmovn_s32(vcvtq_s32_f32(b))));
+    }
+    if (c>0) synth_quantize_split(dst,c,src,level,dither,dither2);
+  } else {
+    for (;c>=8;c-=8,dst+=8,src+=8) {
+      float32x4_t a=vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(src),vlevel),lo),hi);
+      float32x4_t b=vminq_f32(vmaxq_f32(vmulq_f32(vld1q_f32(src+4),vlevel),lo),hi);
+      vst1q_s16(dst,vcombine_s16(vqmovn_s32(vcvtq_s32_f32(a)),vqmovn_s32(vcvtq_s32_f32(b))));
+    }
+    if (c>0) synth_quantize_split(dst,c,src,level,0,0);
+  }
+}
+
+static const struct synth_simd synth_simd_neon={
+  .name="neon",
+  .wave=synth_simd_wave_neon,
+  .rock=synth_simd_rock_neon,
+  .fm=synth_simd_fm_neon,
+  .mlt_clamp_add=synth_simd_mlt_clamp_add_neon,
+  .pan_add=synth_simd_pan_add_neon,
+  .noise=synth_simd_noise_neon,
+  .quantize=synth_simd_quantize_neon,
+};
+
+#endif
+
+/* Runtime selection.
+ **********************************************************************/
+
+const struct synth_simd *synth_simd_best() {
+  #if SYNTH_SIMD_AVX2
+    if (__builtin_cpu_supports("avx2")) return &synth_simd_avx2;
+  #endif
+  #if SYNTH_SIMD_SSE2
+    return &synth_simd_sse2;
+  #endif
+  #if SYNTH_SIMD_NEON
+    return &synth_simd_neon;
+  #endif
+  return &synth_simd_scalar;
+}
+
+const struct synth_simd *synth_simd_by_name(const char *name,int namec) {
+  if (!name) return 0;
+  if (namec<0) { namec=0; while (name[namec]) namec++; }
+  if ((namec==6)&&!memcmp(name,"scalar",6)) return &synth_simd_scalar;
+  #if SYNTH_SIMD_SSE2
+    if ((namec==4)&&!memcmp(name,"sse2",4)) return &synth_simd_sse2;
+  #endif
+  #if SYNTH_SIMD_AVX2
+    if ((namec==4)&&!memcmp(name,"avx2",4)) {
+      if (!__builtin_cpu_supports("avx2")) return 0;
+      return &synth_simd_avx2;
+    }
+  #endif
+  #if SYNTH_SIMD_NEON
+    if ((namec==4)&&!memcmp(name,"neon",4)) return &synth_simd_neon;
+  #endif
+  return 0;
+}
+
+/* Denormals.
+ * x86: MXCSR FTZ (bit 15) and DAZ (bit 6). DAZ is missing on some very early SSE chips, but those can't run us anyway.
+ * aarch64: FPCR FZ (bit 24), which covers both inputs and outputs.
+ * Anywhere else, we do nothing and hope the CPU is fast with denormals.
+ */
+
+unsigned int synth_denormals_disable() {
+  #if SYNTH_SIMD_SSE2
+    unsigned int state=_mm_getcsr();
+    _mm_setcsr(state|0x8040);
+    return state;
+  #elif defined(__aarch64__)&&defined(__GNUC__)
+    uint64_t state;
+    __asm__ __volatile__("mrs %0, fpcr":"=r"(state));
+    __asm__ __volatile__("msr fpcr, %0"::"r"(state|(1<<24)));
+    return (unsigned int)state;
+  #else
+    return 0;
+  #endif
+}
+
+void synth_denormals_restore(unsigned int state) {
+  #if SYNTH_SIMD_SSE2
+    _mm_setcsr(state);
+  #elif defined(__aarch64__)&&defined(__GNUC__)
+    uint64_t v=state;
+    __asm__ __volatile__("msr fpcr, %0"::"r"(v));
+  #endif
+}
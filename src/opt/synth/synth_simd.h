@@ -0,0 +1,85 @@
+/* synth_simd.h
+ * Block kernels for the hot inner loops of synth_voice.
+ * Every kernel has a scalar reference implementation, and we may have vectorized ones too.
+ * A table is selected at runtime according to what the CPU supports.
+ * All kernels take a frame count (c) in 0..SYNTH_BUFFER_LIMIT, and must tolerate any value in that range.
+ */
+
+#ifndef SYNTH_SIMD_H
+#define SYNTH_SIMD_H
+
+/* SYNTH_NOISE_LANES independent xorshift32 generators, interleaved.
+ */
+#define SYNTH_NOISE_LANES 8
+struct synth_noise {
+  uint32_t s[SYNTH_NOISE_LANES];
+  int p; // How many lanes of the latest step have been emitted.
+};
+
+struct synth_simd {
+  const char *name;
+  
+  /* The four tone kernels (wave,rock,fm,mlt_clamp_add) end with (pan):
+   * Null to add to mono (v). Otherwise (v) is interleaved stereo, twice as long,
+   * and each sample is added to both channels, scaled by pan[0] and pan[1].
+   */
+
+  /* WAVE: v[i]+=wave[p>>SHIFT]*level[i], advancing (p) by (dp) each frame.
+   */
+  void (*wave)(float *v,int c,const float *wave,uint32_t *p,uint32_t dp,const float *level,const float *pan);
+
+  /* ROCK: Like WAVE, but each sample is a mix of (wave) and (sine), per (mix): 1=wave, 0=sine.
+   */
+  void (*rock)(float *v,int c,const float *wave,const float *sine,uint32_t *p,uint32_t dp,const float *mix,const float *level,const float *pan);
+
+  /* FMREL and FMABS: Sine carrier modulated by sine, with modulation range (range) per frame.
+   * The carrier advances by dp+dp*mod, where the second term is clamped to int32 before truncating.
+   * Deep modulation on a high note can get there, eg FX range runs up to 16.
+   */
+  void (*fm)(float *v,int c,const float *sine,uint32_t *p,uint32_t dp,uint32_t *modp,uint32_t moddp,const float *range,const float *level,const float *pan);
+
+  /* SUB: v[i]+=clamp(src[i]*level[i],-lim,lim).
+   */
+  void (*mlt_clamp_add)(float *v,int c,const float *src,const float *level,float lim,const float *pan);
+
+  /* Mix a mono signal onto interleaved stereo: v[i*2]+=src[i]*l, v[i*2+1]+=src[i]*r.
+   * (c) is in frames; (v) is twice that long.
+   */
+  void (*pan_add)(float *v,int c,const float *src,float l,float r);
+
+  /* NOISE: v[i]=white noise in -1..1 from (noise). Writes (v), doesn't add.
+   * Sample (i) of each step comes from lane (i), and a partial step is finished on the next call.
+   * So output depends only on the seed, not on how the calls are sliced.
+   */
+  void (*noise)(float *v,int c,struct synth_noise *noise);
+  
+  /* Quantize: dst[i]=src[i]*level, clamped to int16.
+   * (dither) null to truncate toward zero, which is what we've always done.
+   * Otherwise it's 2*c samples of white noise in -1..1, as from (noise). Sample (i) gets (dither[i]+dither[c+i])/2 added,
+   * which is triangular in -1..1 LSB, then rounds to nearest.
+   */
+  void (*quantize)(int16_t *dst,int c,const float *src,float level,const float *dither);
+};
+
+/* Initialize a noise state from any seed, deterministically.
+ */
+void synth_noise_seed(struct synth_noise *noise,uint32_t seed);
+
+/* Flush denormal floats to zero on the calling thread, and treat denormal inputs as zero.
+ * Filter and delay tails decay into denormals, which are very slow on most CPUs, and inaudible anyway.
+ * We do this around every update and in every thread we own.
+ * Returns the previous state, for synth_denormals_restore.
+ */
+unsigned int synth_denormals_disable();
+void synth_denormals_restore(unsigned int state);
+
+/* The best table this CPU supports. Never null; worst case we return the scalar one.
+ */
+const struct synth_simd *synth_simd_best();
+
+/* "scalar", "sse2", "avx2", "neon".
+ * Null if unknown, or not supported by this CPU.
+ */
+const struct synth_simd *synth_simd_by_name(const char *name,int namec);
+
+#endif
@@ -5,7 +5,7 @@
 
 void synth_song_del(struct synth_song *song) {
   if (!song) return;
-  if (song->keepalive) free(song->keepalive);
+  if (song->eventv) free(song->eventv);
   free(song);
 }
 
@@ -28,13 +28,116 @@ static int synth_song_validate(int *tempo,int *startp,int *loopp,const uint8_t *
   return 0;
 }
 
+/* Add event during decode.
+ */
+ 
+static struct synth_song_event *synth_song_add_event(struct synth_song *song) {
+  if (song->eventc>=song->eventa) {
+    int na=song->eventa+256;
+    if (na>INT_MAX/sizeof(struct synth_song_event)) return 0;
+    void *nv=realloc(song->eventv,sizeof(struct synth_song_event)*na);
+    if (!nv) return 0;
+    song->eventv=nv;
+    song->eventa=na;
+  }
+  return song->eventv+song->eventc++;
+}
+
+/* Decode events.
+ * Each delay rounds to frames independently, the same way we used to do it live.
+ * If we find something invalid, the song ends there, and doesn't repeat.
+ */
+ 
+static int synth_song_decode(struct synth_song *song,const uint8_t *src,int srcc,int startp,int loopp) {
+  int srcp=startp,frame=0,ms=0;
+  song->loopeventp=-1;
+  while (srcp<srcc) {
+    if ((song->loopeventp<0)&&(srcp>=loopp)) {
+      song->loopeventp=song->eventc;
+      song->loopframe=frame;
+    }
+    uint8_t lead=src[srcp++];
+    if (!lead) break;
+    
+    // Delay.
+    if (!(lead&0x80)) {
+      int delay=lroundf(lead*song->frames_per_ms);
+      if (delay<1) delay=1;
+      if (frame>INT_MAX-delay) return -1;
+      frame+=delay;
+      ms+=lead;
+      continue;
+    }
+    
+    // Note.
+    if ((lead&0xf0)==0x80) {
+      if (srcp>srcc-2) { song->repeat=0; break; }
+      uint8_t a=src[srcp++];
+      uint8_t b=src[srcp++];
+      struct synth_song_event *event=synth_song_add_event(song);
+      if (!event) return -1;
+      event->frame=frame;
+      event->chid=a>>5;
+      event->opcode=MIDI_OPCODE_NOTE_ONCE;
+      event->a=((a&0x1f)<<2)|(b>>6);
+      event->b=(lead&0x0f)<<3;
+      event->b|=event->b>>4;
+      event->dur=lroundf(((b&0x3f)<<5)*song->frames_per_ms);
+      if (event->dur<0) event->dur=0;
+      continue;
+    }
+    
+    // Fire-and-forget.
+    if ((lead&0xf0)==0x90) {
+      if (srcp>srcc-1) { song->repeat=0; break; }
+      uint8_t a=src[srcp++];
+      struct synth_song_event *event=synth_song_add_event(song);
+      if (!event) return -1;
+      event->frame=frame;
+      event->chid=((lead&0x03)<<1)|(a>>7);
+      event->opcode=MIDI_OPCODE_NOTE_ONCE;
+      event->a=(a&0x7f);
+      event->b=(lead&0x0c)<<2;
+      event->b|=event->b>>2;
+      event->b|=event->b>>4;
+      event->dur=0;
+      continue;
+    }
+    
+    // Wheel.
+    if ((lead&0xf8)==0xa0) {
+      if (srcp>srcc-1) { song->repeat=0; break; }
+      uint8_t v=src[srcp++];
+      struct synth_song_event *event=synth_song_add_event(song);
+      if (!event) return -1;
+      event->frame=frame;
+      event->chid=lead&0x07;
+      event->opcode=MIDI_OPCODE_WHEEL;
+      event->a=v<<6;
+      event->b=v>>1;
+      event->dur=0;
+      continue;
+    }
+    
+    // Everything else is reserved. (10101xxx, 1011xxxx, 11xxxxxx)
+    song->repeat=0;
+    break;
+  }
+  if (song->loopeventp<0) {
+    song->loopeventp=song->eventc;
+    song->loopframe=frame;
+  }
+  song->framec=frame;
+  song->durms=ms;
+  return 0;
+}
+
 /* New.
  */
 
 struct synth_song *synth_song_new(
   struct synth *synth,
   const void *src,int srcc,
-  int safe_to_borrow,
   int repeat,
   int qual,int songid
 ) {
@@ -44,23 +147,14 @@ struct synth_song *synth_song_new(
   if (!song) return 0;
   song->frames_per_ms=(float)synth->rate/1000.0f;
   song->tempo=tempo;
-  song->startp=startp;
-  song->loopp=loopp;
   song->repeat=repeat;
   song->qual=qual;
   song->songid=songid;
-  if (safe_to_borrow) {
-    song->src=src;
-  } else {
-    if (!(song->keepalive=malloc(srcc))) {
-      synth_song_del(song);
-      return 0;
-    }
-    memcpy(song->keepalive,src,srcc);
-    song->src=song->keepalive;
+  memcpy(song->hdr,(const uint8_t*)src+10,sizeof(song->hdr));
+  if (synth_song_decode(song,src,srcc,startp,loopp)<0) {
+    synth_song_del(song);
+    return 0;
   }
-  song->srcc=srcc;
-  song->srcp=song->startp;
   return song;
 }
 
@@ -68,7 +162,7 @@ struct synth_song *synth_song_new(
  */
 
 int synth_song_init_channels(struct synth *synth,struct synth_song *song) {
-  const uint8_t *src=song->src+10;
+  const uint8_t *src=song->hdr;
   struct synth_channel **chanp=synth->channelv;
   int *pidv=synth->pidv;
   int chid=0;
@@ -88,82 +182,27 @@ int synth_song_init_channels(struct synth *synth,struct synth_song *song) {
 /* Update.
  */
 
-int synth_song_update(struct synth *synth,struct synth_song *song,int skip) {
+int synth_song_update(struct synth *synth,struct synth_song *song) {
   for (;;) {
   
-    // Finished?
-    if (song->delay>0) return song->delay;
-    if ((song->srcp>=song->srcc)||!song->src[song->srcp]) {
-      if (!song->repeat) return 0;
-      // Looping. Force a tiny delay, just in case the song is invalid and has no delays of its own.
-      song->srcp=song->loopp;
-      song->delay=1;
-      song->playhead_ms=1;
-      song->playhead_ms_next=song->playhead_ms;
-      return 1;
-    }
-    
-    uint8_t lead=song->src[song->srcp++];
-    // 0x00 is EOF, that's handled above.
-  
-    // Delay.
-    if (!(lead&0x80)) {
-      if ((song->delay=lroundf(lead*song->frames_per_ms))<1) song->delay=1;
-      song->playhead_ms_next=song->playhead_ms+lead;
-      return song->delay;
-    }
-  
-    // Note.
-    if ((lead&0xf0)==0x80) {
-      if (song->srcp>song->srcc-2) return -1;
-      if (skip) {
-        song->srcp+=2;
-      } else {
-        uint8_t a=song->src[song->srcp++];
-        uint8_t b=song->src[song->srcp++];
-        uint8_t chid=a>>5;
-        uint8_t velocity=(lead&0x0f)<<3;
-        velocity|=velocity>>4;
-        uint8_t noteid=((a&0x1f)<<2)|(b>>6);
-        int dur=lroundf(((b&0x3f)<<5)*song->frames_per_ms);
-        if (dur<0) dur=0;
-        synth_event(synth,chid,MIDI_OPCODE_NOTE_ONCE,noteid,velocity,dur);
-      }
-      continue;
-    }
-  
-    // Fire-and-forget.
-    if ((lead&0xf0)==0x90) {
-      if (song->srcp>song->srcc-1) return -1;
-      if (skip) {
-        song->srcp+=1;
-      } else {
-        uint8_t a=song->src[song->srcp++];
-        uint8_t chid=((lead&0x03)<<1)|(a>>7);
-        uint8_t noteid=(a&0x7f);
-        uint8_t velocity=(lead&0x0c)<<2;
-        velocity|=velocity>>2;
-        velocity|=velocity>>4;
-        synth_event(synth,chid,MIDI_OPCODE_NOTE_ONCE,noteid,velocity,0);
-      }
+    // Next event, if it's due.
+    if (song->eventp<song->eventc) {
+      const struct synth_song_event *event=song->eventv+song->eventp;
+      if (event->frame>song->framep) return event->frame-song->framep;
+      synth_event(synth,event->chid,event->opcode,event->a,event->b,event->dur);
+      song->eventp++;
       continue;
     }
-  
-    // Wheel.
-    if ((lead&0xf8)==0xa0) {
-      if (song->srcp>song->srcc-1) return -1;
-      if (skip) {
-        song->srcp+=1;
-      } else {
-        uint8_t v=song->src[song->srcp++];
-        uint8_t chid=lead&0x07;
-        synth_event(synth,chid,MIDI_OPCODE_WHEEL,v<<6,v>>1,0);
-      }
-      continue;
-    }
-  
-    // Everything else is reserved. (10101xxx, 1011xxxx, 11xxxxxx)
-    return -1;
+    
+    // Events exhausted, but there might be a trailing delay.
+    if (song->framep<song->framec) return song->framec-song->framep;
+    
+    // Finished or looping.
+    // Spend one frame on the loop, in case the song is invalid and has no delays of its own.
+    if (!song->repeat) return 0;
+    song->eventp=song->loopeventp;
+    song->framep=song->loopframe-1;
+    return 1;
   }
 }
 
@@ -172,62 +211,40 @@ int synth_song_update(struct synth *synth,struct synth_song *song,int skip) {
 
 void synth_song_advance(struct synth_song *song,int framec) {
   if (framec<1) return;
-  song->playhead_ms+=framec/song->frames_per_ms;
-  if ((song->delay-=framec)<=0) {
-    song->delay=0;
-    if (song->playhead_ms_next) {
-      song->playhead_ms=song->playhead_ms_next;
-      song->playhead_ms_next=0;
-    }
-  }
+  song->framep+=framec;
 }
 
 /* Set playhead.
  */
  
 void synth_song_set_playhead(struct synth *synth,struct synth_song *song,double beats) {
-  int dstframe=beats*song->tempo*song->frames_per_ms;
-  song->srcp=song->startp;
-  song->delay=1;
-  song->playhead_ms=1;
-  song->playhead_ms_next=song->playhead_ms;
-  while (dstframe>0) {
-    int err=synth_song_update(synth,song,1);
-    if (err<=0) break;
-    if (err>dstframe) err=dstframe;
-    synth_song_advance(song,err);
-    dstframe-=err;
+  double dstframe=beats*song->tempo*song->frames_per_ms;
+  if (dstframe<=0.0) {
+    song->framep=0;
+    song->eventp=0;
+    return;
   }
-}
-
-/* Calculate duration.
- */
- 
-double synth_song_get_duration(const struct synth_song *song) {
-  if (!song) return 0.0;
-  if (song->tempo<1) return 0.0;
-  double duration=0.0; // initially in milliseconds
-  int srcp=song->startp;
-  while (srcp<song->srcc) {
-    uint8_t lead=song->src[srcp++];
-    if (!lead) break;
-    if (!(lead&0x80)) {
-      duration+=lead;
-      continue;
-    }
-    if ((lead&0xf0)==0x80) {
-      srcp+=2;
-      continue;
-    }
-    if ((lead&0xf0)==0x90) {
-      srcp+=1;
-      continue;
-    }
-    if ((lead&0xf8)==0xa0) {
-      srcp+=1;
-      continue;
+  int lo=0,hi=song->eventc;
+  if (dstframe>=song->framec) {
+    int looplen=song->framec-song->loopframe;
+    if (song->repeat&&(looplen>0)) {
+      // Each pass through the loop costs one extra frame, see synth_song_update().
+      // That frame sits at (loopframe-1), before any loop events.
+      dstframe=song->loopframe-1+fmod(dstframe-song->framec,looplen+1);
+      lo=song->loopeventp;
+    } else {
+      song->framep=song->framec;
+      song->eventp=song->eventc;
+      return;
     }
-    break;
   }
-  return duration/song->tempo;
+  song->framep=(int)dstframe;
+  
+  // First event at or after (framep).
+  while (lo<hi) {
+    int ck=(lo+hi)>>1;
+    if (song->eventv[ck].frame<song->framep) lo=ck+1;
+    else hi=ck;
+  }
+  song->eventp=lo;
 }
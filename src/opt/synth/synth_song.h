@@ -1,22 +1,31 @@
 /* synth_song.h
+ * We decode the whole song at construction, into a list of events with absolute times.
+ * After that, the serial data is no longer needed.
  */
- 
+
 #ifndef SYNTH_SONG_H
 #define SYNTH_SONG_H
 
+struct synth_song_event {
+  int frame; // Absolute, from the start. Never decreases.
+  int dur; // frames, for NOTE_ONCE
+  uint8_t chid,opcode,a,b; // Ready for synth_event().
+};
+
 struct synth_song {
-  const uint8_t *src;
-  int srcc;
-  void *keepalive;
+  uint8_t hdr[4*SYNTH_SONG_CHANNEL_COUNT]; // Channel headers straight off the serial: (pid,volume,pan,reserved).
+  struct synth_song_event *eventv;
+  int eventc,eventa;
+  int eventp; // Next event to deliver.
+  int framep; // Current time in frames. Briefly negative when looping to the start.
+  int framec; // Total length in frames, including trailing delay.
+  int durms; // Total length in milliseconds, exact from the serial.
+  int loopeventp; // Where to go when repeating.
+  int loopframe;
   int repeat;
-  int srcp;
-  int delay; // frames
   float frames_per_ms;
   int tempo; // ms/qnote, advisory only
   int qual,songid;
-  int startp,loopp;
-  int playhead_ms; // We make an effort to keep current at each advance.
-  int playhead_ms_next; // Force (playhead_ms) here when delay depletes. Avoids some rounding error.
 };
 
 void synth_song_del(struct synth_song *song);
@@ -24,7 +33,6 @@ void synth_song_del(struct synth_song *song);
 struct synth_song *synth_song_new(
   struct synth *synth,
   const void *src,int srcc,
-  int safe_to_borrow,
   int repeat,
   int qual,int songid
 );
@@ -33,31 +41,24 @@ static inline int synth_song_is_resource(const struct synth_song *song,int qual,
   return ((song->qual==qual)&&(song->songid==songid));
 }
 
-static inline double synth_song_get_playhead(const struct synth *synth,const struct synth_song *song,double adjust) {
-  return ((double)song->playhead_ms-(adjust*1000.0))/(double)song->tempo;
-}
-
 /* Commit new channels and procs to (synth), make ready to play (song).
  * All song channels must be null before calling.
  */
 int synth_song_init_channels(struct synth *synth,struct synth_song *song);
 
 /* Trigger any events at current playhead, then return frame count to next event.
- * Returns 0 at EOF (if not repeating), or <0 for real errors.
- * (skip) nonzero to suppress actual event delivery -- only synth_song_set_playhead() should use that.
+ * Returns 0 at EOF (if not repeating).
  */
-int synth_song_update(struct synth *synth,struct synth_song *song,int skip);
+int synth_song_update(struct synth *synth,struct synth_song *song);
 
 /* Advance playhead by so many frames.
  * This must not be more than the last thing we returned at synth_song_update().
  */
 void synth_song_advance(struct synth_song *song,int framec);
 
-/* Reset to start, then discard events until we're close to the requested beat.
+/* Jump directly to the requested beat, without delivering any events. O(log n).
+ * Beyond the end, we wrap into the loop if repeating, or stop at the end.
  */
 void synth_song_set_playhead(struct synth *synth,struct synth_song *song,double beats);
 
-// Sum of all delays. We have to read the whole song each time you ask for it.
-double synth_song_get_duration(const struct synth_song *song);
-
 #endif
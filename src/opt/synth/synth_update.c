@@ -1,22 +1,5 @@
 #include "synth_internal.h"
 
-/* Update printers.
- */
- 
-static void synth_update_printers(struct synth *synth,int framec) {
-  int i=synth->printerc;
-  struct sfg_printer **p=synth->printerv+i-1;
-  for (;i-->0;p--) {
-    struct sfg_printer *printer=*p;
-    int err=sfg_printer_update(printer,framec);
-    if (err) {
-      sfg_printer_del(printer);
-      synth->printerc--;
-      memmove(p,p+1,sizeof(void*)*(synth->printerc-i));
-    }
-  }
-}
-
 /* Drop defunct signal-graph objects from the end of their list.
  * There can be defunct ones mid-list too, but we're not going to look for those here.
  * (When a new object gets added, it will check for those inner defuncts, would be excessive here).
@@ -37,84 +20,76 @@ static void synth_reap_defunct_objects(struct synth *synth) {
   }
 }
 
-/* Update, floating-point, mono, limited length.
- * Buffer must be zeroed first.
- * Here we can begin the real work.
+/* Run the song and return the count of frames we can render before the next event, up to (c).
  */
  
-static void synth_updatef_mono(float *v,int c,struct synth *synth) {
-  while (c>0) {
-    
-    int updc=c;
-    if (synth->song) {
-      int err=synth_song_update(synth,synth->song,0);
-      if (err<=0) {
-        synth_end_song(synth);
-      } else {
-        if (err<updc) updc=err;
-        synth_song_advance(synth->song,updc);
-      }
-    } else if (synth->song_next&&!synth_has_song_voices(synth)) {
-      synth->song=synth->song_next;
-      synth->song_next=0;
-      synth_welcome_song(synth);
-      // Don't bother updating it this time around, we'll start on the next pass.
+static int synth_update_song(struct synth *synth,int c) {
+  if (synth->song) {
+    int err=synth_song_update(synth,synth->song);
+    if (err<=0) {
+      synth_end_song(synth);
+    } else {
+      if (err<c) c=err;
+      synth_song_advance(synth->song,c);
     }
-    
-    int i;
-    struct synth_voice *voice=synth->voicev;
-    for (i=synth->voicec;i-->0;voice++) synth_voice_update(v,updc,synth,voice);
-    struct synth_proc *proc=synth->procv;
-    for (i=synth->procc;i-->0;proc++) synth_proc_update(v,updc,synth,proc);
-    struct synth_playback *playback=synth->playbackv;
-    for (i=synth->playbackc;i-->0;playback++) synth_playback_update(v,updc,synth,playback);
-    
-    v+=updc;
-    c-=updc;
+  } else if (synth->song_next&&!synth_has_song_voices(synth)) {
+    synth->song=synth->song_next;
+    synth->song_next=0;
+    synth_welcome_song(synth);
+    // Don't bother updating it this time around, we'll start on the next pass.
   }
+  return c;
 }
 
-/* Update, floating-point, all channels, limited length.
- * Buffer must be zeroed first.
- * Call out for a mono signal, then expand it.
+/* Update, floating-point, mono or stereo, limited length.
+ * Buffer must be zeroed first. (c) in frames.
+ * Queued commands and song events run here between slices, and the signal graph runs in (synth->pool).
  */
  
-static void synth_expand_stereo(float *v,int framec) {
-  const float *src=v+framec;
-  float *dst=v+(framec<<1);
-  while (framec-->0) {
-    src--;
-    *(--dst)=*src;
-    *(--dst)=*src;
+static void synth_updatef_frames(float *v,int c,struct synth *synth) {
+  int chanc=(synth->chanc==1)?1:2;
+  while (c>0) {
+    int updc=synth_drain_commands(synth,c);
+    updc=synth_update_song(synth,updc);
+    synth_pool_update(v,updc,synth->pool);
+    synth->framep+=updc;
+    v+=updc*chanc;
+    c-=updc;
   }
 }
 
+/* Update, floating-point, all channels, limited length.
+ * Buffer must be zeroed first.
+ * Beyond stereo, we generate stereo and then expand it.
+ * Extra channels get the average of left and right.
+ */
+
 static void synth_expand_multi(float *v,int framec,int chanc) {
-  const float *src=v+framec;
+  const float *src=v+(framec<<1);
   float *dst=v+framec*chanc;
   while (framec-->0) {
-    src--;
+    src-=2;
+    dst-=chanc;
+    float l=src[0],r=src[1];
+    float mid=(l+r)*0.5f;
     int i=chanc;
-    while (i-->0) {
-      *(--dst)=*src;
-    }
+    while (i-->2) dst[i]=mid;
+    dst[0]=l;
+    dst[1]=r;
   }
 }
  
 static void synth_updatef_limited(float *v,int c,struct synth *synth) {
   switch (synth->chanc) {
     case 1: {
-        synth_updatef_mono(v,c,synth);
+        synth_updatef_frames(v,c,synth);
       } break;
     case 2: {
-        //TODO I expect eventually we'll want stereo output. Our API mostly is ready for it, but internals not.
-        int framec=c>>1;
-        synth_updatef_mono(v,framec,synth);
-        synth_expand_stereo(v,framec);
+        synth_updatef_frames(v,c>>1,synth);
       } break;
     default: {
         int framec=c/synth->chanc;
-        synth_updatef_mono(v,framec,synth);
+        synth_updatef_frames(v,framec,synth);
         synth_expand_multi(v,framec,synth->chanc);
       } break;
   }
@@ -124,12 +99,12 @@ static void synth_updatef_limited(float *v,int c,struct synth *synth) {
  * Top level of update.
  */
  
-void synth_updatef(float *v,int c,struct synth *synth) {
+static void synth_updatef_unclocked(float *v,int c,struct synth *synth) {
 
   int framec=c/synth->chanc;
   synth->framec+=framec;
   synth->update_in_progress=framec;
-  synth_update_printers(synth,framec);
+  synth_schedule_printers(synth,framec);
 
   memset(v,0,sizeof(float)*c);
   while (c>=synth->buffer_limit) {
@@ -143,26 +118,52 @@ void synth_updatef(float *v,int c,struct synth *synth) {
   
   synth->update_in_progress=0;
   synth_reap_defunct_objects(synth);
+  synth_song_publish(synth);
+}
+
+void synth_updatef(float *v,int c,struct synth *synth) {
+  unsigned int fpstate=synth_denormals_disable();
+  synth_clock_publish(synth,c/synth->chanc);
+  synth_updatef_unclocked(v,c,synth);
+  synth_denormals_restore(fpstate);
+}
+
+void synth_updatef_clamped(float *v,int c,struct synth *synth) {
+  synth_updatef(v,c,synth);
+  float level=synth->qlevel/32768.0f;
+  const float hi=32767.0f/32768.0f;
+  for (;c-->0;v++) {
+    float sample=(*v)*level;
+    if (sample>hi) *v=hi;
+    else if (sample<-1.0f) *v=-1.0f;
+    else *v=sample;
+  }
 }
 
 /* Update, integer, all channels, unlimited length.
  */
  
-static void synth_quantize(int16_t *dst,const float *src,int c,float level) {
-  for (;c-->0;dst++,src++) {
-    *dst=(int16_t)((*src)*level);
+static void synth_quantize(int16_t *dst,const float *src,int c,struct synth *synth) {
+  if (synth->dither) {
+    synth->simd->noise(synth->dbuf,c<<1,&synth->dithernoise);
+    synth->simd->quantize(dst,c,src,synth->qlevel,synth->dbuf);
+  } else {
+    synth->simd->quantize(dst,c,src,synth->qlevel,0);
   }
 }
  
 void synth_updatei(int16_t *v,int c,struct synth *synth) {
+  unsigned int fpstate=synth_denormals_disable();
+  synth_clock_publish(synth,c/synth->chanc);
   while (c>=synth->buffer_limit) {
-    synth_updatef(synth->qbuf,synth->buffer_limit,synth);
-    synth_quantize(v,synth->qbuf,synth->buffer_limit,synth->qlevel);
+    synth_updatef_unclocked(synth->qbuf,synth->buffer_limit,synth);
+    synth_quantize(v,synth->qbuf,synth->buffer_limit,synth);
     v+=synth->buffer_limit;
     c-=synth->buffer_limit;
   }
   if (c>0) {
-    synth_updatef(synth->qbuf,c,synth);
-    synth_quantize(v,synth->qbuf,c,synth->qlevel);
+    synth_updatef_unclocked(synth->qbuf,c,synth);
+    synth_quantize(v,synth->qbuf,c,synth);
   }
+  synth_denormals_restore(fpstate);
 }
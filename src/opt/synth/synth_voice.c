@@ -11,6 +11,7 @@ void synth_voice_cleanup(struct synth_voice *voice) {
  
 void synth_voice_begin(struct synth *synth,struct synth_voice *voice,struct synth_channel *channel,uint8_t noteid,uint8_t velocity,int dur) {
   if (noteid>=0x80) return;
+  synth_pan_gains(&voice->panl,&voice->panr,channel->pan);
   switch (voice->mode=channel->mode) {
   
     case SYNTH_CHANNEL_MODE_BLIP: {
@@ -35,7 +36,7 @@ void synth_voice_begin(struct synth *synth,struct synth_voice *voice,struct synt
         voice->dp=(uint32_t)((float)voice->dp0*channel->bend);
         synth_env_init(&voice->level,&channel->level,velocity,dur);
         synth_env_gain(&voice->level,channel->master*channel->trim);
-        voice->wave=channel->wave?channel->wave:synth->sine;
+        voice->wave=channel->wave?channel->wave->v:synth->sine;
       } break;
       
     case SYNTH_CHANNEL_MODE_ROCK: {
@@ -48,7 +49,7 @@ void synth_voice_begin(struct synth *synth,struct synth_voice *voice,struct synt
         synth_env_init(&voice->level,&channel->level,velocity,dur);
         synth_env_gain(&voice->level,channel->master*channel->trim);
         synth_env_init(&voice->param0,&channel->param0,velocity,dur);
-        voice->wave=channel->wave?channel->wave:synth->sine;
+        voice->wave=channel->wave?channel->wave->v:synth->sine;
       } break;
       
     case SYNTH_CHANNEL_MODE_FMREL: {
@@ -88,10 +89,15 @@ void synth_voice_begin(struct synth *synth,struct synth_voice *voice,struct synt
         float freq=synth->ffreqv[noteid];
         synth_filter_init_bandpass(&voice->filter1,freq,channel->sv[0]);
         synth_filter_init_bandpass(&voice->filter2,freq,channel->sv[1]);
+        synth_noise_seed(&voice->noise,synth->noiseseed++);
       } break;
     
     // DRUM uses playback; FX uses proc.
   }
+  if (voice->origin) {
+    voice->birthday=synth->framep;
+    synth_index_voice(synth,voice);
+  }
 }
 
 /* Release.
@@ -116,73 +122,76 @@ void synth_voice_release(struct synth *synth,struct synth_voice *voice) {
 }
 
 /* Update.
+ * Envelopes run into scratch buffers segment by segment, then the whole block goes thru (synth->simd).
+ * Kernels write straight to the output, panned if it's stereo.
  */
 
 void synth_voice_update(float *v,int c,struct synth *synth,struct synth_voice *voice) {
+  float level[SYNTH_BUFFER_LIMIT];
+  float param[SYNTH_BUFFER_LIMIT];
+  const float panv[2]={voice->panl,voice->panr};
+  const float *pan=(synth->chanc==2)?panv:0;
+  if (c>SYNTH_BUFFER_LIMIT) c=SYNTH_BUFFER_LIMIT;
   switch (voice->mode) {
   
     case SYNTH_CHANNEL_MODE_BLIP: {
-        for (;c-->0;v++) {
+        for (;c-->0;) {
           if (voice->ttl--<=0) {
             voice->ttl=0;
             voice->origin=0;
             return;
           }
-          if (voice->p&0x80000000) (*v)+=voice->bliplevel;
-          else (*v)-=voice->bliplevel;
+          float sample=(voice->p&0x80000000)?voice->bliplevel:-voice->bliplevel;
+          if (pan) {
+            v[0]+=sample*pan[0];
+            v[1]+=sample*pan[1];
+            v+=2;
+          } else {
+            (*v++)+=sample;
+          }
           voice->p+=voice->dp;
         }
       } break;
     
     case SYNTH_CHANNEL_MODE_WAVE: {
-        for (;c-->0;v++) {
-          (*v)+=voice->wave[voice->p>>SYNTH_WAVE_SHIFT]*synth_env_update(&voice->level);
-          voice->p+=voice->dp;
-        }
-        if (synth_env_is_finished(&voice->level)) {
+        synth_env_fill(level,c,&voice->level);
+        synth->simd->wave(v,c,voice->wave,&voice->p,voice->dp,level,pan);
+        if (synth_env_is_spent(&voice->level)) {
           voice->origin=0;
         }
       } break;
       
     case SYNTH_CHANNEL_MODE_ROCK: {
-        for (;c-->0;v++) {
-          float a=voice->wave[voice->p>>SYNTH_WAVE_SHIFT];
-          float b=synth->sine[voice->p>>SYNTH_WAVE_SHIFT];
-          float mix=synth_env_update(&voice->param0);
-          float sample=a*mix+b*(1.0f-mix);
-          (*v)+=sample*synth_env_update(&voice->level);
-          voice->p+=voice->dp;
-        }
-        if (synth_env_is_finished(&voice->level)) {
+        synth_env_fill(param,c,&voice->param0);
+        synth_env_fill(level,c,&voice->level);
+        synth->simd->rock(v,c,voice->wave,synth->sine,&voice->p,voice->dp,param,level,pan);
+        if (synth_env_is_spent(&voice->level)) {
           voice->origin=0;
         }
       } break;
       
     case SYNTH_CHANNEL_MODE_FMREL:
     case SYNTH_CHANNEL_MODE_FMABS: {
-        for (;c-->0;v++) {
-          (*v)+=synth->sine[voice->p>>SYNTH_WAVE_SHIFT]*synth_env_update(&voice->level);
-          float mod=synth->sine[voice->modp>>SYNTH_WAVE_SHIFT];
-          voice->modp+=voice->moddp;
-          mod*=synth_env_update(&voice->param0);
-          voice->p+=voice->dp+(int32_t)((float)voice->dp*mod);
-        }
-        if (synth_env_is_finished(&voice->level)) {
+        synth_env_fill(level,c,&voice->level);
+        synth_env_fill(param,c,&voice->param0);
+        synth->simd->fm(v,c,synth->sine,&voice->p,voice->dp,&voice->modp,voice->moddp,param,level,pan);
+        if (synth_env_is_spent(&voice->level)) {
           voice->origin=0;
         }
       } break;
       
     case SYNTH_CHANNEL_MODE_SUB: {
-        for (;c-->0;v++) {
-          float sample=(rand()&0xffff)/32768.0f-1.0f;
-          sample=synth_filter_iir_update(&voice->filter1,sample);
-          sample=synth_filter_iir_update(&voice->filter2,sample);
-          sample*=synth_env_update(&voice->level);
-          if (sample<-0.5f) sample=-0.5f;
-          else if (sample>0.5f) sample=0.5f;
-          (*v)+=sample;
+        // Noise vectorizes, the filters are serial, and then the tail vectorizes again.
+        synth->simd->noise(param,c,&voice->noise);
+        float *dst=param;
+        int i=c;
+        for (;i-->0;dst++) {
+          float sample=synth_filter_iir_update(&voice->filter1,*dst);
+          *dst=synth_filter_iir_update(&voice->filter2,sample);
         }
-        if (synth_env_is_finished(&voice->level)) {
+        synth_env_fill(level,c,&voice->level);
+        synth->simd->mlt_clamp_add(v,c,param,level,0.5f,pan);
+        if (synth_env_is_spent(&voice->level)) {
           voice->origin=0;
         }
       } break;
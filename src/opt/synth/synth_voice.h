@@ -12,6 +12,7 @@ struct synth_voice {
   uint8_t noteid;
   uint8_t origin; // zero for defunct
   int64_t birthday;
+  float panl,panr; // Fixed at note start. Only relevant to stereo output.
   int mode; // SYNTH_CHANNEL_MODE_*
   uint32_t p;
   uint32_t dp;
@@ -25,6 +26,7 @@ struct synth_voice {
   uint32_t moddp;
   struct synth_filter filter1;
   struct synth_filter filter2;
+  struct synth_noise noise; // SUB
 };
 
 void synth_voice_cleanup(struct synth_voice *voice);
@@ -33,7 +35,7 @@ void synth_voice_begin(struct synth *synth,struct synth_voice *voice,struct synt
 
 void synth_voice_release(struct synth *synth,struct synth_voice *voice);
 
-void synth_voice_update(float *v,int c,struct synth *synth,struct synth_voice *voice);
+void synth_voice_update(float *v,int c,struct synth *synth,struct synth_voice *voice); // (c) in frames; (v) is interleaved if stereo.
 
 static inline int synth_voice_is_channel(const struct synth_voice *voice,uint8_t chid) {
   return (voice->chid==chid);
@@ -47,11 +49,34 @@ static inline int synth_voice_is_defunct(const struct synth_voice *voice) {
   return !voice->origin;
 }
 
+/* Released and finishing voices are the first to go when we need room.
+ * Among those, or among held ones, the quietest, then the oldest.
+ * During attack we count the peak it's heading for, so a note just starting doesn't look quiet.
+ */
+static inline int synth_voice_is_releasing(const struct synth_voice *voice) {
+  if (voice->noteid>=0x80) return 1;
+  if (voice->mode==SYNTH_CHANNEL_MODE_BLIP) return 0;
+  return (voice->level.stage>=3);
+}
+
+static inline float synth_voice_loudness(const struct synth_voice *voice) {
+  if (voice->mode==SYNTH_CHANNEL_MODE_BLIP) return voice->bliplevel;
+  if (!voice->level.stage) return voice->level.atkv;
+  return (voice->level.v<0.0f)?-voice->level.v:voice->level.v;
+}
+
 static inline int synth_voice_compare(
   const struct synth_voice *a,
   const struct synth_voice *b
 ) {
-  return a->birthday-b->birthday;
+  int ar=synth_voice_is_releasing(a),br=synth_voice_is_releasing(b);
+  if (ar!=br) return br-ar;
+  float al=synth_voice_loudness(a),bl=synth_voice_loudness(b);
+  if (al<bl) return -1;
+  if (al>bl) return 1;
+  if (a->birthday<b->birthday) return -1;
+  if (a->birthday>b->birthday) return 1;
+  return 0;
 }
 
 #endif
@@ -1,6 +1,6 @@
 #include "synth_internal.h"
 
-/* New wave from harmonics.
+/* Print harmonics into a table.
  */
  
 static void synth_wave_print_harmonic(float *dst,const float *src,float level,int step) {
@@ -11,14 +11,113 @@ static void synth_wave_print_harmonic(float *dst,const float *src,float level,in
   }
 }
  
-float *synth_wave_new_harmonics(const struct synth *synth,const uint8_t *coefv,int coefc) {
-  float *dst=calloc(sizeof(float),SYNTH_WAVE_SIZE_SAMPLES);
-  if (!dst) return 0;
-  if (coefc>SYNTH_HARMONICS_LIMIT) coefc=SYNTH_HARMONICS_LIMIT;
+static void synth_wave_print_harmonics(float *dst,const struct synth *synth,const uint8_t *coefv,int coefc) {
+  memset(dst,0,sizeof(float)*SYNTH_WAVE_SIZE_SAMPLES);
   int step=1;
   for (;coefc-->0;coefv++,step++) {
     if (!*coefv) continue;
     synth_wave_print_harmonic(dst,synth->sine,(*coefv)/255.0f,step);
   }
-  return dst;
+}
+
+/* Search cache.
+ */
+ 
+static uint64_t synth_wave_key(const uint8_t *coefv,int coefc) {
+  if (coefc>SYNTH_WAVE_COEF_LIMIT) coefc=SYNTH_WAVE_COEF_LIMIT;
+  uint64_t key=0;
+  int shift=0;
+  for (;coefc-->0;coefv++,shift+=8) key|=(uint64_t)(*coefv)<<shift;
+  return key;
+}
+ 
+static int synth_wave_search(const struct synth *synth,uint64_t key) {
+  int lo=0,hi=synth->wavec;
+  while (lo<hi) {
+    int ck=(lo+hi)>>1;
+    uint64_t q=synth->wavev[ck]->key;
+         if (key<q) hi=ck;
+    else if (key>q) lo=ck+1;
+    else return ck;
+  }
+  return -lo-1;
+}
+
+/* Drop one unreferenced table, if there is one.
+ * Returns its index or -1.
+ */
+ 
+static int synth_wave_evict(struct synth *synth) {
+  int i=synth->wavec;
+  while (i-->0) {
+    struct synth_wave *wave=synth->wavev[i];
+    if (wave->refc) continue;
+    free(wave);
+    synth->wavec--;
+    memmove(synth->wavev+i,synth->wavev+i+1,sizeof(void*)*(synth->wavec-i));
+    return i;
+  }
+  return -1;
+}
+
+/* Get table, adding to cache if needed.
+ */
+ 
+static struct synth_wave *synth_wave_require(struct synth *synth,const uint8_t *coefv,int coefc) {
+  uint64_t key=synth_wave_key(coefv,coefc);
+  int p=synth_wave_search(synth,key);
+  if (p>=0) return synth->wavev[p];
+  p=-p-1;
+  if (synth->wavec>=SYNTH_WAVE_CACHE_LIMIT) {
+    int evp=synth_wave_evict(synth);
+    if ((evp>=0)&&(evp<p)) p--;
+  }
+  if (synth->wavec>=synth->wavea) {
+    int na=synth->wavea+32;
+    if (na>INT_MAX/sizeof(void*)) return 0;
+    void *nv=realloc(synth->wavev,sizeof(void*)*na);
+    if (!nv) return 0;
+    synth->wavev=nv;
+    synth->wavea=na;
+  }
+  struct synth_wave *wave=malloc(sizeof(struct synth_wave));
+  if (!wave) return 0;
+  wave->key=key;
+  wave->refc=0;
+  synth_wave_print_harmonics(wave->v,synth,coefv,(coefc>SYNTH_WAVE_COEF_LIMIT)?SYNTH_WAVE_COEF_LIMIT:coefc);
+  memmove(synth->wavev+p+1,synth->wavev+p,sizeof(void*)*(synth->wavec-p));
+  synth->wavev[p]=wave;
+  synth->wavec++;
+  return wave;
+}
+
+struct synth_wave *synth_wave_get_harmonics(struct synth *synth,const uint8_t *coefv,int coefc) {
+  struct synth_wave *wave=synth_wave_require(synth,coefv,coefc);
+  if (!wave) return 0;
+  wave->refc++;
+  return wave;
+}
+
+/* Prewarm.
+ */
+ 
+void synth_wave_prewarm(struct synth *synth) {
+  const struct synth_builtin *builtin=synth_builtin;
+  int i=0x80;
+  for (;i-->0;builtin++) {
+    switch (builtin->mode) {
+      case SYNTH_CHANNEL_MODE_WAVE: synth_wave_require(synth,builtin->wave.wave,sizeof(builtin->wave.wave)); break;
+      case SYNTH_CHANNEL_MODE_ROCK: synth_wave_require(synth,builtin->rock.wave,sizeof(builtin->rock.wave)); break;
+    }
+  }
+}
+
+/* Clear.
+ */
+ 
+void synth_wave_cache_clear(struct synth *synth) {
+  while (synth->wavec>0) {
+    synth->wavec--;
+    free(synth->wavev[synth->wavec]);
+  }
 }
@@ -0,0 +1,36 @@
+/* synth_wave.h
+ * Wave tables generated from harmonic coefficients, shared by reference among channels.
+ * The synth holds them in a list sorted by coefficients, and keeps them after the last channel lets go,
+ * so song changes don't allocate or sum harmonics. We print every builtin's table at synth_new.
+ */
+
+#ifndef SYNTH_WAVE_H
+#define SYNTH_WAVE_H
+
+#define SYNTH_WAVE_COEF_LIMIT 8 /* Same as the builtins. Beyond this, coefficients are ignored. */
+#define SYNTH_WAVE_CACHE_LIMIT 256 /* Beyond this many tables, we drop unreferenced ones as new ones arrive. */
+
+struct synth_wave {
+  uint64_t key; // Coefficients packed little-endianly, zero-padded.
+  int refc; // Channels using it. The cache itself doesn't count.
+  float v[SYNTH_WAVE_SIZE_SAMPLES];
+};
+
+/* Get a table for these coefficients, making it if needed, and add a reference.
+ * Caller must synth_wave_unref when finished.
+ * Any voices using it must be gone before that.
+ */
+struct synth_wave *synth_wave_get_harmonics(struct synth *synth,const uint8_t *coefv,int coefc);
+
+static inline void synth_wave_unref(struct synth_wave *wave) {
+  if (wave&&(wave->refc>0)) wave->refc--;
+}
+
+/* Generate a table for every WAVE and ROCK builtin. Failure is not fatal; we'll try again on demand.
+ */
+void synth_wave_prewarm(struct synth *synth);
+
+// Drops everything. Only for synth_del, after the channels.
+void synth_wave_cache_clear(struct synth *synth);
+
+#endif
@@ -31,6 +31,15 @@ static void egg_print_help(const char *topic,int topicc) {
     "  --audio-buffer=INT       If required by driver.\n"
     "  --audio-device=STRING    If required by driver.\n"
     "  --audio-driver=LIST      See below. First to start up wins.\n"
+    "  --audio-threads=INT      Threads for the synthesizer, including the audio callback. Default 1.\n"
+    "  --audio-bgprint=0|1      Print sound effects on a background thread. Default 1.\n"
+    "  --audio-print-budget=PCT Percent of each audio update that foreground printing may use. Default 0, unlimited.\n"
+    "  --audio-print-samples=N  Samples foreground printing may produce per audio update. Default 0, unlimited.\n"
+    "  --audio-prewarm          Print every sound effect at startup.\n"
+    "  --audio-cache=PATH       Directory to keep printed sound effects across runs. Default none.\n"
+    "  --audio-pcm-limit=BYTES  Memory budget for printed sound effects. Default 0, unlimited.\n"
+    "  --audio-voices=INT       Concurrent tuned notes before the synth starts stealing. Default 32.\n"
+    "  --audio-dither=0|1       Dither when converting to 16-bit, if the driver doesn't take float. Default 0.\n"
     "  --save=PATH              Save file. \"none\" to disable saving, or empty for default.\n"
     "  --store-limit=BYTES      Force save file to stay under this length. Default 1 MB.\n"
     "  --state=PATH             File for saved state. Press a key in-game to load or save. \"none\" to disable.\n"
@@ -164,6 +173,15 @@ static int egg_config_kv(const char *k,int kc,const char *v,int vc) {
   INTOPT(audio_buffer,"audio-buffer",0,INT_MAX)
   STROPT(audio_device,"audio-device")
   STROPT(audio_driver,"audio-driver")
+  INTOPT(audio_threads,"audio-threads",0,16)
+  BOOLOPT(audio_bgprint,"audio-bgprint")
+  INTOPT(audio_print_budget,"audio-print-budget",0,100)
+  INTOPT(audio_print_samples,"audio-print-samples",0,INT_MAX)
+  BOOLOPT(audio_prewarm,"audio-prewarm")
+  STROPT(audio_cache,"audio-cache")
+  INTOPT(audio_pcm_limit,"audio-pcm-limit",0,INT_MAX)
+  INTOPT(audio_voices,"audio-voices",0,4096)
+  BOOLOPT(audio_dither,"audio-dither")
   STROPT(storepath,"save")
   INTOPT(store_limit,"store-limit",0,INT_MAX)
   BOOLOPT(ignore_required,"ignore-required")
@@ -390,6 +408,7 @@ static int egg_config_finalize() {
  
 static void egg_config_init() {
   egg.config.store_limit=1<<20;
+  egg.config.audio_bgprint=1;
 }
 
 /* Configure, main entry point.
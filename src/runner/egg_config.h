@@ -19,6 +19,15 @@ struct egg_config {
   int audio_buffer;
   char *audio_device;
   char *audio_driver;
+  int audio_threads;
+  int audio_bgprint;
+  int audio_print_budget;
+  int audio_print_samples;
+  int audio_prewarm;
+  char *audio_cache;
+  int audio_pcm_limit;
+  int audio_voices;
+  int audio_dither;
   char *storepath;
   int store_limit;
   int ignore_required;
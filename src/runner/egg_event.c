@@ -21,3 +21,7 @@ void egg_cb_resize(struct hostio_video *driver,int w,int h) {
 void egg_cb_pcm_out(int16_t *v,int c,struct hostio_audio *driver) {
   synth_updatei(v,c,egg.synth);
 }
+
+void egg_cb_pcm_outf(float *v,int c,struct hostio_audio *driver) {
+  synth_updatef_clamped(v,c,egg.synth);
+}
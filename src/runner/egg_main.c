@@ -7,14 +7,42 @@ struct egg egg={0};
 /* Quit.
  */
  
+static void egg_synth_report() {
+  if (!egg.synth) return;
+  struct synth_stats stats;
+  synth_get_stats(&stats,egg.synth);
+  if (stats.cache_hitc||stats.cache_missc) fprintf(stderr,
+    "Sound cache: %d hits, %d misses, %d evictions. Holding %d sounds, %lld bytes.\n",
+    stats.cache_hitc,stats.cache_missc,stats.cache_evictc,stats.cache_soundc,(long long)stats.cache_bytes
+  );
+  if (stats.voice_stealc||stats.proc_stealc||stats.playback_stealc) fprintf(stderr,
+    "Synth stole %d voices, %d procs, %d playbacks to make room.\n",
+    stats.voice_stealc,stats.proc_stealc,stats.playback_stealc
+  );
+  if (stats.print_missc) fprintf(stderr,
+    "Sound printing fell behind in %d updates, %lld frames late in total, at most %d at once.\n",
+    stats.print_missc,(long long)stats.print_lagc,stats.print_lag_max
+  );
+}
+
+static void egg_render_report() {
+  if (egg.glframec<1) return;
+  fprintf(stderr,
+    "Render per frame: %.1f draws, %.1f GL state calls, %.1f skipped as redundant.\n",
+    (double)egg.glstats.drawc/egg.glframec,(double)egg.glstats.callc/egg.glframec,(double)egg.glstats.skipc/egg.glframec
+  );
+}
+
 static void egg_quit() {
   if (!egg.config.configure_input) {
     if (egg.client_initted) egg_romsrc_call_client_quit();
   }
   egg_store_quit();
   egg_timer_report(&egg.timer);
+  egg_render_report();
   render_del(egg.render);
   hostio_del(egg.hostio);
+  egg_synth_report(); // After hostio, so the audio thread is stopped.
   synth_del(egg.synth);
   egg_inmgr_del(egg.inmgr);
   incfg_del(egg.incfg);
@@ -130,6 +158,46 @@ static int egg_init_audio() {
     );
     return -2;
   }
+  if (egg.config.audio_threads>1) {
+    if (synth_set_threads(egg.synth,egg.config.audio_threads)<0) {
+      fprintf(stderr,"%s: Failed to start %d synthesizer threads. Proceeding single-threaded.\n",egg.exename,egg.config.audio_threads);
+    }
+  }
+  if (egg.config.audio_pcm_limit>0) {
+    synth_set_cache_budget(egg.synth,egg.config.audio_pcm_limit);
+  }
+  if (egg.config.audio_voices>0) {
+    if (synth_set_voice_limits(egg.synth,egg.config.audio_voices,0,0)<0) {
+      fprintf(stderr,"%s: Failed to allocate %d synthesizer voices. Proceeding with the default.\n",egg.exename,egg.config.audio_voices);
+    }
+  }
+  if ((egg.config.audio_print_budget>0)||(egg.config.audio_print_samples>0)) {
+    synth_set_print_budget(egg.synth,egg.config.audio_print_budget/100.0,egg.config.audio_print_samples);
+  }
+  if (egg.config.audio_dither) {
+    synth_set_dither(egg.synth,1);
+  }
+  if (egg.config.audio_cache&&egg.config.audio_cache[0]) {
+    if (synth_set_disk_cache(egg.synth,egg.config.audio_cache)<0) {
+      fprintf(stderr,"%s: Failed to open sound cache at '%s'. Proceeding without.\n",egg.exename,egg.config.audio_cache);
+    }
+  }
+  if (egg.config.audio_bgprint) {
+    if (synth_set_background_printing(egg.synth,1)<0) {
+      fprintf(stderr,"%s: Failed to start background sound printer. Will print in the audio callback.\n",egg.exename);
+    }
+  }
+  if (egg.config.audio_prewarm) {
+    double starttime=egg_timer_now();
+    int64_t bytes=0;
+    int soundc=synth_prewarm(egg.synth,0,&bytes);
+    if (soundc>=0) {
+      fprintf(stderr,
+        "%s: Prewarmed %d sounds in %.03f s, printed %lld bytes.\n",
+        egg.exename,soundc,egg_timer_now()-starttime,(long long)bytes
+      );
+    }
+  }
   
   hostio_audio_play(egg.hostio,1);
   
@@ -182,6 +250,7 @@ static int egg_init(int argc,char **argv) {
   };
   struct hostio_audio_delegate audio_delegate={
     .cb_pcm_out=egg_cb_pcm_out,
+    .cb_pcm_outf=egg_cb_pcm_outf,
   };
   struct hostio_input_delegate input_delegate={
     .cb_connect=egg_cb_connect,
@@ -234,21 +303,6 @@ static int egg_init(int argc,char **argv) {
   return 0;
 }
 
-/* Sticky audio lock.
- */
- 
-int egg_lock_audio() {
-  if (egg.audio_locked) return 0;
-  if (hostio_audio_lock(egg.hostio)<0) return -1;
-  egg.audio_locked=1;
-  return 0;
-}
-
-void egg_unlock_audio() {
-  hostio_audio_unlock(egg.hostio);
-  egg.audio_locked=0;
-}
-
 /* Update.
  * Block as needed.
  */
@@ -284,7 +338,6 @@ static int egg_update() {
   } else {
     egg_romsrc_call_client_update(elapsed);
   }
-  if (egg.audio_locked) egg_unlock_audio();
   
   // Render.
   if (egg.hostio->video->type->gx_begin(egg.hostio->video)<0) {
@@ -303,6 +356,12 @@ static int egg_update() {
     }
     egg_inmgr_render(egg.inmgr);
     render_draw_to_main(egg.render,egg.hostio->video->w,egg.hostio->video->h,1);
+    struct render_stats stats;
+    render_get_stats(&stats,egg.render);
+    egg.glstats.drawc+=stats.drawc;
+    egg.glstats.callc+=stats.callc;
+    egg.glstats.skipc+=stats.skipc;
+    egg.glframec++;
   }
   if (egg.hostio->video->type->gx_end(egg.hostio->video)<0) {
     fprintf(stderr,"%s: Error submitting video frame.\n",egg.exename);
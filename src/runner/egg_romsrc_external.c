@@ -313,22 +313,18 @@ static int egg_wasm_joystick_for_each_button(wasm_exec_env_t ee,int devid,int cb
 }
 
 static void egg_wasm_audio_play_song(wasm_exec_env_t ee,int qual,int rid,int force,int repeat) {
-  if (egg_lock_audio()<0) return;
-  synth_play_song(egg.synth,qual,rid,force,repeat);
+  synth_post_play_song(egg.synth,qual,rid,force,repeat);
 }
 
 static void egg_wasm_audio_play_sound(wasm_exec_env_t ee,int qual,int rid,int trim,int pan) {
-  if (egg_lock_audio()<0) return;
-  synth_play_sound(egg.synth,qual,rid,trim/65536.0,pan/65536.0);
+  synth_post_play_sound(egg.synth,qual,rid,trim/65536.0,pan/65536.0);
 }
 
 static void egg_wasm_audio_event(wasm_exec_env_t ee,int chid,int opcode,int a,int b) {
-  if (egg_lock_audio()<0) return;
-  synth_event(egg.synth,chid,opcode,a,b,0);
+  synth_post_event(egg.synth,chid,opcode,a,b);
 }
 
 static double egg_wasm_audio_get_playhead(wasm_exec_env_t ee) {
-  // No need to lock.
   double adjust=0.0;
   if (egg.hostio->audio) {
     adjust=hostio_audio_estimate_remaining_buffer(egg.hostio->audio);
@@ -338,8 +334,7 @@ static double egg_wasm_audio_get_playhead(wasm_exec_env_t ee) {
 }
 
 static void egg_wasm_audio_set_playhead(wasm_exec_env_t ee,double beat) {
-  if (egg_lock_audio()<0) return;
-  synth_set_playhead(egg.synth,beat);
+  synth_post_set_playhead(egg.synth,beat);
 }
 
 /* Table of exports to wasm.
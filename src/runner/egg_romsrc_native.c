@@ -197,22 +197,18 @@ int egg_res_for_each(int (*cb)(int tid,int qual,int rid,int len,void *userdata),
 }
 
 void egg_audio_play_song(int qual,int rid,int force,int repeat) {
-  if (egg_lock_audio()<0) return;
-  synth_play_song(egg.synth,qual,rid,force,repeat);
+  synth_post_play_song(egg.synth,qual,rid,force,repeat);
 }
 
 void egg_audio_play_sound(int qual,int rid,int trim,int pan) {
-  if (egg_lock_audio()<0) return;
-  synth_play_sound(egg.synth,qual,rid,trim/65536.0,pan/65536.0);
+  synth_post_play_sound(egg.synth,qual,rid,trim/65536.0,pan/65536.0);
 }
 
 void egg_audio_event(int chid,int opcode,int a,int b) {
-  if (egg_lock_audio()<0) return;
-  synth_event(egg.synth,chid,opcode,a,b,0);
+  synth_post_event(egg.synth,chid,opcode,a,b);
 }
 
 double egg_audio_get_playhead() {
-  // No need to lock.
   double adjust=0.0;
   if (egg.hostio->audio) {
     adjust=hostio_audio_estimate_remaining_buffer(egg.hostio->audio);
@@ -220,8 +216,7 @@ double egg_audio_get_playhead() {
   return synth_get_playhead(egg.synth,adjust);
 }
 void egg_audio_set_playhead(double beat) {
-  if (egg_lock_audio()<0) return;
-  synth_set_playhead(egg.synth,beat);
+  synth_post_set_playhead(egg.synth,beat);
 }
 
 /* Load.
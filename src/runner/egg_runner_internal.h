@@ -34,11 +34,12 @@ extern struct egg {
   char *store;
   int storec;
   int store_dirty;
-  int audio_locked; // Sticky lock that pops back open after the client update.
   int directgl;
   char *glstr; // For glGetString, circular buffer.
   int glstrp,glstra;
   int hard_pause;
+  struct render_stats glstats; // Sum over all frames drawn via render_draw_to_main.
+  int glframec;
 } egg;
 
 extern const int egg_romsrc;
@@ -80,9 +81,6 @@ int egg_store_init();
 void egg_store_quit();
 void egg_store_flush();
 
-int egg_lock_audio();
-void egg_unlock_audio();
-
 void egg_event_init();
 
 void egg_cb_close(struct hostio_video *driver);
@@ -94,6 +92,7 @@ void egg_cb_mmotion(struct hostio_video *driver,int x,int y);
 void egg_cb_mbutton(struct hostio_video *driver,int btnid,int value);
 void egg_cb_mwheel(struct hostio_video *driver,int dx,int dy);
 void egg_cb_pcm_out(int16_t *v,int c,struct hostio_audio *driver);
+void egg_cb_pcm_outf(float *v,int c,struct hostio_audio *driver);
 void egg_cb_connect(struct hostio_input *driver,int devid);
 void egg_cb_disconnect(struct hostio_input *driver,int devid);
 void egg_cb_button(struct hostio_input *driver,int devid,int btnid,int value);
@@ -394,16 +394,10 @@ static int egg_savestate_apply(const struct egg_savestate_decode *ctx,const char
     int rid=(ctx->song[2]<<8)|ctx->song[3];
     int repeat=ctx->song[4];
     double playhead=((ctx->song[5]<<24)|(ctx->song[6]<<16)|(ctx->song[7]<<8)|ctx->song[8])/65536.0;
-    if (egg_lock_audio()>=0) {
-      synth_play_song(egg.synth,qual,rid,1,repeat);
-      synth_set_playhead(egg.synth,playhead);
-      egg_unlock_audio();
-    }
+    synth_post_play_song(egg.synth,qual,rid,1,repeat);
+    synth_post_set_playhead(egg.synth,playhead);
   } else {
-    if (egg_lock_audio()>=0) {
-      synth_play_song(egg.synth,0,0,0,0);
-      egg_unlock_audio();
-    }
+    synth_post_play_song(egg.synth,0,0,0,0);
   }
   
   // Input.